@@ -0,0 +1,246 @@
+/*--------------------------------------------------------------------*/
+/* arena.c                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+/* pthreads are POSIX, not ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "arena.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Every block's size and address is a multiple of this */
+enum { ARENA_ALIGNMENT = 16 };
+
+/* The number of size classes of small blocks, which are 16, 32, ...
+   up to 16 * ARENA_CLASSES bytes; larger blocks are allocated on
+   their own */
+enum { ARENA_CLASSES = 16 };
+
+/* The smallest and largest sizes of a slab, in bytes; slabs double
+   in size from one to the next, up to the largest */
+enum { ARENA_MIN_SLAB = 16384, ARENA_MAX_SLAB = 1048576 };
+
+/*
+  A slab of memory from which small blocks are cut. The header is
+  padded to ARENA_ALIGNMENT, so the blocks after it are aligned.
+*/
+struct slab {
+   /* the slab allocated before this one */
+   struct slab *psNext;
+   /* padding */
+   size_t ulUnused;
+};
+
+/* A released small block, waiting for reuse */
+struct freeBlock {
+   /* the next released block of the same size class */
+   struct freeBlock *psNext;
+};
+
+/*
+  The header of a large block, allocated on its own and linked into
+  its arena's list of them so that Arena_free can find it.
+*/
+struct largeBlock {
+   /* the neighbouring large blocks in the list */
+   struct largeBlock *psPrev;
+   struct largeBlock *psNext;
+};
+
+struct Arena {
+   /* the slabs, most recent first */
+   struct slab *psSlabs;
+   /* the part of the most recent slab not yet cut into blocks */
+   char *pcFree;
+   size_t ulFreeLength;
+   /* the size of the next slab */
+   size_t ulNextSlab;
+   /* the released small blocks, by size class */
+   struct freeBlock *apsReleased[ARENA_CLASSES];
+   /* the large blocks */
+   struct largeBlock *psLarge;
+   /* whether sMutex guards the arena */
+   boolean bIsThreadSafe;
+   pthread_mutex_t sMutex;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Acquires oAArena's mutex, if it has one. */
+static void Arena_lock(Arena_T oAArena) {
+   assert(oAArena != NULL);
+
+   if(oAArena->bIsThreadSafe)
+      (void) pthread_mutex_lock(&oAArena->sMutex);
+}
+
+/* Releases oAArena's mutex, if it has one. */
+static void Arena_unlock(Arena_T oAArena) {
+   assert(oAArena != NULL);
+
+   if(oAArena->bIsThreadSafe)
+      (void) pthread_mutex_unlock(&oAArena->sMutex);
+}
+
+/*
+  Returns a new large block of ulSize bytes from oAArena, or NULL if
+  memory could not be allocated.
+*/
+static void *Arena_allocLarge(Arena_T oAArena, size_t ulSize) {
+   struct largeBlock *psBlock;
+
+   assert(oAArena != NULL);
+
+   psBlock = malloc(sizeof(struct largeBlock) + ulSize);
+   if(psBlock == NULL)
+      return NULL;
+   psBlock->psPrev = NULL;
+   psBlock->psNext = oAArena->psLarge;
+   if(oAArena->psLarge != NULL)
+      oAArena->psLarge->psPrev = psBlock;
+   oAArena->psLarge = psBlock;
+   return psBlock + 1;
+}
+
+/*
+  Cuts a small block of ulSize bytes, a multiple of ARENA_ALIGNMENT,
+  from oAArena's most recent slab, first allocating a new slab if it
+  has too little room left. Returns NULL if memory could not be
+  allocated.
+*/
+static void *Arena_cut(Arena_T oAArena, size_t ulSize) {
+   struct slab *psSlab;
+   void *pvBlock;
+
+   assert(oAArena != NULL);
+
+   if(oAArena->ulFreeLength < ulSize) {
+      psSlab = malloc(sizeof(struct slab) + oAArena->ulNextSlab);
+      if(psSlab == NULL)
+         return NULL;
+      psSlab->psNext = oAArena->psSlabs;
+      oAArena->psSlabs = psSlab;
+      oAArena->pcFree = (char *) (psSlab + 1);
+      oAArena->ulFreeLength = oAArena->ulNextSlab;
+      if(oAArena->ulNextSlab < ARENA_MAX_SLAB)
+         oAArena->ulNextSlab *= 2;
+   }
+
+   pvBlock = oAArena->pcFree;
+   oAArena->pcFree += ulSize;
+   oAArena->ulFreeLength -= ulSize;
+   return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+Arena_T Arena_new(size_t ulExpectedBytes, boolean bIsThreadSafe) {
+   Arena_T oAArena;
+   size_t i;
+
+   oAArena = malloc(sizeof(struct Arena));
+   if(oAArena == NULL)
+      return NULL;
+
+   oAArena->bIsThreadSafe = bIsThreadSafe;
+   if(bIsThreadSafe &&
+      pthread_mutex_init(&oAArena->sMutex, NULL) != 0) {
+      free(oAArena);
+      return NULL;
+   }
+
+   oAArena->psSlabs = NULL;
+   oAArena->pcFree = NULL;
+   oAArena->ulFreeLength = 0;
+   oAArena->psLarge = NULL;
+   for(i = 0; i < ARENA_CLASSES; i++)
+      oAArena->apsReleased[i] = NULL;
+
+   /* the hint sizes the first slab; later ones grow from there */
+   oAArena->ulNextSlab = ARENA_MIN_SLAB;
+   if(ulExpectedBytes > ARENA_MIN_SLAB)
+      oAArena->ulNextSlab = (ulExpectedBytes + ARENA_ALIGNMENT - 1) /
+         ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+   return oAArena;
+}
+
+void Arena_free(Arena_T oAArena) {
+   struct slab *psSlab;
+   struct largeBlock *psBlock;
+
+   if(oAArena == NULL)
+      return;
+
+   while((psSlab = oAArena->psSlabs) != NULL) {
+      oAArena->psSlabs = psSlab->psNext;
+      free(psSlab);
+   }
+   while((psBlock = oAArena->psLarge) != NULL) {
+      oAArena->psLarge = psBlock->psNext;
+      free(psBlock);
+   }
+   if(oAArena->bIsThreadSafe)
+      (void) pthread_mutex_destroy(&oAArena->sMutex);
+   free(oAArena);
+}
+
+void *Arena_alloc(Arena_T oAArena, size_t ulSize) {
+   struct freeBlock *psBlock;
+   size_t ulClass;
+   void *pvBlock;
+
+   assert(oAArena != NULL);
+
+   if(ulSize == 0)
+      ulSize = 1;
+   ulClass = (ulSize - 1) / ARENA_ALIGNMENT;
+
+   Arena_lock(oAArena);
+   if(ulClass >= ARENA_CLASSES)
+      pvBlock = Arena_allocLarge(oAArena, ulSize);
+   else if((psBlock = oAArena->apsReleased[ulClass]) != NULL) {
+      /* reuse a released block of the same size class */
+      oAArena->apsReleased[ulClass] = psBlock->psNext;
+      pvBlock = psBlock;
+   }
+   else
+      pvBlock = Arena_cut(oAArena, (ulClass + 1) * ARENA_ALIGNMENT);
+   Arena_unlock(oAArena);
+
+   return pvBlock;
+}
+
+void Arena_release(Arena_T oAArena, void *pvBlock, size_t ulSize) {
+   struct freeBlock *psBlock = pvBlock;
+   struct largeBlock *psLarge;
+   size_t ulClass;
+
+   assert(oAArena != NULL);
+   assert(pvBlock != NULL);
+
+   if(ulSize == 0)
+      ulSize = 1;
+   ulClass = (ulSize - 1) / ARENA_ALIGNMENT;
+
+   Arena_lock(oAArena);
+   if(ulClass >= ARENA_CLASSES) {
+      psLarge = (struct largeBlock *) pvBlock - 1;
+      if(psLarge->psPrev != NULL)
+         psLarge->psPrev->psNext = psLarge->psNext;
+      else
+         oAArena->psLarge = psLarge->psNext;
+      if(psLarge->psNext != NULL)
+         psLarge->psNext->psPrev = psLarge->psPrev;
+      free(psLarge);
+   }
+   else {
+      psBlock->psNext = oAArena->apsReleased[ulClass];
+      oAArena->apsReleased[ulClass] = psBlock;
+   }
+   Arena_unlock(oAArena);
+}
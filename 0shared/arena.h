@@ -0,0 +1,48 @@
+/*--------------------------------------------------------------------*/
+/* arena.h                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  An Arena_T is a pool of memory from which a data structure carves
+  its many small blocks. Blocks come from large slabs, so allocating
+  one rarely calls malloc; freed blocks are kept, by size, for reuse;
+  and freeing the arena frees every block in it at once, in time
+  proportional to the number of slabs rather than blocks.
+*/
+typedef struct Arena *Arena_T;
+
+/*
+  Returns a new, empty arena, or NULL if memory could not be
+  allocated. ulExpectedBytes is a hint of how much memory the arena
+  will hold, used to size its first slab (0 for no hint). If
+  bIsThreadSafe, the arena may be used from several threads at once;
+  otherwise its client must make sure it is not.
+*/
+Arena_T Arena_new(size_t ulExpectedBytes, boolean bIsThreadSafe);
+
+/*
+  Frees oAArena, along with every block allocated from it that has
+  not been released.
+*/
+void Arena_free(Arena_T oAArena);
+
+/*
+  Returns a block of at least ulSize bytes from oAArena, aligned for
+  any type, or NULL if memory could not be allocated.
+*/
+void *Arena_alloc(Arena_T oAArena, size_t ulSize);
+
+/*
+  Returns block pvBlock, which must have been allocated from oAArena
+  with size ulSize, to oAArena for reuse.
+*/
+void Arena_release(Arena_T oAArena, void *pvBlock, size_t ulSize);
+
+#endif
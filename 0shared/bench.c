@@ -0,0 +1,717 @@
+/*--------------------------------------------------------------------*/
+/* bench.c                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+/* clock_gettime and getrusage are POSIX, not ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "bench.h"
+
+/* The longest path any workload generates, including '\0' */
+enum { BENCH_MAX_PATH = 512 };
+
+/* The number of levels in each chain of the deep workload */
+enum { BENCH_DEEP_LEVELS = 128 };
+
+/* The most levels of directories in a random or zipf path */
+enum { BENCH_RANDOM_DEPTH = 6, BENCH_ZIPF_DEPTH = 4 };
+
+/* The number of names to choose from at each level of a random path */
+enum { BENCH_RANDOM_NAMES = 8 };
+
+/* The number of names to choose from at each level of a zipf path,
+   the most popular being chosen about 1/8 of the time */
+enum { BENCH_ZIPF_NAMES = 1000 };
+
+/* The number of times toString is timed per workload */
+enum { BENCH_TOSTRING_REPEATS = 5 };
+
+/* In the mixed parallel phase, one call in this many is an insert */
+enum { BENCH_MIX_WRITE_EVERY = 20 };
+
+/* The workloads, each a way of generating a set of paths */
+enum workload { WIDE, DEEP, RANDOM, ZIPF, FILES, NUM_WORKLOADS };
+
+/* The workloads' names, indexed by enum workload */
+static const char *apcWorkloadNames[NUM_WORKLOADS] =
+   { "wide", "deep", "random", "zipf", "files" };
+
+/* The generated paths for one run of a workload */
+struct paths {
+   /* the number of paths */
+   size_t ulCount;
+   /* the paths, all under the root "r" */
+   char **ppcPaths;
+   /* whether each path is meant to be a file */
+   boolean *pbIsFile;
+};
+
+/* The timings of every call to one operation */
+struct timings {
+   /* the operation's name, for the report */
+   const char *pcName;
+   /* the number of calls timed so far */
+   size_t ulCount;
+   /* the number of calls there is room for */
+   size_t ulCapacity;
+   /* the duration of each call, in nanoseconds */
+   unsigned long *pulNanos;
+   /* the elapsed time of all the calls, if they ran in parallel, or 0
+      if they ran one after another */
+   unsigned long ulWallNanos;
+};
+
+/* The state of the pseudo-random number generator; the same seed
+   gives the same paths on every platform */
+static uint64_t ulRandomState;
+
+/* The cumulative distribution over ranks for the zipf workload */
+static double adZipfCDF[BENCH_ZIPF_NAMES];
+
+/*--------------------------------------------------------------------*/
+
+/* Seeds the pseudo-random number generator with ulSeed. */
+static void Bench_seed(unsigned long ulSeed) {
+   ulRandomState = UINT64_C(0x9E3779B97F4A7C15) ^ ulSeed;
+   if(ulRandomState == 0)
+      ulRandomState = 1;
+}
+
+/* Returns a pseudo-random number (xorshift64*). */
+static uint64_t Bench_random(void) {
+   ulRandomState ^= ulRandomState >> 12;
+   ulRandomState ^= ulRandomState << 25;
+   ulRandomState ^= ulRandomState >> 27;
+   return ulRandomState * UINT64_C(0x2545F4914F6CDD1D);
+}
+
+/* Returns a pseudo-random number in [0, ulBound). */
+static size_t Bench_randomBelow(size_t ulBound) {
+   assert(ulBound > 0);
+
+   return (size_t) ((Bench_random() >> 11) % ulBound);
+}
+
+/* Returns a pseudo-random rank in [0, BENCH_ZIPF_NAMES), following
+   Zipf's law: rank k is chosen with probability proportional to
+   1/(k+1). */
+static size_t Bench_randomZipf(void) {
+   double dUniform;
+   size_t ulLo = 0;
+   size_t ulHi = BENCH_ZIPF_NAMES - 1;
+   size_t ulMid;
+
+   dUniform = (double) (Bench_random() >> 11) / 9007199254740992.0;
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      if(adZipfCDF[ulMid] < dUniform)
+         ulLo = ulMid + 1;
+      else
+         ulHi = ulMid;
+   }
+   return ulLo;
+}
+
+/* Fills in adZipfCDF. */
+static void Bench_initZipf(void) {
+   double dTotal = 0.0;
+   size_t i;
+
+   for(i = 0; i < BENCH_ZIPF_NAMES; i++) {
+      dTotal += 1.0 / (double) (i + 1);
+      adZipfCDF[i] = dTotal;
+   }
+   for(i = 0; i < BENCH_ZIPF_NAMES; i++)
+      adZipfCDF[i] /= dTotal;
+}
+
+/* Returns the current time, in nanoseconds since some fixed point. */
+static unsigned long Bench_now(void) {
+   struct timespec sTime;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (unsigned long) sTime.tv_sec * 1000000000UL +
+      (unsigned long) sTime.tv_nsec;
+}
+
+/* Returns the peak resident set size of the process, in kilobytes. */
+static long Bench_peakRSS(void) {
+   struct rusage sUsage;
+
+   if(getrusage(RUSAGE_SELF, &sUsage) != 0)
+      return -1;
+   return sUsage.ru_maxrss;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Appends "/" followed by cPrefix and ulNumber to the path of length
+  *pulLength in acBuffer, updating *pulLength.
+*/
+static void Bench_appendComponent(char acBuffer[], size_t *pulLength,
+                                  char cPrefix, size_t ulNumber) {
+   int iWritten;
+
+   assert(acBuffer != NULL);
+   assert(pulLength != NULL);
+
+   iWritten = sprintf(acBuffer + *pulLength, "/%c%lu", cPrefix,
+                      (unsigned long) ulNumber);
+   *pulLength += (size_t) iWritten;
+   assert(*pulLength < BENCH_MAX_PATH);
+}
+
+/*
+  Writes the ulIndex'th path of workload eWorkload into acBuffer and
+  returns whether it is a file.
+*/
+static boolean Bench_makePath(enum workload eWorkload, size_t ulIndex,
+                              char acBuffer[]) {
+   size_t ulLength;
+   size_t ulDepth;
+   size_t i;
+
+   assert(acBuffer != NULL);
+
+   strcpy(acBuffer, "r");
+   ulLength = 1;
+
+   switch(eWorkload) {
+      case WIDE:
+         /* many siblings under the root */
+         Bench_appendComponent(acBuffer, &ulLength, 'd', ulIndex);
+         return FALSE;
+
+      case DEEP:
+         /* long chains, each path one level below the previous */
+         Bench_appendComponent(acBuffer, &ulLength, 'd',
+                               ulIndex / BENCH_DEEP_LEVELS);
+         for(i = 0; i < ulIndex % BENCH_DEEP_LEVELS; i++)
+            Bench_appendComponent(acBuffer, &ulLength, 'd', 0);
+         return FALSE;
+
+      case RANDOM:
+         /* uniformly random names at uniformly random depths */
+         ulDepth = 1 + Bench_randomBelow(BENCH_RANDOM_DEPTH);
+         for(i = 0; i < ulDepth; i++)
+            Bench_appendComponent(acBuffer, &ulLength, 'd',
+                                  Bench_randomBelow(BENCH_RANDOM_NAMES));
+         return FALSE;
+
+      case ZIPF:
+         /* a few very popular names, so a few very large directories */
+         ulDepth = 1 + Bench_randomBelow(BENCH_ZIPF_DEPTH);
+         for(i = 0; i < ulDepth; i++)
+            Bench_appendComponent(acBuffer, &ulLength, 'd',
+                                  Bench_randomZipf());
+         return FALSE;
+
+      case FILES:
+         /* a distinct file in a random directory */
+         ulDepth = Bench_randomBelow(BENCH_ZIPF_DEPTH + 1);
+         for(i = 0; i < ulDepth; i++)
+            Bench_appendComponent(acBuffer, &ulLength, 'd',
+                                  Bench_randomBelow(BENCH_RANDOM_NAMES));
+         Bench_appendComponent(acBuffer, &ulLength, 'f', ulIndex);
+         return TRUE;
+
+      default:
+         assert(FALSE);
+         return FALSE;
+   }
+}
+
+/* Frees the first ulCount paths of *psPaths, and its arrays. */
+static void Bench_freePaths(struct paths *psPaths, size_t ulCount) {
+   size_t i;
+
+   assert(psPaths != NULL);
+
+   for(i = 0; i < ulCount; i++)
+      free(psPaths->ppcPaths[i]);
+   free(psPaths->ppcPaths);
+   free(psPaths->pbIsFile);
+}
+
+/*
+  Generates ulCount paths of workload eWorkload into *psPaths.
+  Returns SUCCESS, or MEMORY_ERROR if allocation fails.
+*/
+static int Bench_newPaths(enum workload eWorkload, size_t ulCount,
+                          struct paths *psPaths) {
+   char acBuffer[BENCH_MAX_PATH];
+   size_t ulLength;
+   size_t i;
+
+   assert(psPaths != NULL);
+
+   psPaths->ulCount = ulCount;
+   psPaths->ppcPaths = calloc(ulCount, sizeof(char *));
+   psPaths->pbIsFile = calloc(ulCount, sizeof(boolean));
+   if(psPaths->ppcPaths == NULL || psPaths->pbIsFile == NULL) {
+      Bench_freePaths(psPaths, 0);
+      return MEMORY_ERROR;
+   }
+
+   for(i = 0; i < ulCount; i++) {
+      psPaths->pbIsFile[i] = Bench_makePath(eWorkload, i, acBuffer);
+      ulLength = strlen(acBuffer);
+      psPaths->ppcPaths[i] = malloc(ulLength + 1);
+      if(psPaths->ppcPaths[i] == NULL) {
+         Bench_freePaths(psPaths, i);
+         return MEMORY_ERROR;
+      }
+      memcpy(psPaths->ppcPaths[i], acBuffer, ulLength + 1);
+   }
+   return SUCCESS;
+}
+
+/*
+  Fills pulOrder with a pseudo-random permutation of 0..ulCount-1.
+*/
+static void Bench_shuffle(size_t *pulOrder, size_t ulCount) {
+   size_t i;
+   size_t j;
+   size_t ulTemp;
+
+   assert(pulOrder != NULL);
+
+   for(i = 0; i < ulCount; i++)
+      pulOrder[i] = i;
+   for(i = ulCount; i > 1; i--) {
+      j = Bench_randomBelow(i);
+      ulTemp = pulOrder[i - 1];
+      pulOrder[i - 1] = pulOrder[j];
+      pulOrder[j] = ulTemp;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Prepares *psTimings to time up to ulCapacity calls to the operation
+  named pcName. Returns SUCCESS, or MEMORY_ERROR if allocation fails.
+*/
+static int Bench_newTimings(struct timings *psTimings,
+                            const char *pcName, size_t ulCapacity) {
+   assert(psTimings != NULL);
+   assert(pcName != NULL);
+
+   psTimings->pcName = pcName;
+   psTimings->ulCount = 0;
+   psTimings->ulCapacity = ulCapacity;
+   psTimings->ulWallNanos = 0;
+   psTimings->pulNanos = malloc(ulCapacity * sizeof(unsigned long) + 1);
+   if(psTimings->pulNanos == NULL)
+      return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+/* Records one call, from ulStart to ulEnd, in *psTimings. */
+static void Bench_record(struct timings *psTimings, unsigned long ulStart,
+                         unsigned long ulEnd) {
+   assert(psTimings != NULL);
+   assert(psTimings->ulCount < psTimings->ulCapacity);
+
+   psTimings->pulNanos[psTimings->ulCount] = ulEnd - ulStart;
+   psTimings->ulCount++;
+}
+
+/* Compares the durations *pvFirst and *pvSecond, for qsort. */
+static int Bench_compareNanos(const void *pvFirst,
+                              const void *pvSecond) {
+   unsigned long ulFirst = *(const unsigned long *) pvFirst;
+   unsigned long ulSecond = *(const unsigned long *) pvSecond;
+
+   return (ulFirst > ulSecond) - (ulFirst < ulSecond);
+}
+
+/*
+  Returns the duration, in microseconds, that uPercent percent of the
+  calls in *psTimings, which must be sorted, took at most.
+*/
+static double Bench_percentile(const struct timings *psTimings,
+                               unsigned uPercent) {
+   size_t ulIndex;
+
+   assert(psTimings != NULL);
+   assert(psTimings->ulCount > 0);
+
+   ulIndex = (psTimings->ulCount - 1) * uPercent / 100;
+   return (double) psTimings->pulNanos[ulIndex] / 1000.0;
+}
+
+/*
+  Prints a line of the report for the calls in *psTimings, from
+  workload pcWorkload, then frees its durations.
+*/
+static void Bench_report(struct timings *psTimings,
+                         const char *pcWorkload) {
+   unsigned long ulTotal = 0;
+   size_t i;
+
+   assert(psTimings != NULL);
+   assert(pcWorkload != NULL);
+
+   if(psTimings->ulCount > 0) {
+      for(i = 0; i < psTimings->ulCount; i++)
+         ulTotal += psTimings->pulNanos[i];
+      /* calls in parallel overlap, so their throughput is by the
+         clock on the wall */
+      if(psTimings->ulWallNanos != 0)
+         ulTotal = psTimings->ulWallNanos;
+      qsort(psTimings->pulNanos, psTimings->ulCount,
+            sizeof(unsigned long), Bench_compareNanos);
+      printf("%-8s %-9s %9lu %12.0f %9.2f %9.2f %9.2f %11.2f\n",
+             pcWorkload, psTimings->pcName,
+             (unsigned long) psTimings->ulCount,
+             ulTotal == 0 ? 0.0 :
+                (double) psTimings->ulCount * 1e9 / (double) ulTotal,
+             Bench_percentile(psTimings, 50),
+             Bench_percentile(psTimings, 90),
+             Bench_percentile(psTimings, 99),
+             Bench_percentile(psTimings, 100));
+   }
+   free(psTimings->pulNanos);
+   psTimings->pulNanos = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The operations timed in each workload */
+enum operation { INSERT, CONTAINS, PAR_READ, PAR_MIX, STAT, TOSTRING, RM,
+                 NUM_OPERATIONS };
+
+/* The operations' names, indexed by enum operation: par-read is
+   contains from several threads at once, and par-mix is the same
+   with one insert of an existing path every BENCH_MIX_WRITE_EVERY
+   calls */
+static const char *apcOperationNames[NUM_OPERATIONS] =
+   { "insert", "contains", "par-read", "par-mix", "stat", "toString",
+     "rm" };
+
+/* The work of one thread in a parallel phase */
+struct worker {
+   /* the implementation and the paths to look up */
+   const struct BenchOps *psOps;
+   const struct paths *psPaths;
+   /* the order to look the paths up in, starting at ulFirst */
+   const size_t *pulOrder;
+   size_t ulFirst;
+   /* whether to mix in inserts */
+   boolean bMixed;
+   /* the timings of this thread's calls */
+   struct timings sTimings;
+};
+
+/*
+  Looks up every path of pvWorker, a struct worker, once, timing each
+  call. Has the signature pthread_create expects.
+*/
+static void *Bench_work(void *pvWorker) {
+   struct worker *psWorker = pvWorker;
+   const struct paths *psPaths = psWorker->psPaths;
+   unsigned long ulStart;
+   size_t i;
+   size_t j;
+
+   for(i = 0; i < psPaths->ulCount; i++) {
+      j = psWorker->pulOrder[(psWorker->ulFirst + i) % psPaths->ulCount];
+      ulStart = Bench_now();
+      if(psWorker->bMixed && i % BENCH_MIX_WRITE_EVERY ==
+                             BENCH_MIX_WRITE_EVERY - 1)
+         (void) psWorker->psOps->pfInsert(psPaths->ppcPaths[j],
+                                          psPaths->pbIsFile[j]);
+      else
+         (void) psWorker->psOps->pfContains(psPaths->ppcPaths[j],
+                                            psPaths->pbIsFile[j]);
+      Bench_record(&psWorker->sTimings, ulStart, Bench_now());
+   }
+   return NULL;
+}
+
+/*
+  Runs ulThreads threads at once, each looking up every path of
+  *psPaths (mixing in inserts if bMixed), each starting at a different
+  place in pulOrder, and records all their calls and the elapsed time
+  in *psTimings. Returns SUCCESS, or MEMORY_ERROR if the threads
+  cannot be created.
+*/
+static int Bench_runParallel(const struct BenchOps *psOps,
+                             const struct paths *psPaths,
+                             const size_t *pulOrder, size_t ulThreads,
+                             boolean bMixed, struct timings *psTimings) {
+   struct worker *psWorkers;
+   pthread_t *psThreads;
+   unsigned long ulStart;
+   size_t ulStarted = 0;
+   size_t i;
+   int iStatus = SUCCESS;
+
+   assert(psOps != NULL);
+   assert(psPaths != NULL);
+   assert(pulOrder != NULL);
+   assert(psTimings != NULL);
+
+   psWorkers = calloc(ulThreads, sizeof(struct worker));
+   psThreads = calloc(ulThreads, sizeof(pthread_t));
+   if(psWorkers == NULL || psThreads == NULL) {
+      free(psWorkers);
+      free(psThreads);
+      return MEMORY_ERROR;
+   }
+
+   for(i = 0; i < ulThreads; i++) {
+      psWorkers[i].psOps = psOps;
+      psWorkers[i].psPaths = psPaths;
+      psWorkers[i].pulOrder = pulOrder;
+      psWorkers[i].ulFirst = i * psPaths->ulCount / ulThreads;
+      psWorkers[i].bMixed = bMixed;
+      /* each thread fills its own part of *psTimings */
+      psWorkers[i].sTimings = *psTimings;
+      psWorkers[i].sTimings.ulCount = 0;
+      psWorkers[i].sTimings.ulCapacity = psPaths->ulCount;
+      psWorkers[i].sTimings.pulNanos =
+         psTimings->pulNanos + i * psPaths->ulCount;
+   }
+
+   ulStart = Bench_now();
+   for(i = 0; i < ulThreads; i++) {
+      if(pthread_create(&psThreads[i], NULL, Bench_work,
+                        &psWorkers[i]) != 0) {
+         iStatus = MEMORY_ERROR;
+         break;
+      }
+      ulStarted++;
+   }
+   for(i = 0; i < ulStarted; i++)
+      (void) pthread_join(psThreads[i], NULL);
+   psTimings->ulWallNanos = Bench_now() - ulStart;
+
+   /* the parts are contiguous only if every thread finished */
+   if(iStatus == SUCCESS)
+      psTimings->ulCount = ulThreads * psPaths->ulCount;
+
+   free(psWorkers);
+   free(psThreads);
+   return iStatus;
+}
+
+/*
+  Times every operation of *psOps on the paths of *psPaths, in the
+  order of enum operation, recording into asTimings. The parallel
+  phases run only if ulThreads is more than 1 and *psOps is thread
+  safe. Returns SUCCESS, or MEMORY_ERROR if allocation fails.
+*/
+static int Bench_runOperations(const struct BenchOps *psOps,
+                               const struct paths *psPaths,
+                               size_t ulThreads,
+                               struct timings asTimings[]) {
+   size_t *pulOrder;
+   size_t i;
+   size_t j;
+   unsigned long ulStart;
+   char *pcString;
+
+   assert(psOps != NULL);
+   assert(psPaths != NULL);
+   assert(asTimings != NULL);
+
+   pulOrder = malloc(psPaths->ulCount * sizeof(size_t) + 1);
+   if(pulOrder == NULL)
+      return MEMORY_ERROR;
+
+   if(psOps->pfInit() != SUCCESS) {
+      free(pulOrder);
+      return MEMORY_ERROR;
+   }
+
+   for(i = 0; i < psPaths->ulCount; i++) {
+      ulStart = Bench_now();
+      (void) psOps->pfInsert(psPaths->ppcPaths[i],
+                             psPaths->pbIsFile[i]);
+      Bench_record(&asTimings[INSERT], ulStart, Bench_now());
+   }
+
+   Bench_shuffle(pulOrder, psPaths->ulCount);
+   for(i = 0; i < psPaths->ulCount; i++) {
+      j = pulOrder[i];
+      ulStart = Bench_now();
+      (void) psOps->pfContains(psPaths->ppcPaths[j],
+                               psPaths->pbIsFile[j]);
+      Bench_record(&asTimings[CONTAINS], ulStart, Bench_now());
+   }
+
+   if(ulThreads > 1 && psOps->bIsThreadSafe) {
+      if(Bench_runParallel(psOps, psPaths, pulOrder, ulThreads, FALSE,
+                           &asTimings[PAR_READ]) != SUCCESS ||
+         Bench_runParallel(psOps, psPaths, pulOrder, ulThreads, TRUE,
+                           &asTimings[PAR_MIX]) != SUCCESS) {
+         (void) psOps->pfDestroy();
+         free(pulOrder);
+         return MEMORY_ERROR;
+      }
+   }
+
+   if(psOps->pfStat != NULL) {
+      for(i = 0; i < psPaths->ulCount; i++) {
+         j = pulOrder[i];
+         ulStart = Bench_now();
+         (void) psOps->pfStat(psPaths->ppcPaths[j]);
+         Bench_record(&asTimings[STAT], ulStart, Bench_now());
+      }
+   }
+
+   for(i = 0; i < BENCH_TOSTRING_REPEATS; i++) {
+      ulStart = Bench_now();
+      pcString = psOps->pfToString();
+      Bench_record(&asTimings[TOSTRING], ulStart, Bench_now());
+      free(pcString);
+   }
+
+   /* removing an ancestor first makes later removals miss */
+   Bench_shuffle(pulOrder, psPaths->ulCount);
+   for(i = 0; i < psPaths->ulCount; i++) {
+      j = pulOrder[i];
+      ulStart = Bench_now();
+      (void) psOps->pfRm(psPaths->ppcPaths[j], psPaths->pbIsFile[j]);
+      Bench_record(&asTimings[RM], ulStart, Bench_now());
+   }
+
+   (void) psOps->pfDestroy();
+   free(pulOrder);
+   return SUCCESS;
+}
+
+/*
+  Generates ulCount paths of workload eWorkload, times *psOps on them
+  (using ulThreads threads in the parallel phases), and prints the
+  report. Returns SUCCESS, or MEMORY_ERROR if
+  allocation fails.
+*/
+static int Bench_runWorkload(const struct BenchOps *psOps,
+                             enum workload eWorkload, size_t ulCount,
+                             size_t ulThreads) {
+   struct paths sPaths;
+   struct timings asTimings[NUM_OPERATIONS];
+   size_t ulCapacity;
+   int iStatus;
+   int i;
+
+   assert(psOps != NULL);
+
+   iStatus = Bench_newPaths(eWorkload, ulCount, &sPaths);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(i = 0; i < NUM_OPERATIONS; i++) {
+      if(i == TOSTRING)
+         ulCapacity = BENCH_TOSTRING_REPEATS;
+      else if(i == PAR_READ || i == PAR_MIX)
+         ulCapacity = ulCount * ulThreads;
+      else
+         ulCapacity = ulCount;
+      iStatus = Bench_newTimings(&asTimings[i], apcOperationNames[i],
+                                 ulCapacity);
+      if(iStatus != SUCCESS) {
+         while(i > 0) {
+            i--;
+            free(asTimings[i].pulNanos);
+         }
+         Bench_freePaths(&sPaths, sPaths.ulCount);
+         return iStatus;
+      }
+   }
+
+   iStatus = Bench_runOperations(psOps, &sPaths, ulThreads, asTimings);
+
+   for(i = 0; i < NUM_OPERATIONS; i++)
+      Bench_report(&asTimings[i], apcWorkloadNames[eWorkload]);
+   if(iStatus == SUCCESS) {
+      printf("%-8s peak RSS so far: %ld KB\n",
+             apcWorkloadNames[eWorkload], Bench_peakRSS());
+      if(psOps->pfReport != NULL)
+         psOps->pfReport(apcWorkloadNames[eWorkload]);
+   }
+
+   Bench_freePaths(&sPaths, sPaths.ulCount);
+   return iStatus;
+}
+
+/*
+  Parses pcArg as an unsigned number into *pulResult. Returns TRUE if
+  successful, or FALSE if pcArg is not a number.
+*/
+static boolean Bench_parseNumber(const char *pcArg,
+                                 unsigned long *pulResult) {
+   char *pcEnd;
+
+   assert(pcArg != NULL);
+   assert(pulResult != NULL);
+
+   *pulResult = strtoul(pcArg, &pcEnd, 10);
+   return (boolean) (*pcArg != '\0' && *pcEnd == '\0');
+}
+
+/*--------------------------------------------------------------------*/
+
+int Bench_main(int argc, char *argv[], const struct BenchOps *psOps) {
+   const char *pcWorkload = "all";
+   unsigned long ulCount = 20000;
+   unsigned long ulSeed = 1;
+   unsigned long ulThreads = 1;
+   boolean bFound = FALSE;
+   int i;
+
+   assert(argv != NULL);
+   assert(psOps != NULL);
+
+   if(argc > 1)
+      pcWorkload = argv[1];
+   if(argc > 5 ||
+      (argc > 2 && !Bench_parseNumber(argv[2], &ulCount)) ||
+      (argc > 3 && !Bench_parseNumber(argv[3], &ulSeed)) ||
+      (argc > 4 && (!Bench_parseNumber(argv[4], &ulThreads) ||
+                    ulThreads == 0))) {
+      fprintf(stderr, "Usage: %s [workload [count [seed [threads]]]]\n",
+              argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   Bench_initZipf();
+   printf("%s: %lu paths per workload, seed %lu, %lu threads, "
+          "times in us\n", psOps->pcName, ulCount, ulSeed, ulThreads);
+   printf("%-8s %-9s %9s %12s %9s %9s %9s %11s\n", "workload", "op",
+          "calls", "ops/sec", "p50", "p90", "p99", "max");
+
+   for(i = 0; i < NUM_WORKLOADS; i++) {
+      if(strcmp(pcWorkload, "all") && strcmp(pcWorkload,
+                                             apcWorkloadNames[i]))
+         continue;
+      bFound = TRUE;
+      Bench_seed(ulSeed);
+      if(Bench_runWorkload(psOps, (enum workload) i, (size_t) ulCount,
+                           (size_t) ulThreads) != SUCCESS) {
+         fprintf(stderr, "%s: out of memory\n", argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+
+   if(!bFound) {
+      fprintf(stderr, "%s: unknown workload %s "
+              "(wide, deep, random, zipf, files, or all)\n",
+              argv[0], pcWorkload);
+      return EXIT_FAILURE;
+   }
+   return 0;
+}
@@ -0,0 +1,64 @@
+/*--------------------------------------------------------------------*/
+/* bench.h                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef BENCH_INCLUDED
+#define BENCH_INCLUDED
+
+#include "a4def.h"
+
+/*
+  The operations of one tree implementation, as the benchmark driver
+  calls them. Each part's bench driver adapts its own interface (DT,
+  BDT, or FT) to this one. Implementations without files ignore
+  bIsFile (every path is a directory), and those without a stat
+  operation leave pfStat NULL.
+*/
+struct BenchOps {
+   /* the name of the implementation, for the report */
+   const char *pcName;
+   /* sets the tree to an initialized, empty state */
+   int (*pfInit)(void);
+   /* removes everything and returns the tree to uninitialized */
+   int (*pfDestroy)(void);
+   /* inserts pcPath, as a file if bIsFile */
+   int (*pfInsert)(const char *pcPath, boolean bIsFile);
+   /* returns whether pcPath is in the tree, as a file if bIsFile */
+   boolean (*pfContains)(const char *pcPath, boolean bIsFile);
+   /* removes pcPath (a file if bIsFile) and anything below it */
+   int (*pfRm)(const char *pcPath, boolean bIsFile);
+   /* looks up pcPath's type and size, or NULL if not supported */
+   int (*pfStat)(const char *pcPath);
+   /* returns the tree's string representation, owned by the caller */
+   char *(*pfToString)(void);
+   /* whether pfInsert and pfContains may be called from several
+      threads at once */
+   boolean bIsThreadSafe;
+   /* prints the implementation's own counters for the workload just
+      run, each line starting with pcWorkload, or NULL if it has
+      none */
+   void (*pfReport)(const char *pcWorkload);
+};
+
+/*
+  Runs the benchmark on the implementation whose operations are
+  *psOps, with command-line arguments argc and argv:
+     [workload [count [seed [threads]]]]
+  where workload is one of wide, deep, random, zipf, files, or all
+  (the default), count is the number of paths per workload (default
+  20000), seed seeds the path generator (default 1), and threads is
+  the number of threads for the parallel phases (default 1, for
+  none).
+  For each workload, times every insert, contains, stat, rm, and
+  toString call, and prints throughput, latency percentiles, the
+  process's peak resident set size, and anything pfReport adds to
+  stdout. If threads is more than
+  1 and the implementation is thread safe, also times contains calls
+  from that many threads at once, alone and mixed with inserts.
+  Returns 0 (EXIT_SUCCESS) if successful, or EXIT_FAILURE if the
+  arguments are malformed or memory runs out.
+*/
+int Bench_main(int argc, char *argv[], const struct BenchOps *psOps);
+
+#endif
@@ -0,0 +1,143 @@
+/*--------------------------------------------------------------------*/
+/* bloom.c                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
+#include "bloom.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The number of bits per key a filter is sized for, and the number of
+   bits each key sets: together, about 1% false positives at capacity */
+enum { BLOOM_BITS_PER_KEY = 10, BLOOM_HASHES = 7 };
+
+/* The fewest bits a filter has, a power of 2 */
+enum { BLOOM_MIN_BITS = 512 };
+
+/* The number of bits in a word of the bit array */
+enum { BLOOM_WORD_BITS = CHAR_BIT * sizeof(size_t) };
+
+struct Bloom {
+   /* the number of keys the filter was sized for */
+   size_t ulCapacity;
+   /* the number of bits, a power of 2 */
+   size_t ulBits;
+   /* the bits, which threads may set at the same time:
+      ulBits / BLOOM_WORD_BITS words, allocated with the struct */
+   size_t aulWords[1];
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns ulHash with its bits mixed, so that every bit of the result
+  depends on every bit of ulHash (client hash codes are often
+  polynomials, whose low bits depend only on the keys' low bits).
+  This is the 64-bit finalizer of MurmurHash3, so the mixing reaches
+  the high half of a 64-bit size_t too.
+*/
+static size_t Bloom_mix(size_t ulHash) {
+   uint64_t ulMixed = (uint64_t) ulHash;
+
+   ulMixed ^= ulMixed >> 33;
+   ulMixed *= UINT64_C(0xff51afd7ed558ccd);
+   ulMixed ^= ulMixed >> 33;
+   ulMixed *= UINT64_C(0xc4ceb9fe1a85ec53);
+   ulMixed ^= ulMixed >> 33;
+   return (size_t) ulMixed;
+}
+
+/*
+  Sets *pulFirst and *pulStep so that the bits of the key with hash
+  codes ulHash1 and ulHash2 are *pulFirst, *pulFirst + *pulStep, ...
+  (modulo the number of bits). The step is odd, so it never repeats a
+  bit before visiting every one.
+*/
+static void Bloom_probe(size_t ulHash1, size_t ulHash2,
+                        size_t *pulFirst, size_t *pulStep) {
+   assert(pulFirst != NULL);
+   assert(pulStep != NULL);
+
+   *pulFirst = Bloom_mix(ulHash1);
+   *pulStep = Bloom_mix(ulHash2) | 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+Bloom_T Bloom_new(size_t ulCapacity) {
+   Bloom_T oBFilter;
+   size_t ulBits = BLOOM_MIN_BITS;
+
+   while(ulBits < ulCapacity * BLOOM_BITS_PER_KEY)
+      ulBits *= 2;
+
+   oBFilter = calloc(1, offsetof(struct Bloom, aulWords) +
+                     ulBits / BLOOM_WORD_BITS * sizeof(size_t));
+   if(oBFilter == NULL)
+      return NULL;
+   oBFilter->ulCapacity = ulCapacity;
+   oBFilter->ulBits = ulBits;
+   return oBFilter;
+}
+
+void Bloom_free(Bloom_T oBFilter) {
+   free(oBFilter);
+}
+
+void Bloom_add(Bloom_T oBFilter, size_t ulHash1, size_t ulHash2) {
+   size_t ulBit;
+   size_t ulStep;
+   size_t i;
+
+   assert(oBFilter != NULL);
+
+   Bloom_probe(ulHash1, ulHash2, &ulBit, &ulStep);
+   for(i = 0; i < BLOOM_HASHES; i++) {
+      ulBit &= oBFilter->ulBits - 1;
+      (void) __atomic_fetch_or(&oBFilter->aulWords[ulBit /
+                                                   BLOOM_WORD_BITS],
+                               (size_t) 1 << (ulBit % BLOOM_WORD_BITS),
+                               __ATOMIC_RELAXED);
+      ulBit += ulStep;
+   }
+}
+
+boolean Bloom_mayContain(Bloom_T oBFilter, size_t ulHash1,
+                         size_t ulHash2) {
+   size_t ulBit;
+   size_t ulStep;
+   size_t ulWord;
+   size_t i;
+
+   assert(oBFilter != NULL);
+
+   Bloom_probe(ulHash1, ulHash2, &ulBit, &ulStep);
+   for(i = 0; i < BLOOM_HASHES; i++) {
+      ulBit &= oBFilter->ulBits - 1;
+      ulWord = __atomic_load_n(&oBFilter->aulWords[ulBit /
+                                                   BLOOM_WORD_BITS],
+                               __ATOMIC_RELAXED);
+      if((ulWord & ((size_t) 1 << (ulBit % BLOOM_WORD_BITS))) == 0)
+         return FALSE;
+      ulBit += ulStep;
+   }
+   return TRUE;
+}
+
+size_t Bloom_getCapacity(Bloom_T oBFilter) {
+   assert(oBFilter != NULL);
+
+   return oBFilter->ulCapacity;
+}
+
+size_t Bloom_getBytes(Bloom_T oBFilter) {
+   assert(oBFilter != NULL);
+
+   return offsetof(struct Bloom, aulWords) +
+      oBFilter->ulBits / BLOOM_WORD_BITS * sizeof(size_t);
+}
@@ -0,0 +1,54 @@
+/*--------------------------------------------------------------------*/
+/* bloom.h                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef BLOOM_INCLUDED
+#define BLOOM_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A Bloom_T is a Bloom filter: a fixed array of bits summarizing a set
+  of keys, which answers whether a key may be in the set without
+  storing the keys themselves. A key that was added is always
+  reported as possibly present; a key that was not is usually
+  reported as absent, but may be reported as possibly present (a
+  false positive), more often the more keys the filter holds beyond
+  its capacity. Keys cannot be removed, so a client whose set shrinks
+  builds a new filter instead.
+  A key is given by two hash codes of it, computed by the client with
+  two unrelated hash functions.
+  Bloom_add and Bloom_mayContain may be called from several threads at
+  once on the same filter.
+*/
+typedef struct Bloom *Bloom_T;
+
+/*
+  Returns a new, empty filter sized to keep false positives below
+  about 1% while it holds at most ulCapacity keys, or NULL if memory
+  could not be allocated.
+*/
+Bloom_T Bloom_new(size_t ulCapacity);
+
+/* Frees oBFilter. */
+void Bloom_free(Bloom_T oBFilter);
+
+/* Adds the key with hash codes ulHash1 and ulHash2 to oBFilter. */
+void Bloom_add(Bloom_T oBFilter, size_t ulHash1, size_t ulHash2);
+
+/*
+  Returns FALSE if the key with hash codes ulHash1 and ulHash2 is
+  certainly not in oBFilter, and TRUE if it may be.
+*/
+boolean Bloom_mayContain(Bloom_T oBFilter, size_t ulHash1,
+                         size_t ulHash2);
+
+/* Returns the number of keys oBFilter was sized for. */
+size_t Bloom_getCapacity(Bloom_T oBFilter);
+
+/* Returns the number of bytes of memory oBFilter takes. */
+size_t Bloom_getBytes(Bloom_T oBFilter);
+
+#endif
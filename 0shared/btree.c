@@ -0,0 +1,836 @@
+/*--------------------------------------------------------------------*/
+/* btree.c                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#include "btree.h"
+#include "arena.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The elements are stored in order in the leaves of a B+-tree, all of
+   which are at the same depth.  Each internal node records, for each
+   of its children, the number of elements in that child's subtree
+   (so that elements can be found by index) and the subtree's first
+   element (so that elements can be found by binary search).  Nodes
+   are sized in whole 64-byte cache lines: a leaf fills two, and an
+   internal node four. */
+
+enum {
+   /* The maximum number of elements in a leaf. */
+   LEAF_LENGTH = 15,
+
+   /* The maximum number of children of an internal node. */
+   INNER_LENGTH = 10,
+
+   /* The minimum number of elements in a leaf other than the root. */
+   LEAF_MIN_LENGTH = LEAF_LENGTH / 2,
+
+   /* The minimum number of children of an internal node other than
+      the root. */
+   INNER_MIN_LENGTH = INNER_LENGTH / 2,
+
+   /* An upper bound on the height of any BTree that fits in memory. */
+   MAX_HEIGHT = 64
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A leaf holds a run of consecutive elements. */
+
+struct BTreeLeaf
+{
+   /* The number of elements in the leaf. */
+   size_t uLength;
+
+   /* The elements in the leaf. */
+   const void *apvElements[LEAF_LENGTH];
+};
+
+/* An internal node holds a run of consecutive subtrees. */
+
+struct BTreeInner
+{
+   /* The number of children of the node. */
+   size_t uLength;
+
+   /* The number of elements in each child's subtree. */
+   size_t auCounts[INNER_LENGTH];
+
+   /* The first element in each child's subtree. */
+   const void *apvFirsts[INNER_LENGTH];
+
+   /* The children, which are leaves iff this node has height 1. */
+   void *apvChildren[INNER_LENGTH];
+};
+
+/* A BTree consists of a root, the height of the tree (0 if the root
+   is a leaf), and the number of elements in the tree. */
+
+struct BTree
+{
+   /* The number of elements in the BTree. */
+   size_t uLength;
+
+   /* The number of internal nodes on every path from the root to a
+      leaf. */
+   size_t uHeight;
+
+   /* The root node, which is a leaf iff uHeight is 0. */
+   void *pvRoot;
+
+   /* The arena that the nodes come from, or NULL for the heap. */
+   Arena_T oAArena;
+};
+
+/*--------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+
+/* Check the invariants of oBTree.  Return 1 (TRUE) iff oBTree
+   is in a valid state. */
+
+static int BTree_isValid(BTree_T oBTree)
+{
+   if (oBTree->pvRoot == NULL) return 0;
+   if (oBTree->uHeight >= MAX_HEIGHT) return 0;
+   if (oBTree->uHeight > 0 &&
+       ((struct BTreeInner*)oBTree->pvRoot)->uLength < 2) return 0;
+   return 1;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new block of uSize bytes from oAArena, or from the heap if
+   oAArena is NULL, or NULL if insufficient memory is available. */
+
+static void *BTree_alloc(Arena_T oAArena, size_t uSize)
+{
+   if (oAArena != NULL)
+      return Arena_alloc(oAArena, uSize);
+   return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the block pvBlock of uSize bytes that BTree_alloc returned
+   for oAArena. */
+
+static void BTree_release(Arena_T oAArena, void *pvBlock, size_t uSize)
+{
+   if (oAArena != NULL)
+      Arena_release(oAArena, pvBlock, uSize);
+   else
+      free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of elements or children in the node pvNode,
+   whose height is uHeight. */
+
+static size_t BTree_nodeLength(const void *pvNode, size_t uHeight)
+{
+   assert(pvNode != NULL);
+
+   if (uHeight == 0)
+      return ((const struct BTreeLeaf*)pvNode)->uLength;
+   return ((const struct BTreeInner*)pvNode)->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first element in the subtree rooted at the non-empty
+   node pvNode, whose height is uHeight. */
+
+static const void *BTree_first(const void *pvNode, size_t uHeight)
+{
+   assert(pvNode != NULL);
+   assert(BTree_nodeLength(pvNode, uHeight) > 0);
+
+   if (uHeight == 0)
+      return ((const struct BTreeLeaf*)pvNode)->apvElements[0];
+   return ((const struct BTreeInner*)pvNode)->apvFirsts[0];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) iff the node pvNode, whose height is uHeight, has
+   no room for another element or child. */
+
+static int BTree_isFull(const void *pvNode, size_t uHeight)
+{
+   if (uHeight == 0)
+      return BTree_nodeLength(pvNode, uHeight) == LEAF_LENGTH;
+   return BTree_nodeLength(pvNode, uHeight) == INNER_LENGTH;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the child of psInner whose subtree holds the
+   *puIndex'th element of psInner's subtree, and change *puIndex to
+   that element's index within the child's subtree.  If iForAdd is 1
+   (TRUE), then *puIndex may be one past the last element, and an
+   index at the boundary between two children selects the earlier. */
+
+static size_t BTree_findChild(const struct BTreeInner *psInner,
+                              size_t *puIndex, int iForAdd)
+{
+   size_t u;
+
+   assert(psInner != NULL);
+   assert(puIndex != NULL);
+
+   for (u = 0; u < psInner->uLength - 1; u++)
+   {
+      if (*puIndex < psInner->auCounts[u] ||
+          (iForAdd && *puIndex == psInner->auCounts[u]))
+         break;
+      *puIndex -= psInner->auCounts[u];
+   }
+   return u;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Insert, at index uIndex among psInner's children, the child pvChild
+   whose subtree holds uCount elements starting with pvFirst.
+   psInner must not be full. */
+
+static void BTree_insertChild(struct BTreeInner *psInner, size_t uIndex,
+                              void *pvChild, size_t uCount,
+                              const void *pvFirst)
+{
+   size_t uMove;
+
+   assert(psInner != NULL);
+   assert(psInner->uLength < INNER_LENGTH);
+   assert(uIndex <= psInner->uLength);
+
+   uMove = psInner->uLength - uIndex;
+   memmove(&psInner->auCounts[uIndex + 1], &psInner->auCounts[uIndex],
+           uMove * sizeof(size_t));
+   memmove(&psInner->apvFirsts[uIndex + 1], &psInner->apvFirsts[uIndex],
+           uMove * sizeof(void*));
+   memmove(&psInner->apvChildren[uIndex + 1],
+           &psInner->apvChildren[uIndex], uMove * sizeof(void*));
+   psInner->auCounts[uIndex] = uCount;
+   psInner->apvFirsts[uIndex] = pvFirst;
+   psInner->apvChildren[uIndex] = pvChild;
+   psInner->uLength++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the uIndex'th child from psInner's children. */
+
+static void BTree_removeChild(struct BTreeInner *psInner, size_t uIndex)
+{
+   size_t uMove;
+
+   assert(psInner != NULL);
+   assert(uIndex < psInner->uLength);
+
+   psInner->uLength--;
+   uMove = psInner->uLength - uIndex;
+   memmove(&psInner->auCounts[uIndex], &psInner->auCounts[uIndex + 1],
+           uMove * sizeof(size_t));
+   memmove(&psInner->apvFirsts[uIndex], &psInner->apvFirsts[uIndex + 1],
+           uMove * sizeof(void*));
+   memmove(&psInner->apvChildren[uIndex],
+           &psInner->apvChildren[uIndex + 1], uMove * sizeof(void*));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Split the full uIndex'th child of psInner, whose height is
+   uChildHeight, moving its upper half into a new node that becomes
+   the (uIndex+1)'th child, allocated from oAArena.  psInner must not
+   be full.  Return 1 (TRUE) if successful, or 0 (FALSE) if
+   insufficient memory is available, in which case psInner is
+   unchanged. */
+
+static int BTree_splitChild(Arena_T oAArena, struct BTreeInner *psInner,
+                            size_t uIndex, size_t uChildHeight)
+{
+   size_t uKeep;
+   size_t uMove;
+   size_t uMovedCount = 0;
+   size_t u;
+
+   assert(psInner != NULL);
+   assert(uIndex < psInner->uLength);
+   assert(BTree_isFull(psInner->apvChildren[uIndex], uChildHeight));
+
+   if (uChildHeight == 0)
+   {
+      struct BTreeLeaf *psLeft = psInner->apvChildren[uIndex];
+      struct BTreeLeaf *psRight;
+
+      psRight = (struct BTreeLeaf*)
+         BTree_alloc(oAArena, sizeof(struct BTreeLeaf));
+      if (psRight == NULL)
+         return 0;
+
+      uKeep = psLeft->uLength / 2;
+      uMove = psLeft->uLength - uKeep;
+      memcpy(psRight->apvElements, &psLeft->apvElements[uKeep],
+             uMove * sizeof(void*));
+      psRight->uLength = uMove;
+      psLeft->uLength = uKeep;
+      uMovedCount = uMove;
+
+      psInner->auCounts[uIndex] -= uMovedCount;
+      BTree_insertChild(psInner, uIndex + 1, psRight, uMovedCount,
+                        psRight->apvElements[0]);
+   }
+   else
+   {
+      struct BTreeInner *psLeft = psInner->apvChildren[uIndex];
+      struct BTreeInner *psRight;
+
+      psRight = (struct BTreeInner*)
+         BTree_alloc(oAArena, sizeof(struct BTreeInner));
+      if (psRight == NULL)
+         return 0;
+
+      uKeep = psLeft->uLength / 2;
+      uMove = psLeft->uLength - uKeep;
+      memcpy(psRight->auCounts, &psLeft->auCounts[uKeep],
+             uMove * sizeof(size_t));
+      memcpy(psRight->apvFirsts, &psLeft->apvFirsts[uKeep],
+             uMove * sizeof(void*));
+      memcpy(psRight->apvChildren, &psLeft->apvChildren[uKeep],
+             uMove * sizeof(void*));
+      psRight->uLength = uMove;
+      psLeft->uLength = uKeep;
+      for (u = 0; u < uMove; u++)
+         uMovedCount += psRight->auCounts[u];
+
+      psInner->auCounts[uIndex] -= uMovedCount;
+      BTree_insertChild(psInner, uIndex + 1, psRight, uMovedCount,
+                        psRight->apvFirsts[0]);
+   }
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Even out the leaves that are the uLeft'th and (uLeft+1)'th children
+   of psInner, one of which has too few elements: if all of their
+   elements fit in one leaf, then merge them into the first and free
+   the second back to oAArena; otherwise split the elements evenly
+   between them. */
+
+static void BTree_rebalanceLeaves(Arena_T oAArena,
+                                  struct BTreeInner *psInner,
+                                  size_t uLeft)
+{
+   struct BTreeLeaf *psLeft;
+   struct BTreeLeaf *psRight;
+   const void *apvAll[2 * LEAF_LENGTH];
+   size_t uTotal;
+   size_t uKeep;
+
+   assert(psInner != NULL);
+   assert(uLeft + 1 < psInner->uLength);
+
+   psLeft = psInner->apvChildren[uLeft];
+   psRight = psInner->apvChildren[uLeft + 1];
+   uTotal = psLeft->uLength + psRight->uLength;
+   memcpy(apvAll, psLeft->apvElements, psLeft->uLength * sizeof(void*));
+   memcpy(&apvAll[psLeft->uLength], psRight->apvElements,
+          psRight->uLength * sizeof(void*));
+
+   if (uTotal <= LEAF_LENGTH)
+   {
+      memcpy(psLeft->apvElements, apvAll, uTotal * sizeof(void*));
+      psLeft->uLength = uTotal;
+      psInner->auCounts[uLeft] = uTotal;
+      BTree_release(oAArena, psRight, sizeof(struct BTreeLeaf));
+      BTree_removeChild(psInner, uLeft + 1);
+      return;
+   }
+
+   uKeep = uTotal / 2;
+   memcpy(psLeft->apvElements, apvAll, uKeep * sizeof(void*));
+   memcpy(psRight->apvElements, &apvAll[uKeep],
+          (uTotal - uKeep) * sizeof(void*));
+   psLeft->uLength = uKeep;
+   psRight->uLength = uTotal - uKeep;
+   psInner->auCounts[uLeft] = uKeep;
+   psInner->auCounts[uLeft + 1] = uTotal - uKeep;
+   psInner->apvFirsts[uLeft + 1] = psRight->apvElements[0];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Even out the internal nodes that are the uLeft'th and (uLeft+1)'th
+   children of psInner, one of which has too few children: if all of
+   their children fit in one node, then merge them into the first and
+   free the second back to oAArena; otherwise split the children
+   evenly between them. */
+
+static void BTree_rebalanceInners(Arena_T oAArena,
+                                  struct BTreeInner *psInner,
+                                  size_t uLeft)
+{
+   struct BTreeInner *psLeft;
+   struct BTreeInner *psRight;
+   struct BTreeInner *psFrom;
+   struct BTreeInner *psTo;
+   size_t uTotal;
+   size_t uKeep;
+   size_t uMove;
+   size_t uMovedCount = 0;
+   size_t u;
+
+   assert(psInner != NULL);
+   assert(uLeft + 1 < psInner->uLength);
+
+   psLeft = psInner->apvChildren[uLeft];
+   psRight = psInner->apvChildren[uLeft + 1];
+   uTotal = psLeft->uLength + psRight->uLength;
+
+   if (uTotal <= INNER_LENGTH)
+   {
+      for (u = 0; u < psRight->uLength; u++)
+         BTree_insertChild(psLeft, psLeft->uLength,
+                           psRight->apvChildren[u],
+                           psRight->auCounts[u],
+                           psRight->apvFirsts[u]);
+      psInner->auCounts[uLeft] += psInner->auCounts[uLeft + 1];
+      BTree_release(oAArena, psRight, sizeof(struct BTreeInner));
+      BTree_removeChild(psInner, uLeft + 1);
+      return;
+   }
+
+   /* Move children one at a time from the longer node to the
+      shorter, at the end where the two nodes meet. */
+   uKeep = uTotal / 2;
+   if (psLeft->uLength > uKeep)
+   {
+      psFrom = psLeft;
+      psTo = psRight;
+      uMove = psLeft->uLength - uKeep;
+      for (u = 0; u < uMove; u++)
+      {
+         size_t uLast = psFrom->uLength - 1;
+         uMovedCount += psFrom->auCounts[uLast];
+         BTree_insertChild(psTo, 0, psFrom->apvChildren[uLast],
+                           psFrom->auCounts[uLast],
+                           psFrom->apvFirsts[uLast]);
+         BTree_removeChild(psFrom, uLast);
+      }
+      psInner->auCounts[uLeft] -= uMovedCount;
+      psInner->auCounts[uLeft + 1] += uMovedCount;
+   }
+   else
+   {
+      psFrom = psRight;
+      psTo = psLeft;
+      uMove = uKeep - psLeft->uLength;
+      for (u = 0; u < uMove; u++)
+      {
+         uMovedCount += psFrom->auCounts[0];
+         BTree_insertChild(psTo, psTo->uLength, psFrom->apvChildren[0],
+                           psFrom->auCounts[0], psFrom->apvFirsts[0]);
+         BTree_removeChild(psFrom, 0);
+      }
+      psInner->auCounts[uLeft] += uMovedCount;
+      psInner->auCounts[uLeft + 1] -= uMovedCount;
+   }
+   psInner->apvFirsts[uLeft + 1] = psRight->apvFirsts[0];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove and return the uIndex'th element of the subtree rooted at
+   pvNode, whose height is uHeight, rebalancing any child of pvNode
+   that is left with too few elements or children.  Nodes freed by
+   rebalancing go back to oAArena. */
+
+static const void *BTree_removeFrom(Arena_T oAArena, void *pvNode,
+                                    size_t uHeight, size_t uIndex)
+{
+   struct BTreeInner *psInner;
+   void *pvChild;
+   const void *pvElement;
+   size_t uChild;
+   size_t uChildLength;
+
+   assert(pvNode != NULL);
+
+   if (uHeight == 0)
+   {
+      struct BTreeLeaf *psLeaf = pvNode;
+
+      assert(uIndex < psLeaf->uLength);
+      pvElement = psLeaf->apvElements[uIndex];
+      psLeaf->uLength--;
+      memmove(&psLeaf->apvElements[uIndex],
+              &psLeaf->apvElements[uIndex + 1],
+              (psLeaf->uLength - uIndex) * sizeof(void*));
+      return pvElement;
+   }
+
+   psInner = pvNode;
+   uChild = BTree_findChild(psInner, &uIndex, 0);
+   pvChild = psInner->apvChildren[uChild];
+   pvElement = BTree_removeFrom(oAArena, pvChild, uHeight - 1, uIndex);
+   psInner->auCounts[uChild]--;
+
+   uChildLength = BTree_nodeLength(pvChild, uHeight - 1);
+   if (uChildLength > 0)
+      psInner->apvFirsts[uChild] = BTree_first(pvChild, uHeight - 1);
+
+   if (uHeight - 1 == 0 && uChildLength < LEAF_MIN_LENGTH)
+      BTree_rebalanceLeaves(oAArena, psInner,
+                            uChild > 0 ? uChild - 1 : 0);
+   else if (uHeight - 1 > 0 && uChildLength < INNER_MIN_LENGTH)
+      BTree_rebalanceInners(oAArena, psInner,
+                            uChild > 0 ? uChild - 1 : 0);
+
+   return pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the subtree rooted at pvNode, whose height is uHeight, back
+   to oAArena. */
+
+static void BTree_freeNode(Arena_T oAArena, void *pvNode, size_t uHeight)
+{
+   size_t u;
+
+   assert(pvNode != NULL);
+
+   if (uHeight > 0)
+   {
+      struct BTreeInner *psInner = pvNode;
+      for (u = 0; u < psInner->uLength; u++)
+         BTree_freeNode(oAArena, psInner->apvChildren[u], uHeight - 1);
+      BTree_release(oAArena, pvNode, sizeof(struct BTreeInner));
+   }
+   else
+      BTree_release(oAArena, pvNode, sizeof(struct BTreeLeaf));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply function *pfApply to each element of the subtree rooted at
+   pvNode, whose height is uHeight, in order, passing pvExtra as an
+   extra argument. */
+
+static void BTree_mapNode(void *pvNode, size_t uHeight,
+                          void (*pfApply)(void *pvElement,
+                                          void *pvExtra),
+                          const void *pvExtra)
+{
+   size_t u;
+
+   assert(pvNode != NULL);
+   assert(pfApply != NULL);
+
+   if (uHeight == 0)
+   {
+      struct BTreeLeaf *psLeaf = pvNode;
+      for (u = 0; u < psLeaf->uLength; u++)
+         (*pfApply)((void*)psLeaf->apvElements[u], (void*)pvExtra);
+   }
+   else
+   {
+      struct BTreeInner *psInner = pvNode;
+      for (u = 0; u < psInner->uLength; u++)
+         BTree_mapNode(psInner->apvChildren[u], uHeight - 1,
+                       pfApply, pvExtra);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+BTree_T BTree_new(void)
+{
+   return BTree_newIn(NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+BTree_T BTree_newIn(Arena_T oAArena)
+{
+   BTree_T oBTree;
+   struct BTreeLeaf *psLeaf;
+
+   oBTree = (struct BTree*)BTree_alloc(oAArena, sizeof(struct BTree));
+   if (oBTree == NULL)
+      return NULL;
+
+   psLeaf = (struct BTreeLeaf*)
+      BTree_alloc(oAArena, sizeof(struct BTreeLeaf));
+   if (psLeaf == NULL)
+   {
+      BTree_release(oAArena, oBTree, sizeof(struct BTree));
+      return NULL;
+   }
+   psLeaf->uLength = 0;
+
+   oBTree->uLength = 0;
+   oBTree->uHeight = 0;
+   oBTree->pvRoot = psLeaf;
+   oBTree->oAArena = oAArena;
+   return oBTree;
+}
+
+/*--------------------------------------------------------------------*/
+
+void BTree_free(BTree_T oBTree)
+{
+   assert(oBTree != NULL);
+   assert(BTree_isValid(oBTree));
+
+   BTree_freeNode(oBTree->oAArena, oBTree->pvRoot, oBTree->uHeight);
+   BTree_release(oBTree->oAArena, oBTree, sizeof(struct BTree));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t BTree_getLength(BTree_T oBTree)
+{
+   assert(oBTree != NULL);
+   assert(BTree_isValid(oBTree));
+
+   return oBTree->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *BTree_get(BTree_T oBTree, size_t uIndex)
+{
+   void *pvNode;
+   size_t uHeight;
+   size_t uChild;
+
+   assert(oBTree != NULL);
+   assert(uIndex < oBTree->uLength);
+   assert(BTree_isValid(oBTree));
+
+   pvNode = oBTree->pvRoot;
+   for (uHeight = oBTree->uHeight; uHeight > 0; uHeight--)
+   {
+      uChild = BTree_findChild(pvNode, &uIndex, 0);
+      pvNode = ((struct BTreeInner*)pvNode)->apvChildren[uChild];
+   }
+   return (void*)((struct BTreeLeaf*)pvNode)->apvElements[uIndex];
+}
+
+/*--------------------------------------------------------------------*/
+
+int BTree_addAt(BTree_T oBTree, size_t uIndex, const void *pvElement)
+{
+   /* The internal nodes passed through, and the child taken at each. */
+   struct BTreeInner *apsPath[MAX_HEIGHT];
+   size_t auPathChild[MAX_HEIGHT];
+   size_t uDepth = 0;
+   size_t uHeight;
+   size_t uChild;
+   void *pvNode;
+   struct BTreeInner *psInner;
+   struct BTreeLeaf *psLeaf;
+
+   assert(oBTree != NULL);
+   assert(uIndex <= oBTree->uLength);
+   assert(BTree_isValid(oBTree));
+
+   /* A full root is split under a new root, growing the tree. */
+   if (BTree_isFull(oBTree->pvRoot, oBTree->uHeight))
+   {
+      if (oBTree->uHeight + 1 >= MAX_HEIGHT)
+         return 0;
+      psInner = (struct BTreeInner*)
+         BTree_alloc(oBTree->oAArena, sizeof(struct BTreeInner));
+      if (psInner == NULL)
+         return 0;
+      psInner->uLength = 0;
+      BTree_insertChild(psInner, 0, oBTree->pvRoot, oBTree->uLength,
+                        BTree_first(oBTree->pvRoot, oBTree->uHeight));
+      if (! BTree_splitChild(oBTree->oAArena, psInner, 0,
+                             oBTree->uHeight))
+      {
+         BTree_release(oBTree->oAArena, psInner,
+                       sizeof(struct BTreeInner));
+         return 0;
+      }
+      oBTree->pvRoot = psInner;
+      oBTree->uHeight++;
+   }
+
+   /* Descend to the leaf, splitting full nodes on the way down so
+      that the leaf and every node above it have room to spare.  A
+      failed split leaves the tree valid and its elements unchanged. */
+   pvNode = oBTree->pvRoot;
+   for (uHeight = oBTree->uHeight; uHeight > 0; uHeight--)
+   {
+      psInner = pvNode;
+      uChild = BTree_findChild(psInner, &uIndex, 1);
+      if (BTree_isFull(psInner->apvChildren[uChild], uHeight - 1))
+      {
+         if (! BTree_splitChild(oBTree->oAArena, psInner, uChild,
+                                uHeight - 1))
+            return 0;
+         if (uIndex > psInner->auCounts[uChild])
+         {
+            uIndex -= psInner->auCounts[uChild];
+            uChild++;
+         }
+      }
+      apsPath[uDepth] = psInner;
+      auPathChild[uDepth] = uChild;
+      uDepth++;
+      pvNode = psInner->apvChildren[uChild];
+   }
+
+   psLeaf = pvNode;
+   assert(psLeaf->uLength < LEAF_LENGTH);
+   memmove(&psLeaf->apvElements[uIndex + 1],
+           &psLeaf->apvElements[uIndex],
+           (psLeaf->uLength - uIndex) * sizeof(void*));
+   psLeaf->apvElements[uIndex] = pvElement;
+   psLeaf->uLength++;
+   oBTree->uLength++;
+
+   /* Update the counts and first elements along the path. */
+   uHeight = 0;
+   while (uDepth > 0)
+   {
+      uDepth--;
+      psInner = apsPath[uDepth];
+      uChild = auPathChild[uDepth];
+      psInner->auCounts[uChild]++;
+      psInner->apvFirsts[uChild] =
+         BTree_first(psInner->apvChildren[uChild], uHeight);
+      uHeight++;
+   }
+
+   assert(BTree_isValid(oBTree));
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *BTree_removeAt(BTree_T oBTree, size_t uIndex)
+{
+   const void *pvElement;
+   struct BTreeInner *psRoot;
+
+   assert(oBTree != NULL);
+   assert(uIndex < oBTree->uLength);
+   assert(BTree_isValid(oBTree));
+
+   pvElement = BTree_removeFrom(oBTree->oAArena, oBTree->pvRoot,
+                                oBTree->uHeight, uIndex);
+   oBTree->uLength--;
+
+   /* A root left with one child is replaced by that child,
+      shrinking the tree. */
+   if (oBTree->uHeight > 0)
+   {
+      psRoot = oBTree->pvRoot;
+      if (psRoot->uLength == 1)
+      {
+         oBTree->pvRoot = psRoot->apvChildren[0];
+         oBTree->uHeight--;
+         BTree_release(oBTree->oAArena, psRoot,
+                       sizeof(struct BTreeInner));
+      }
+   }
+
+   assert(BTree_isValid(oBTree));
+
+   return (void*)pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+void BTree_map(BTree_T oBTree,
+               void (*pfApply)(void *pvElement, void *pvExtra),
+               const void *pvExtra)
+{
+   assert(oBTree != NULL);
+   assert(pfApply != NULL);
+   assert(BTree_isValid(oBTree));
+
+   BTree_mapNode(oBTree->pvRoot, oBTree->uHeight, pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+int BTree_bsearch(BTree_T oBTree,
+                  void *pvSoughtElement,
+                  size_t *puIndex,
+                  int (*pfCompare)(const void *pvElement1,
+                                   const void *pvElement2))
+{
+   void *pvNode;
+   struct BTreeInner *psInner;
+   struct BTreeLeaf *psLeaf;
+   size_t uHeight;
+   size_t uOffset = 0;
+   size_t uLo;
+   size_t uHi;
+   size_t uMid;
+   size_t u;
+   int iCompare;
+
+   assert(oBTree != NULL);
+   assert(puIndex != NULL);
+   assert(pfCompare != NULL);
+   assert(BTree_isValid(oBTree));
+
+   /* In each internal node, follow the last child whose first
+      element is not greater than the sought element. */
+   pvNode = oBTree->pvRoot;
+   for (uHeight = oBTree->uHeight; uHeight > 0; uHeight--)
+   {
+      psInner = pvNode;
+      uLo = 1;
+      uHi = psInner->uLength;
+      while (uLo < uHi)
+      {
+         uMid = uLo + (uHi - uLo) / 2;
+         if ((*pfCompare)(psInner->apvFirsts[uMid], pvSoughtElement) <= 0)
+            uLo = uMid + 1;
+         else
+            uHi = uMid;
+      }
+      for (u = 0; u < uLo - 1; u++)
+         uOffset += psInner->auCounts[u];
+      pvNode = psInner->apvChildren[uLo - 1];
+   }
+
+   psLeaf = pvNode;
+   uLo = 0;
+   uHi = psLeaf->uLength;
+   while (uLo < uHi)
+   {
+      uMid = uLo + (uHi - uLo) / 2;
+      iCompare = (*pfCompare)(psLeaf->apvElements[uMid], pvSoughtElement);
+      if (iCompare == 0)
+      {
+         *puIndex = uOffset + uMid;
+         return 1;
+      }
+      if (iCompare < 0)
+         uLo = uMid + 1;
+      else
+         uHi = uMid;
+   }
+   *puIndex = uOffset + uLo;
+   return 0;
+}
@@ -4,8 +4,12 @@
 /*--------------------------------------------------------------------*/
 
 #include "dynarray.h"
+#include "dynarrayExt.h"
+#include "arena.h"
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*--------------------------------------------------------------------*/
 
@@ -16,7 +20,9 @@ static const size_t MIN_PHYS_LENGTH = 2;
 /*--------------------------------------------------------------------*/
 
 /* A DynArray consists of an array, along with its logical and
-   physical lengths. */
+   physical lengths.  The array starts out inline, in the same block
+   of memory as the DynArray itself, and moves to the heap only when
+   it must grow beyond the inline elements. */
 
 struct DynArray
 {
@@ -28,8 +34,24 @@ struct DynArray
       DynArray. */
    size_t uPhysLength;
 
-   /* The array that underlies the DynArray. */
+   /* The array that underlies the DynArray.  Either apvInline or
+      a separately allocated array. */
    const void **ppvArray;
+
+   /* 1 (TRUE) iff the DynArray lives in memory owned by the client,
+      as set up by DynArray_newInline. */
+   int iIsClientMemory;
+
+   /* The number of elements in apvInline. */
+   size_t uInlineLength;
+
+   /* The arena that the DynArray allocates from, or NULL if it
+      uses malloc. */
+   Arena_T oAArena;
+
+   /* The elements stored in the same block as the DynArray, of
+      which there are uInlineLength. */
+   const void *apvInline[1];
 };
 
 /*--------------------------------------------------------------------*/
@@ -44,6 +66,8 @@ static int DynArray_isValid(DynArray_T oDynArray)
    if (oDynArray->uPhysLength < MIN_PHYS_LENGTH) return 0;
    if (oDynArray->uLength > oDynArray->uPhysLength) return 0;
    if (oDynArray->ppvArray == NULL) return 0;
+   if (oDynArray->ppvArray == oDynArray->apvInline &&
+       oDynArray->uPhysLength != oDynArray->uInlineLength) return 0;
    return 1;
 }
 
@@ -51,24 +75,102 @@ static int DynArray_isValid(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
-/* Increase the physical length of oDynArray.  Return 1 (TRUE) if
-   successful and 0 (FALSE) if insufficient memory is available. */
+/* Return uSize bytes from oAArena, or from the heap if oAArena is
+   NULL, or NULL if insufficient memory is available.  When this
+   module is compiled with DYNARRAY_HEAP_ONLY defined, it links
+   without the arena module, and oAArena must always be NULL. */
 
-static int DynArray_grow(DynArray_T oDynArray)
+static void *DynArray_allocate(Arena_T oAArena, size_t uSize)
 {
-   const size_t GROWTH_FACTOR = 2;
+#ifdef DYNARRAY_HEAP_ONLY
+   assert(oAArena == NULL);
+   (void)oAArena;
+#else
+   if (oAArena != NULL)
+      return Arena_alloc(oAArena, uSize);
+#endif
+   return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the uSize bytes at pvBlock that DynArray_allocate returned
+   for oAArena. */
+
+static void DynArray_release(Arena_T oAArena, void *pvBlock,
+                             size_t uSize)
+{
+#ifdef DYNARRAY_HEAP_ONLY
+   assert(oAArena == NULL);
+   (void)oAArena;
+   (void)uSize;
+#else
+   if (oAArena != NULL)
+   {
+      Arena_release(oAArena, pvBlock, uSize);
+      return;
+   }
+#endif
+   free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new array of uLength elements from oAArena, or from the
+   heap if oAArena is NULL, or NULL if insufficient memory is
+   available. */
+
+static const void **DynArray_allocArray(Arena_T oAArena, size_t uLength)
+{
+   return (const void**)DynArray_allocate(oAArena,
+                                          sizeof(void*) * uLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the array ppvArray of uLength elements that
+   DynArray_allocArray returned for oAArena. */
+
+static void DynArray_freeArray(Arena_T oAArena, const void **ppvArray,
+                               size_t uLength)
+{
+   DynArray_release(oAArena, (void*)ppvArray, sizeof(void*) * uLength);
+}
+
+/*--------------------------------------------------------------------*/
 
-   size_t uNewLength;
+/* Increase the physical length of oDynArray to uNewLength.  Return
+   1 (TRUE) if successful and 0 (FALSE) if insufficient memory is
+   available. */
+
+static int DynArray_resize(DynArray_T oDynArray, size_t uNewLength)
+{
    const void **ppvNewArray;
 
    assert(oDynArray != NULL);
+   assert(uNewLength > oDynArray->uPhysLength);
 
-   uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
-
-   ppvNewArray = (const void**)
-      realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
-   if (ppvNewArray == NULL)
-      return 0;
+   /* The inline elements cannot be resized, so the first growth
+      moves them to the heap; arena blocks cannot be resized either. */
+   if (oDynArray->ppvArray == oDynArray->apvInline ||
+       oDynArray->oAArena != NULL)
+   {
+      ppvNewArray = DynArray_allocArray(oDynArray->oAArena, uNewLength);
+      if (ppvNewArray == NULL)
+         return 0;
+      memcpy(ppvNewArray, oDynArray->ppvArray,
+             sizeof(void*) * oDynArray->uLength);
+      if (oDynArray->ppvArray != oDynArray->apvInline)
+         DynArray_freeArray(oDynArray->oAArena, oDynArray->ppvArray,
+                            oDynArray->uPhysLength);
+   }
+   else
+   {
+      ppvNewArray = (const void**)
+         realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
+      if (ppvNewArray == NULL)
+         return 0;
+   }
 
    oDynArray->uPhysLength = uNewLength;
    oDynArray->ppvArray = ppvNewArray;
@@ -77,29 +179,120 @@ static int DynArray_grow(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
+/* Double the physical length of oDynArray.  Return 1 (TRUE) if
+   successful and 0 (FALSE) if insufficient memory is available. */
+
+static int DynArray_grow(DynArray_T oDynArray)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   assert(oDynArray != NULL);
+
+   return DynArray_resize(oDynArray,
+                          GROWTH_FACTOR * oDynArray->uPhysLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of elements that a DynArray object asked to hold
+   uLength elements inline actually holds inline. */
+
+static size_t DynArray_inlineLength(size_t uLength)
+{
+   if (uLength > MIN_PHYS_LENGTH)
+      return uLength;
+   return MIN_PHYS_LENGTH;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Initialize the DynArray object in the DynArray_sizeInline(uLength)
+   bytes at oDynArray, with all of its elements inline and with the
+   first uInitLength of them set to NULL.  iIsClientMemory indicates
+   whether the client owns that memory, and oAArena is the arena to
+   allocate from, or NULL.  Return oDynArray. */
+
+static DynArray_T DynArray_init(struct DynArray *oDynArray,
+                                size_t uLength, size_t uInitLength,
+                                int iIsClientMemory, Arena_T oAArena)
+{
+   size_t u;
+
+   assert(oDynArray != NULL);
+   assert(uInitLength <= uLength);
+
+   oDynArray->uLength = uInitLength;
+   oDynArray->uPhysLength = DynArray_inlineLength(uLength);
+   oDynArray->uInlineLength = oDynArray->uPhysLength;
+   oDynArray->ppvArray = oDynArray->apvInline;
+   oDynArray->iIsClientMemory = iIsClientMemory;
+   oDynArray->oAArena = oAArena;
+   for (u = 0; u < uInitLength; u++)
+      oDynArray->apvInline[u] = NULL;
+
+   assert(DynArray_isValid(oDynArray));
+
+   return oDynArray;
+}
+
+/*--------------------------------------------------------------------*/
+
 DynArray_T DynArray_new(size_t uLength)
 {
-   DynArray_T oDynArray;
+   struct DynArray *oDynArray;
 
-   oDynArray = (struct DynArray*)malloc(sizeof(struct DynArray));
+   /* The DynArray and its initial array share one allocation. */
+   oDynArray = (struct DynArray*)malloc(DynArray_sizeInline(uLength));
    if (oDynArray == NULL)
       return NULL;
 
-   oDynArray->uLength = uLength;
-   if (uLength > MIN_PHYS_LENGTH)
-      oDynArray->uPhysLength = uLength;
-   else
-      oDynArray->uPhysLength = MIN_PHYS_LENGTH;
+   return DynArray_init(oDynArray, uLength, uLength, 0, NULL);
+}
 
-   oDynArray->ppvArray =
-      (const void**)calloc(oDynArray->uPhysLength, sizeof(void*));
-   if (oDynArray->ppvArray == NULL)
-   {
-      free(oDynArray);
+/*--------------------------------------------------------------------*/
+
+DynArray_T DynArray_newIn(Arena_T oAArena, size_t uLength)
+{
+   struct DynArray *oDynArray;
+
+   if (oAArena == NULL)
+      return DynArray_new(uLength);
+
+   oDynArray = (struct DynArray*)
+      DynArray_allocate(oAArena, DynArray_sizeInline(uLength));
+   if (oDynArray == NULL)
       return NULL;
-   }
 
-   return oDynArray;
+   return DynArray_init(oDynArray, uLength, uLength, 0, oAArena);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DynArray_sizeInline(size_t uInlineLength)
+{
+   return offsetof(struct DynArray, apvInline) +
+      sizeof(void*) * DynArray_inlineLength(uInlineLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+DynArray_T DynArray_newInline(void *pvMemory, size_t uInlineLength)
+{
+   assert(pvMemory != NULL);
+
+   return DynArray_init((struct DynArray*)pvMemory, uInlineLength, 0, 1,
+                        NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+DynArray_T DynArray_newInlineIn(Arena_T oAArena, void *pvMemory,
+                                size_t uInlineLength)
+{
+   assert(pvMemory != NULL);
+
+   return DynArray_init((struct DynArray*)pvMemory, uInlineLength, 0, 1,
+                        oAArena);
 }
 
 /*--------------------------------------------------------------------*/
@@ -109,8 +302,13 @@ void DynArray_free(DynArray_T oDynArray)
    assert(oDynArray != NULL);
    assert(DynArray_isValid(oDynArray));
 
-   free(oDynArray->ppvArray);
-   free(oDynArray);
+   if (oDynArray->ppvArray != oDynArray->apvInline)
+      DynArray_freeArray(oDynArray->oAArena, oDynArray->ppvArray,
+                         oDynArray->uPhysLength);
+   if (oDynArray->iIsClientMemory)
+      return;
+   DynArray_release(oDynArray->oAArena, oDynArray,
+                    DynArray_sizeInline(oDynArray->uInlineLength));
 }
 
 /*--------------------------------------------------------------------*/
@@ -155,6 +353,18 @@ void *DynArray_set(DynArray_T oDynArray, size_t uIndex,
 
 /*--------------------------------------------------------------------*/
 
+int DynArray_reserve(DynArray_T oDynArray, size_t uLength)
+{
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   if (uLength <= oDynArray->uPhysLength)
+      return 1;
+   return DynArray_resize(oDynArray, uLength);
+}
+
+/*--------------------------------------------------------------------*/
+
 int DynArray_add(DynArray_T oDynArray, const void *pvElement)
 {
    assert(oDynArray != NULL);
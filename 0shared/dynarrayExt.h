@@ -0,0 +1,61 @@
+/*--------------------------------------------------------------------*/
+/* dynarrayExt.h                                                      */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef DYNARRAY_EXT_INCLUDED
+#define DYNARRAY_EXT_INCLUDED
+
+#include <stddef.h>
+#include "arena.h"
+#include "dynarray.h"
+
+/* The functions below extend the DynArray interface of dynarray.h,
+   which the provided BDT and DT objects call and so must not
+   change. */
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new DynArray_T object whose length is uLength, like
+   DynArray_new, but which allocates all of its memory from oAArena
+   (or from the heap if oAArena is NULL), or NULL if insufficient
+   memory is available. */
+
+DynArray_T DynArray_newIn(Arena_T oAArena, size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of memory needed to hold a DynArray
+   object that stores its first uInlineLength elements inline. */
+
+size_t DynArray_sizeInline(size_t uInlineLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new DynArray_T object of length 0 that occupies the
+   DynArray_sizeInline(uInlineLength) bytes of memory at pvMemory.
+   The object stores its first uInlineLength elements in that memory,
+   and allocates an array only when it grows beyond them.  pvMemory
+   must be aligned for a pointer, and remains owned by the client:
+   DynArray_free frees only memory that the object itself allocated. */
+
+DynArray_T DynArray_newInline(void *pvMemory, size_t uInlineLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new DynArray_T object like DynArray_newInline, except
+   that any array it allocates as it grows comes from oAArena (or from
+   the heap if oAArena is NULL). */
+
+DynArray_T DynArray_newInlineIn(Arena_T oAArena, void *pvMemory,
+                                size_t uInlineLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Make room in oDynArray for uLength elements in all, so that adding
+   elements up to that many allocates nothing more.  Return 1 (TRUE)
+   if successful, or 0 (FALSE) if insufficient memory is available. */
+
+int DynArray_reserve(DynArray_T oDynArray, size_t uLength);
+
+#endif
@@ -0,0 +1,195 @@
+/*--------------------------------------------------------------------*/
+/* epoch.c                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+/* pthreads are POSIX, not ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "epoch.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The number of retired objects that triggers a reclamation pass */
+enum { EPOCH_RECLAIM_THRESHOLD = 64 };
+
+/* The size of a cache line, so that each thread's epoch is announced
+   without contending with any other thread's */
+enum { EPOCH_CACHE_LINE = 64 };
+
+/*
+  The announcement of one thread that has ever used Epoch_enter. The
+  records form a list that only grows; a record whose thread has
+  exited is reused by the next new thread.
+*/
+struct epochThread {
+   /* the global epoch when the thread's traversal began, or 0 if it
+      is not traversing */
+   size_t ulEpoch;
+   /* whether a live thread owns this record */
+   int iInUse;
+   /* the next record */
+   struct epochThread *psNext;
+   /* padding out to a whole cache line */
+   char acPad[EPOCH_CACHE_LINE - 2 * sizeof(size_t) - sizeof(void *)];
+};
+
+/* The global epoch, which starts at 1 since 0 means "not traversing" */
+static size_t ulGlobalEpoch = 1;
+
+/* The list of thread records */
+static struct epochThread *psThreads = NULL;
+
+/* The retired objects not yet freed, most recent first, and how many
+   there are */
+static struct EpochLink *psRetired = NULL;
+static size_t ulRetiredLength = 0;
+
+/* The mutex guarding changes to psThreads and the retired list */
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The key under which each thread keeps its record */
+static pthread_key_t sThreadKey;
+static pthread_once_t sThreadKeyOnce = PTHREAD_ONCE_INIT;
+
+/*--------------------------------------------------------------------*/
+
+/* Gives up the record pvThread of a thread that is exiting. */
+static void Epoch_releaseThread(void *pvThread) {
+   struct epochThread *psThread = pvThread;
+
+   __atomic_store_n(&psThread->ulEpoch, 0, __ATOMIC_RELEASE);
+   __atomic_store_n(&psThread->iInUse, 0, __ATOMIC_RELEASE);
+}
+
+/* Creates sThreadKey. */
+static void Epoch_makeThreadKey(void) {
+   (void) pthread_key_create(&sThreadKey, Epoch_releaseThread);
+}
+
+/*
+  Returns the calling thread's record, claiming or creating one if it
+  has none yet, or NULL if memory could not be allocated.
+*/
+static struct epochThread *Epoch_getThread(void) {
+   struct epochThread *psThread;
+
+   (void) pthread_once(&sThreadKeyOnce, Epoch_makeThreadKey);
+   psThread = pthread_getspecific(sThreadKey);
+   if(psThread != NULL)
+      return psThread;
+
+   (void) pthread_mutex_lock(&sMutex);
+   for(psThread = psThreads; psThread != NULL;
+       psThread = psThread->psNext)
+      if(!__atomic_load_n(&psThread->iInUse, __ATOMIC_ACQUIRE))
+         break;
+   if(psThread == NULL) {
+      psThread = calloc(1, sizeof(struct epochThread));
+      if(psThread == NULL) {
+         (void) pthread_mutex_unlock(&sMutex);
+         return NULL;
+      }
+      psThread->psNext = psThreads;
+      __atomic_store_n(&psThreads, psThread, __ATOMIC_RELEASE);
+   }
+   psThread->iInUse = 1;
+   (void) pthread_mutex_unlock(&sMutex);
+
+   if(pthread_setspecific(sThreadKey, psThread) != 0) {
+      Epoch_releaseThread(psThread);
+      return NULL;
+   }
+   return psThread;
+}
+
+/*
+  Frees every retired object that no running traversal could still be
+  using. sMutex must be held.
+*/
+static void Epoch_reclaimLocked(void) {
+   struct epochThread *psThread;
+   struct EpochLink **ppsLink;
+   struct EpochLink *psLink;
+   size_t ulOldest;
+   size_t ulEpoch;
+
+   /* traversals that begin from now on announce a newer epoch than
+      any object retired so far */
+   ulOldest = __atomic_add_fetch(&ulGlobalEpoch, 1, __ATOMIC_SEQ_CST);
+
+   for(psThread = __atomic_load_n(&psThreads, __ATOMIC_ACQUIRE);
+       psThread != NULL; psThread = psThread->psNext) {
+      ulEpoch = __atomic_load_n(&psThread->ulEpoch, __ATOMIC_SEQ_CST);
+      if(ulEpoch != 0 && ulEpoch < ulOldest)
+         ulOldest = ulEpoch;
+   }
+
+   /* an object retired before the oldest running traversal began
+      cannot have been found by it */
+   ppsLink = &psRetired;
+   while((psLink = *ppsLink) != NULL) {
+      if(psLink->ulEpoch < ulOldest) {
+         *ppsLink = psLink->psNext;
+         ulRetiredLength--;
+         free(psLink->pvObject);
+      }
+      else
+         ppsLink = &psLink->psNext;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean Epoch_enter(void) {
+   struct epochThread *psThread;
+
+   psThread = Epoch_getThread();
+   if(psThread == NULL)
+      return FALSE;
+
+   assert(psThread->ulEpoch == 0);
+   __atomic_store_n(&psThread->ulEpoch,
+                    __atomic_load_n(&ulGlobalEpoch, __ATOMIC_SEQ_CST),
+                    __ATOMIC_SEQ_CST);
+   /* the announcement must be visible before anything is read */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   return TRUE;
+}
+
+void Epoch_exit(void) {
+   struct epochThread *psThread;
+
+   psThread = pthread_getspecific(sThreadKey);
+   assert(psThread != NULL);
+   assert(psThread->ulEpoch != 0);
+
+   __atomic_store_n(&psThread->ulEpoch, 0, __ATOMIC_RELEASE);
+}
+
+void Epoch_retire(void *pvObject, struct EpochLink *psLink) {
+   assert(pvObject != NULL);
+   assert(psLink != NULL);
+
+   /* the object was unlinked before this point */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   (void) pthread_mutex_lock(&sMutex);
+   psLink->pvObject = pvObject;
+   psLink->ulEpoch = __atomic_load_n(&ulGlobalEpoch, __ATOMIC_SEQ_CST);
+   psLink->psNext = psRetired;
+   psRetired = psLink;
+   ulRetiredLength++;
+   if(ulRetiredLength >= EPOCH_RECLAIM_THRESHOLD)
+      Epoch_reclaimLocked();
+   (void) pthread_mutex_unlock(&sMutex);
+}
+
+void Epoch_reclaim(void) {
+   (void) pthread_mutex_lock(&sMutex);
+   Epoch_reclaimLocked();
+   (void) pthread_mutex_unlock(&sMutex);
+}
@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* epoch.h                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef EPOCH_INCLUDED
+#define EPOCH_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  Epoch-based reclamation lets threads read a shared structure without
+  locks while writers remove and free parts of it. A reader brackets
+  each traversal with Epoch_enter and Epoch_exit. A writer first makes
+  an object unreachable for new readers, then retires it instead of
+  freeing it; the object is freed only after every reader that might
+  still have found it has exited. Readers never wait for writers, and
+  writers never wait for readers.
+*/
+
+/*
+  The bookkeeping for one retired object, embedded in the object so
+  that retiring it never needs to allocate memory.
+*/
+struct EpochLink {
+   /* the next object awaiting reclamation */
+   struct EpochLink *psNext;
+   /* the epoch in which the object was retired */
+   size_t ulEpoch;
+   /* the object, to be released with free */
+   void *pvObject;
+};
+
+/*
+  Begins a read-side traversal by the calling thread. Returns TRUE if
+  successful, or FALSE if memory for the thread's bookkeeping could
+  not be allocated, in which case the caller must not rely on
+  Epoch_retire and should fall back to locking. Traversals must not
+  be nested.
+*/
+boolean Epoch_enter(void);
+
+/* Ends the calling thread's read-side traversal. */
+void Epoch_exit(void);
+
+/*
+  Arranges for pvObject, which must already be unreachable by
+  traversals that begin from now on, to be freed once no traversal
+  that began earlier is still running. *psLink must be part of
+  pvObject's memory.
+*/
+void Epoch_retire(void *pvObject, struct EpochLink *psLink);
+
+/*
+  Frees every retired object that no running traversal could still be
+  using. Epoch_retire calls this periodically; calling it directly is
+  only needed to release memory promptly, e.g. when a structure is
+  freed.
+*/
+void Epoch_reclaim(void);
+
+#endif
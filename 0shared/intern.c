@@ -0,0 +1,192 @@
+/*--------------------------------------------------------------------*/
+/* intern.c                                                           */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+/* pthreads are POSIX, not ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "arena.h"
+#include "intern.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The number of independently locked parts of the table, so that
+   threads interning different strings rarely wait for each other */
+enum { INTERN_SHARDS = 16 };
+
+/* The number of slots a shard starts with, a power of 2 */
+enum { INTERN_MIN_SLOTS = 16 };
+
+/* One slot of a shard */
+struct internSlot {
+   /* the hash code of pcString */
+   size_t ulHash;
+   /* the interned string in this slot, or NULL if the slot is empty */
+   const char *pcString;
+};
+
+/*
+  One part of the table: an open addressing (linear probing) hash
+  table of the interned strings whose hash codes select it, kept at
+  most half full.
+*/
+struct internShard {
+   /* the mutex guarding the shard */
+   pthread_mutex_t sMutex;
+   /* the number of strings in the shard */
+   size_t ulLength;
+   /* the number of slots in psSlots, 0 or a power of 2 */
+   size_t ulSlots;
+   /* the slots, or NULL before the first string is added */
+   struct internSlot *psSlots;
+};
+
+/* The shards of the table */
+static struct internShard asShards[INTERN_SHARDS];
+static pthread_once_t sShardsOnce = PTHREAD_ONCE_INIT;
+
+/* The arena the strings of every shard are copied into, or NULL if it
+   could not be allocated */
+static Arena_T oAStrings;
+
+/*--------------------------------------------------------------------*/
+
+/* Initializes the shards' mutexes and the strings' arena. */
+static void Intern_initShards(void) {
+   size_t i;
+
+   for(i = 0; i < INTERN_SHARDS; i++)
+      (void) pthread_mutex_init(&asShards[i].sMutex, NULL);
+   /* the shards share it, so it needs a lock of its own */
+   oAStrings = Arena_new(0, TRUE);
+}
+
+/* Returns a hash code for the ulLength characters at pcString. */
+static size_t Intern_hash(const char *pcString, size_t ulLength) {
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t ulHash = 0;
+   size_t i;
+
+   assert(pcString != NULL);
+
+   for(i = 0; i < ulLength; i++)
+      ulHash = ulHash * HASH_MULTIPLIER + (size_t) pcString[i];
+   return ulHash;
+}
+
+/*
+  Returns the slot of psShard holding the ulLength characters at
+  pcString, whose hash code is ulHash, or else the empty slot where
+  they belong. psShard must have an empty slot.
+*/
+static struct internSlot *Intern_find(struct internShard *psShard,
+                                      const char *pcString,
+                                      size_t ulLength, size_t ulHash) {
+   struct internSlot *psSlot;
+   size_t ulMask;
+   size_t ulSlot;
+
+   assert(psShard != NULL);
+   assert(psShard->psSlots != NULL);
+
+   /* the low bits of the hash chose the shard, so use the others */
+   ulMask = psShard->ulSlots - 1;
+   ulSlot = (ulHash / INTERN_SHARDS) & ulMask;
+   for(;;) {
+      psSlot = &psShard->psSlots[ulSlot];
+      if(psSlot->pcString == NULL)
+         return psSlot;
+      if(psSlot->ulHash == ulHash &&
+         !strncmp(psSlot->pcString, pcString, ulLength) &&
+         psSlot->pcString[ulLength] == '\0')
+         return psSlot;
+      ulSlot = (ulSlot + 1) & ulMask;
+   }
+}
+
+/*
+  Doubles the number of slots in psShard (or gives it its first
+  ones). Returns FALSE, leaving psShard unchanged, if memory could not
+  be allocated.
+*/
+static boolean Intern_grow(struct internShard *psShard) {
+   struct internSlot *psOld;
+   struct internSlot *psSlot;
+   size_t ulOldSlots;
+   size_t i;
+
+   assert(psShard != NULL);
+
+   psOld = psShard->psSlots;
+   ulOldSlots = psShard->ulSlots;
+   psShard->ulSlots = ulOldSlots == 0 ? INTERN_MIN_SLOTS : 2 * ulOldSlots;
+   psShard->psSlots = calloc(psShard->ulSlots, sizeof(struct internSlot));
+   if(psShard->psSlots == NULL) {
+      psShard->psSlots = psOld;
+      psShard->ulSlots = ulOldSlots;
+      return FALSE;
+   }
+
+   for(i = 0; i < ulOldSlots; i++) {
+      if(psOld[i].pcString == NULL)
+         continue;
+      psSlot = Intern_find(psShard, psOld[i].pcString,
+                           strlen(psOld[i].pcString), psOld[i].ulHash);
+      *psSlot = psOld[i];
+   }
+   free(psOld);
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *Intern_string(const char *pcString, size_t ulLength) {
+   struct internShard *psShard;
+   struct internSlot *psSlot;
+   char *pcCopy;
+   size_t ulHash;
+
+   assert(pcString != NULL);
+
+   (void) pthread_once(&sShardsOnce, Intern_initShards);
+   ulHash = Intern_hash(pcString, ulLength);
+   psShard = &asShards[ulHash % INTERN_SHARDS];
+
+   (void) pthread_mutex_lock(&psShard->sMutex);
+
+   if(psShard->psSlots != NULL) {
+      psSlot = Intern_find(psShard, pcString, ulLength, ulHash);
+      if(psSlot->pcString != NULL) {
+         (void) pthread_mutex_unlock(&psShard->sMutex);
+         return psSlot->pcString;
+      }
+   }
+
+   /* a new string: make room for it, then copy it in */
+   if(oAStrings == NULL ||
+      (2 * (psShard->ulLength + 1) > psShard->ulSlots &&
+       !Intern_grow(psShard))) {
+      (void) pthread_mutex_unlock(&psShard->sMutex);
+      return NULL;
+   }
+   pcCopy = Arena_alloc(oAStrings, ulLength + 1);
+   if(pcCopy == NULL) {
+      (void) pthread_mutex_unlock(&psShard->sMutex);
+      return NULL;
+   }
+   memcpy(pcCopy, pcString, ulLength);
+   pcCopy[ulLength] = '\0';
+
+   psSlot = Intern_find(psShard, pcString, ulLength, ulHash);
+   psSlot->ulHash = ulHash;
+   psSlot->pcString = pcCopy;
+   psShard->ulLength++;
+
+   (void) pthread_mutex_unlock(&psShard->sMutex);
+   return pcCopy;
+}
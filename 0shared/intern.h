@@ -0,0 +1,30 @@
+/*--------------------------------------------------------------------*/
+/* intern.h                                                           */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef INTERN_INCLUDED
+#define INTERN_INCLUDED
+
+#include <stddef.h>
+
+/*
+  The intern table keeps one shared copy of each distinct string
+  handed to it, so that a structure holding many equal strings (such
+  as the components of the paths in a large tree, where names like
+  "src" recur everywhere) stores each of them only once, and two
+  interned strings are equal exactly when they are the same pointer.
+  Interned strings are never freed, so the table suits strings that
+  recur far more often than they are new. It may be used from several
+  threads at once.
+*/
+
+/*
+  Returns the interned copy of the ulLength characters at pcString
+  (which need not be '\0'-terminated after them), adding one to the
+  table if it has none yet, or NULL if memory could not be allocated.
+  The copy is '\0'-terminated and must not be modified or freed.
+*/
+const char *Intern_string(const char *pcString, size_t ulLength);
+
+#endif
@@ -0,0 +1,701 @@
+/*--------------------------------------------------------------------*/
+/* journal.c                                                          */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+/* file descriptors, mmap, and pthreads are POSIX, not ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "journal.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The version of the journal format this module writes and reads */
+enum { JOURNAL_VERSION = 1 };
+
+/* The fewest bytes a buffer of waiting records is allocated with */
+enum { JOURNAL_MIN_BUFFER = 4096 };
+
+/* What a journal file begins with */
+static const char acJournalMagic[8] = {'D', 'T', 'J', 'O', 'U', 'R',
+                                       '\r', '\n'};
+
+/* The byte-order mark, as the writer stored it */
+static const uint32_t uiJournalByteOrder = 0x01020304;
+
+/* The start of a journal file */
+struct journalHeader {
+   /* acJournalMagic */
+   char acMagic[8];
+   /* JOURNAL_VERSION */
+   uint32_t uiVersion;
+   /* uiJournalByteOrder */
+   uint32_t uiByteOrder;
+};
+
+/* The start of a record, which its data and then its checksum follow,
+   all unaligned */
+struct journalRecord {
+   /* the record's number */
+   uint64_t ulRecord;
+   /* the length of the data */
+   uint32_t uiLength;
+   /* the operation */
+   uint32_t uiOp;
+};
+
+struct Journal {
+   /* the lock guarding every other field */
+   pthread_mutex_t sMutex;
+   /* signalled when a batch has been written, or the journal fails */
+   pthread_cond_t sWritten;
+   /* the name of the file, and its descriptor */
+   char *pcFilename;
+   int iFile;
+   /* the records not yet handed to a writer, in ulFilled of the
+      ulCapacity bytes at pcBuffer */
+   char *pcBuffer;
+   size_t ulFilled;
+   size_t ulCapacity;
+   /* the other buffer, which a writer is emptying or will fill next */
+   char *pcSpare;
+   size_t ulSpareCapacity;
+   /* whether a thread is writing a batch of records, or a restart is
+      making a new file ready, and the number of bytes in that batch */
+   boolean bIsWriting;
+   size_t ulWriting;
+   /* the number of the last record appended, and of the last one on
+      disk */
+   size_t ulLast;
+   size_t ulDurable;
+   /* the number of bytes in the file */
+   size_t ulFileBytes;
+   /* SUCCESS, or the status of the failure that stopped the journal */
+   int iError;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the FNV-1a hash of the ulLength bytes at pcBytes. */
+static uint32_t Journal_checksum(const char *pcBytes, size_t ulLength) {
+   uint32_t uiHash = 2166136261U;
+   size_t i;
+
+   assert(pcBytes != NULL);
+
+   for(i = 0; i < ulLength; i++) {
+      uiHash ^= (unsigned char) pcBytes[i];
+      uiHash *= 16777619U;
+   }
+   return uiHash;
+}
+
+/*
+  Writes the ulLength bytes at pcBytes to file descriptor iFile, as
+  many calls to write as that takes. Returns SUCCESS, or IO_ERROR if
+  a write fails.
+*/
+static int Journal_writeAll(int iFile, const char *pcBytes,
+                            size_t ulLength) {
+   ssize_t lWritten;
+
+   assert(pcBytes != NULL || ulLength == 0);
+
+   while(ulLength != 0) {
+      lWritten = write(iFile, pcBytes, ulLength);
+      if(lWritten < 0)
+         return IO_ERROR;
+      pcBytes += lWritten;
+      ulLength -= (size_t) lWritten;
+   }
+   return SUCCESS;
+}
+
+/*
+  Makes the entries of the directory holding the file named pcFilename
+  durable, so that a file created or renamed there survives a crash.
+  Returns SUCCESS, or IO_ERROR if the directory could not be synced.
+*/
+static int Journal_syncDirectory(const char *pcFilename) {
+   const char *pcSlash;
+   char *pcDirectory;
+   size_t ulLength;
+   int iDirectory;
+   int iStatus = SUCCESS;
+
+   assert(pcFilename != NULL);
+
+   pcSlash = strrchr(pcFilename, '/');
+   if(pcSlash == NULL)
+      pcDirectory = malloc(2);
+   else
+      pcDirectory = malloc((size_t) (pcSlash - pcFilename) + 2);
+   if(pcDirectory == NULL)
+      return IO_ERROR;
+   if(pcSlash == NULL)
+      strcpy(pcDirectory, ".");
+   else {
+      /* the root directory keeps its slash */
+      ulLength = pcSlash == pcFilename ? 1 :
+         (size_t) (pcSlash - pcFilename);
+      memcpy(pcDirectory, pcFilename, ulLength);
+      pcDirectory[ulLength] = '\0';
+   }
+
+   iDirectory = open(pcDirectory, O_RDONLY);
+   free(pcDirectory);
+   if(iDirectory < 0)
+      return IO_ERROR;
+   if(fsync(iDirectory) != 0)
+      iStatus = IO_ERROR;
+   (void) close(iDirectory);
+   return iStatus;
+}
+
+/*
+  Writes a journal header to the empty file iFile and makes it
+  durable. Returns SUCCESS, or IO_ERROR if it could not be written.
+*/
+static int Journal_writeHeader(int iFile) {
+   struct journalHeader sHeader;
+
+   memset(&sHeader, 0, sizeof(sHeader));
+   memcpy(sHeader.acMagic, acJournalMagic, sizeof(acJournalMagic));
+   sHeader.uiVersion = JOURNAL_VERSION;
+   sHeader.uiByteOrder = uiJournalByteOrder;
+   if(Journal_writeAll(iFile, (const char *) &sHeader,
+                       sizeof(sHeader)) != SUCCESS ||
+      fdatasync(iFile) != 0)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Calls (*pfReplay)(iOp, pcData, ulLength, pvExtra) on each intact
+  record numbered after ulAfter of the journal in the ulSize bytes at
+  pcText, whose header is valid, as Journal_open documents. Sets
+  *pulValid to the length of the header and the intact records, and
+  *pulLast to the number of the last of them (0 if there are none).
+  Returns SUCCESS, or the first other status pfReplay returns.
+*/
+static int Journal_replay(const char *pcText, size_t ulSize,
+                          size_t ulAfter,
+                          int (*pfReplay)(int iOp, const char *pcData,
+                                          size_t ulLength,
+                                          void *pvExtra),
+                          void *pvExtra, size_t *pulValid,
+                          size_t *pulLast) {
+   struct journalRecord sRecord;
+   uint32_t uiChecksum;
+   size_t ulOffset = sizeof(struct journalHeader);
+   size_t ulLast = 0;
+   size_t ulRest;
+   int iStatus = SUCCESS;
+
+   assert(pcText != NULL);
+   assert(ulSize >= sizeof(struct journalHeader));
+   assert(pfReplay != NULL);
+   assert(pulValid != NULL);
+   assert(pulLast != NULL);
+
+   /* the first record that is cut short, fails its checksum, or is
+      out of order was being written when the writer stopped */
+   while(iStatus == SUCCESS) {
+      ulRest = ulSize - ulOffset;
+      if(ulRest < sizeof(sRecord) + sizeof(uiChecksum))
+         break;
+      memcpy(&sRecord, pcText + ulOffset, sizeof(sRecord));
+      if(sRecord.uiLength >
+         ulRest - sizeof(sRecord) - sizeof(uiChecksum))
+         break;
+      memcpy(&uiChecksum,
+             pcText + ulOffset + sizeof(sRecord) + sRecord.uiLength,
+             sizeof(uiChecksum));
+      if(uiChecksum != Journal_checksum(pcText + ulOffset,
+                                        sizeof(sRecord) +
+                                        sRecord.uiLength) ||
+         sRecord.ulRecord <= ulLast || sRecord.uiOp > 255)
+         break;
+
+      if(sRecord.ulRecord > ulAfter)
+         iStatus = (*pfReplay)((int) sRecord.uiOp,
+                               pcText + ulOffset + sizeof(sRecord),
+                               sRecord.uiLength, pvExtra);
+      ulLast = (size_t) sRecord.ulRecord;
+      ulOffset += sizeof(sRecord) + sRecord.uiLength +
+         sizeof(uiChecksum);
+   }
+
+   *pulValid = ulOffset;
+   *pulLast = ulLast;
+   return iStatus;
+}
+
+/*
+  Reads the journal in the file iFile, which is ulSize bytes long,
+  replaying it as Journal_open documents, and leaves the file ready
+  for appending. Sets *pulValid to the length of the file after
+  dropping any torn record, and *pulLast to the number of the last
+  record in it. Returns SUCCESS, IO_ERROR, or the status pfReplay
+  returns.
+*/
+static int Journal_recover(int iFile, size_t ulSize, size_t ulAfter,
+                           int (*pfReplay)(int iOp, const char *pcData,
+                                           size_t ulLength,
+                                           void *pvExtra),
+                           void *pvExtra, size_t *pulValid,
+                           size_t *pulLast) {
+   void *pvText;
+   int iStatus;
+
+   assert(pfReplay != NULL);
+   assert(pulValid != NULL);
+   assert(pulLast != NULL);
+
+   *pulValid = 0;
+   *pulLast = 0;
+
+   /* a file too short for a header was being created when the writer
+      stopped, so it holds no records */
+   if(ulSize < sizeof(struct journalHeader)) {
+      if(ftruncate(iFile, 0) != 0 || lseek(iFile, 0, SEEK_SET) != 0)
+         return IO_ERROR;
+      iStatus = Journal_writeHeader(iFile);
+      *pulValid = sizeof(struct journalHeader);
+      return iStatus;
+   }
+
+   pvText = mmap(NULL, ulSize, PROT_READ, MAP_PRIVATE, iFile, 0);
+   if(pvText == MAP_FAILED)
+      return IO_ERROR;
+   (void) posix_madvise(pvText, ulSize, POSIX_MADV_SEQUENTIAL);
+
+   if(memcmp(pvText, acJournalMagic, sizeof(acJournalMagic)) != 0 ||
+      ((const struct journalHeader *) pvText)->uiVersion !=
+         JOURNAL_VERSION ||
+      ((const struct journalHeader *) pvText)->uiByteOrder !=
+         uiJournalByteOrder)
+      iStatus = IO_ERROR;
+   else
+      iStatus = Journal_replay(pvText, ulSize, ulAfter, pfReplay,
+                               pvExtra, pulValid, pulLast);
+   (void) munmap(pvText, ulSize);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* later records go after the intact ones */
+   if(*pulValid < ulSize &&
+      (ftruncate(iFile, (off_t) *pulValid) != 0 ||
+       fdatasync(iFile) != 0))
+      return IO_ERROR;
+   if(lseek(iFile, 0, SEEK_END) < 0)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Copies the ulLength bytes at offset ulFrom of the file iFrom to the
+  end of the file iTo and makes them durable. Returns SUCCESS, or
+  IO_ERROR if they could not be read or written.
+*/
+static int Journal_copyTail(int iFrom, size_t ulFrom, size_t ulLength,
+                            int iTo) {
+   char acChunk[JOURNAL_MIN_BUFFER];
+   ssize_t lRead;
+
+   if(ulLength == 0)
+      return SUCCESS;
+   while(ulLength != 0) {
+      lRead = pread(iFrom, acChunk, ulLength < sizeof(acChunk) ?
+                    ulLength : sizeof(acChunk), (off_t) ulFrom);
+      if(lRead <= 0)
+         return IO_ERROR;
+      if(Journal_writeAll(iTo, acChunk, (size_t) lRead) != SUCCESS)
+         return IO_ERROR;
+      ulFrom += (size_t) lRead;
+      ulLength -= (size_t) lRead;
+   }
+   if(fdatasync(iTo) != 0)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Drops the first ulBytes bytes of the records waiting in oJournal,
+  whose effect a restart has been told is saved elsewhere, and counts
+  those records as on disk. The caller must hold oJournal's mutex.
+*/
+static void Journal_dropWaiting(Journal_T oJournal, size_t ulBytes) {
+   struct journalRecord sRecord;
+   size_t ulOffset = 0;
+
+   assert(oJournal != NULL);
+   assert(ulBytes <= oJournal->ulFilled);
+
+   while(ulOffset < ulBytes) {
+      memcpy(&sRecord, oJournal->pcBuffer + ulOffset, sizeof(sRecord));
+      oJournal->ulDurable = (size_t) sRecord.ulRecord;
+      ulOffset += sizeof(sRecord) + sRecord.uiLength + sizeof(uint32_t);
+   }
+   assert(ulOffset == ulBytes);
+
+   memmove(oJournal->pcBuffer, oJournal->pcBuffer + ulBytes,
+           oJournal->ulFilled - ulBytes);
+   oJournal->ulFilled -= ulBytes;
+}
+
+/*
+  Hands the records waiting in oJournal to the calling thread, writes
+  them to the file and makes them durable, then records that they are
+  or that the journal failed. The caller must hold oJournal's mutex,
+  which is released while writing, and no other thread may be writing.
+*/
+static void Journal_writeBatch(Journal_T oJournal) {
+   char *pcBatch;
+   size_t ulBytes;
+   size_t ulCapacity;
+   size_t ulThrough;
+   int iStatus;
+
+   assert(oJournal != NULL);
+   assert(!oJournal->bIsWriting);
+
+   /* appends go on in the spare buffer meanwhile */
+   pcBatch = oJournal->pcBuffer;
+   ulBytes = oJournal->ulFilled;
+   ulCapacity = oJournal->ulCapacity;
+   ulThrough = oJournal->ulLast;
+   oJournal->pcBuffer = oJournal->pcSpare;
+   oJournal->ulCapacity = oJournal->ulSpareCapacity;
+   oJournal->ulFilled = 0;
+   oJournal->bIsWriting = TRUE;
+   oJournal->ulWriting = ulBytes;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+
+   iStatus = Journal_writeAll(oJournal->iFile, pcBatch, ulBytes);
+   if(iStatus == SUCCESS && fdatasync(oJournal->iFile) != 0)
+      iStatus = IO_ERROR;
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   oJournal->pcSpare = pcBatch;
+   oJournal->ulSpareCapacity = ulCapacity;
+   oJournal->bIsWriting = FALSE;
+   oJournal->ulWriting = 0;
+   if(iStatus == SUCCESS) {
+      oJournal->ulDurable = ulThrough;
+      oJournal->ulFileBytes += ulBytes;
+   }
+   else if(oJournal->iError == SUCCESS)
+      oJournal->iError = iStatus;
+   (void) pthread_cond_broadcast(&oJournal->sWritten);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_open(const char *pcFilename, size_t ulAfter,
+                 int (*pfReplay)(int iOp, const char *pcData,
+                                 size_t ulLength, void *pvExtra),
+                 void *pvExtra, Journal_T *poJResult) {
+   Journal_T oJournal;
+   struct stat sStat;
+   size_t ulValid = 0;
+   size_t ulLast = 0;
+   int iStatus;
+
+   assert(pcFilename != NULL);
+   assert(pfReplay != NULL);
+   assert(poJResult != NULL);
+
+   oJournal = calloc(1, sizeof(struct Journal));
+   if(oJournal == NULL)
+      return MEMORY_ERROR;
+   oJournal->pcFilename = malloc(strlen(pcFilename) + 1);
+   if(oJournal->pcFilename == NULL) {
+      free(oJournal);
+      return MEMORY_ERROR;
+   }
+   strcpy(oJournal->pcFilename, pcFilename);
+
+   oJournal->iFile = open(pcFilename, O_RDWR | O_CREAT, 0666);
+   if(oJournal->iFile < 0) {
+      free(oJournal->pcFilename);
+      free(oJournal);
+      return IO_ERROR;
+   }
+   if(fstat(oJournal->iFile, &sStat) != 0)
+      iStatus = IO_ERROR;
+   else
+      iStatus = Journal_recover(oJournal->iFile, (size_t) sStat.st_size,
+                                ulAfter, pfReplay, pvExtra, &ulValid,
+                                &ulLast);
+   /* a new file must survive a crash along with its records */
+   if(iStatus == SUCCESS && sStat.st_size == 0)
+      iStatus = Journal_syncDirectory(pcFilename);
+   if(iStatus == SUCCESS &&
+      pthread_mutex_init(&oJournal->sMutex, NULL) != 0)
+      iStatus = MEMORY_ERROR;
+   if(iStatus == SUCCESS &&
+      pthread_cond_init(&oJournal->sWritten, NULL) != 0) {
+      (void) pthread_mutex_destroy(&oJournal->sMutex);
+      iStatus = MEMORY_ERROR;
+   }
+   if(iStatus != SUCCESS) {
+      (void) close(oJournal->iFile);
+      free(oJournal->pcFilename);
+      free(oJournal);
+      return iStatus;
+   }
+
+   oJournal->ulLast = ulLast > ulAfter ? ulLast : ulAfter;
+   oJournal->ulDurable = oJournal->ulLast;
+   oJournal->ulFileBytes = ulValid;
+   oJournal->iError = SUCCESS;
+   *poJResult = oJournal;
+   return SUCCESS;
+}
+
+int Journal_close(Journal_T oJournal) {
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   iStatus = Journal_sync(oJournal);
+   if(close(oJournal->iFile) != 0 && iStatus == SUCCESS)
+      iStatus = IO_ERROR;
+   (void) pthread_cond_destroy(&oJournal->sWritten);
+   (void) pthread_mutex_destroy(&oJournal->sMutex);
+   free(oJournal->pcBuffer);
+   free(oJournal->pcSpare);
+   free(oJournal->pcFilename);
+   free(oJournal);
+   return iStatus;
+}
+
+int Journal_append(Journal_T oJournal, int iOp, const char *pcData,
+                   size_t ulLength, size_t *pulRecord) {
+   struct journalRecord sRecord;
+   uint32_t uiChecksum;
+   size_t ulNeeded;
+   size_t ulCapacity;
+   char *pcRecord;
+   char *pcBigger;
+   int iStatus;
+
+   assert(oJournal != NULL);
+   assert(iOp >= 0 && iOp <= 255);
+   assert(pcData != NULL || ulLength == 0);
+   assert(pulRecord != NULL);
+
+   if(ulLength > UINT32_MAX)
+      return MEMORY_ERROR;
+   ulNeeded = sizeof(sRecord) + ulLength + sizeof(uiChecksum);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   if(oJournal->iError != SUCCESS) {
+      /* the change goes unrecorded, but not unnumbered, so that a
+         restart can tell that it is missing */
+      oJournal->ulLast++;
+      iStatus = oJournal->iError;
+      (void) pthread_mutex_unlock(&oJournal->sMutex);
+      return iStatus;
+   }
+
+   if(oJournal->ulFilled + ulNeeded > oJournal->ulCapacity) {
+      ulCapacity = oJournal->ulCapacity < JOURNAL_MIN_BUFFER ?
+         JOURNAL_MIN_BUFFER : 2 * oJournal->ulCapacity;
+      if(ulCapacity < oJournal->ulFilled + ulNeeded)
+         ulCapacity = oJournal->ulFilled + ulNeeded;
+      pcBigger = realloc(oJournal->pcBuffer, ulCapacity);
+      if(pcBigger == NULL) {
+         oJournal->ulLast++;
+         oJournal->iError = MEMORY_ERROR;
+         (void) pthread_cond_broadcast(&oJournal->sWritten);
+         (void) pthread_mutex_unlock(&oJournal->sMutex);
+         return MEMORY_ERROR;
+      }
+      oJournal->pcBuffer = pcBigger;
+      oJournal->ulCapacity = ulCapacity;
+   }
+
+   pcRecord = oJournal->pcBuffer + oJournal->ulFilled;
+   sRecord.ulRecord = ++oJournal->ulLast;
+   sRecord.uiLength = (uint32_t) ulLength;
+   sRecord.uiOp = (uint32_t) iOp;
+   memcpy(pcRecord, &sRecord, sizeof(sRecord));
+   if(ulLength != 0)
+      memcpy(pcRecord + sizeof(sRecord), pcData, ulLength);
+   uiChecksum = Journal_checksum(pcRecord, sizeof(sRecord) + ulLength);
+   memcpy(pcRecord + sizeof(sRecord) + ulLength, &uiChecksum,
+          sizeof(uiChecksum));
+   oJournal->ulFilled += ulNeeded;
+
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   *pulRecord = (size_t) sRecord.ulRecord;
+   return SUCCESS;
+}
+
+int Journal_wait(Journal_T oJournal, size_t ulRecord) {
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   assert(ulRecord <= oJournal->ulLast);
+
+   /* whichever thread finds no batch being written writes the next
+      one, with every record appended while the last one was written */
+   while(oJournal->ulDurable < ulRecord &&
+         oJournal->iError == SUCCESS) {
+      if(oJournal->bIsWriting)
+         (void) pthread_cond_wait(&oJournal->sWritten,
+                                  &oJournal->sMutex);
+      else
+         Journal_writeBatch(oJournal);
+   }
+   iStatus = oJournal->ulDurable >= ulRecord ? SUCCESS :
+      oJournal->iError;
+
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   return iStatus;
+}
+
+int Journal_sync(Journal_T oJournal) {
+   assert(oJournal != NULL);
+
+   return Journal_wait(oJournal, Journal_getLastRecord(oJournal));
+}
+
+int Journal_restart(Journal_T oJournal, size_t ulAfter,
+                    size_t ulOffset) {
+   char *pcTemporary;
+   size_t ulFrom;
+   size_t ulCarried;
+   boolean bWasFailed;
+   int iFile;
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   pcTemporary = malloc(strlen(oJournal->pcFilename) + sizeof(".new"));
+   if(pcTemporary == NULL)
+      return IO_ERROR;
+   strcpy(pcTemporary, oJournal->pcFilename);
+   strcat(pcTemporary, ".new");
+
+   iFile = open(pcTemporary, O_RDWR | O_CREAT | O_TRUNC, 0666);
+   if(iFile < 0) {
+      free(pcTemporary);
+      return IO_ERROR;
+   }
+   iStatus = Journal_writeHeader(iFile);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   while(oJournal->bIsWriting)
+      (void) pthread_cond_wait(&oJournal->sWritten, &oJournal->sMutex);
+   assert(ulAfter <= oJournal->ulLast);
+
+   /* after a failure, only a journal with nothing since ulAfter to
+      carry over can be restarted */
+   bWasFailed = oJournal->iError != SUCCESS;
+   if(iStatus == SUCCESS && bWasFailed && oJournal->ulLast > ulAfter)
+      iStatus = oJournal->iError;
+   if(iStatus != SUCCESS) {
+      (void) pthread_mutex_unlock(&oJournal->sMutex);
+      (void) close(iFile);
+      (void) remove(pcTemporary);
+      free(pcTemporary);
+      return iStatus;
+   }
+
+   /* the records before ulOffset that are still waiting need never be
+      written; those after it in the file move to the new one, and
+      batches wait until it is in place */
+   if(bWasFailed)
+      Journal_dropWaiting(oJournal, oJournal->ulFilled);
+   else if(ulOffset > oJournal->ulFileBytes)
+      Journal_dropWaiting(oJournal, ulOffset - oJournal->ulFileBytes);
+   ulFrom = ulOffset < oJournal->ulFileBytes && !bWasFailed ? ulOffset :
+      oJournal->ulFileBytes;
+   ulCarried = oJournal->ulFileBytes - ulFrom;
+   if(oJournal->ulFilled == 0)
+      oJournal->ulDurable = oJournal->ulLast;
+   oJournal->bIsWriting = TRUE;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+
+   iStatus = Journal_copyTail(oJournal->iFile, ulFrom, ulCarried,
+                              iFile);
+   if(iStatus == SUCCESS)
+      iStatus = Journal_rename(pcTemporary, oJournal->pcFilename);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   oJournal->bIsWriting = FALSE;
+   if(iStatus == SUCCESS) {
+      (void) close(oJournal->iFile);
+      oJournal->iFile = iFile;
+      oJournal->ulFileBytes = sizeof(struct journalHeader) + ulCarried;
+      if(bWasFailed)
+         oJournal->iError = SUCCESS;
+   }
+   (void) pthread_cond_broadcast(&oJournal->sWritten);
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+
+   if(iStatus != SUCCESS) {
+      (void) close(iFile);
+      (void) remove(pcTemporary);
+   }
+   free(pcTemporary);
+   return iStatus;
+}
+
+int Journal_getStatus(Journal_T oJournal) {
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   iStatus = oJournal->iError;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   return iStatus;
+}
+
+size_t Journal_getLastRecord(Journal_T oJournal) {
+   size_t ulLast;
+
+   assert(oJournal != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   ulLast = oJournal->ulLast;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   return ulLast;
+}
+
+size_t Journal_getBytes(Journal_T oJournal) {
+   size_t ulBytes;
+
+   assert(oJournal != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->sMutex);
+   ulBytes = oJournal->ulFileBytes + oJournal->ulWriting +
+      oJournal->ulFilled;
+   (void) pthread_mutex_unlock(&oJournal->sMutex);
+   return ulBytes;
+}
+
+int Journal_rename(const char *pcFrom, const char *pcTo) {
+   assert(pcFrom != NULL);
+   assert(pcTo != NULL);
+
+   if(rename(pcFrom, pcTo) != 0)
+      return IO_ERROR;
+   return Journal_syncDirectory(pcTo);
+}
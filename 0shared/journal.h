@@ -0,0 +1,121 @@
+/*--------------------------------------------------------------------*/
+/* journal.h                                                          */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef JOURNAL_INCLUDED
+#define JOURNAL_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A Journal_T is a write-ahead journal: a file to which a client
+  appends a record of each change it makes to some structure in
+  memory, so that the changes can be replayed after a crash. Each
+  record holds an operation code and a string of bytes chosen by the
+  client, and is numbered in the order it was appended, starting from
+  1. Appending only copies the record into memory; records reach the
+  disk in batches, each written with one write and made durable with
+  one fsync, however many threads appended to it. A record torn by a
+  crash while it was being written ends the journal, and is dropped
+  the next time the journal is opened.
+  Every function may be called from several threads at once on the
+  same journal, except Journal_open and Journal_close.
+*/
+typedef struct Journal *Journal_T;
+
+/*
+  Opens the journal in the file named pcFilename, creating an empty
+  one if there is no such file, and calls
+  (*pfReplay)(iOp, pcData, ulLength, pvExtra) on each of its intact
+  records numbered after ulAfter, in order; pcData is valid only until
+  pfReplay returns. Later records are numbered after both the last
+  record in the file and ulAfter, so a client that has saved the
+  effect of every record up to some number elsewhere can pass that
+  number to skip them. Returns SUCCESS and sets *poJResult to the
+  journal, or returns IO_ERROR if the file cannot be read, written, or
+  is not a journal, MEMORY_ERROR if memory could not be allocated, or
+  the first status other than SUCCESS that pfReplay returns, which
+  stops the replay.
+*/
+int Journal_open(const char *pcFilename, size_t ulAfter,
+                 int (*pfReplay)(int iOp, const char *pcData,
+                                 size_t ulLength, void *pvExtra),
+                 void *pvExtra, Journal_T *poJResult);
+
+/*
+  Writes every record appended to oJournal to disk, closes its file,
+  and frees it. Returns SUCCESS, or the status Journal_sync would, in
+  which case it is freed all the same.
+*/
+int Journal_close(Journal_T oJournal);
+
+/*
+  Appends to oJournal a record of operation iOp, which must be between
+  0 and 255, with the ulLength bytes at pcData. Returns SUCCESS and
+  sets *pulRecord to the record's number, or returns MEMORY_ERROR if
+  memory for it could not be allocated, in which case oJournal has
+  failed. Once oJournal has failed, later calls to Journal_append,
+  Journal_wait, and Journal_sync return the status of the failure,
+  until a call to Journal_restart. A record that is not appended
+  still uses up its number.
+*/
+int Journal_append(Journal_T oJournal, int iOp, const char *pcData,
+                   size_t ulLength, size_t *pulRecord);
+
+/*
+  Waits until record number ulRecord of oJournal, and every record
+  before it, is on disk, writing them there itself if no other thread
+  is. Returns SUCCESS, or IO_ERROR if writing failed, in which case
+  oJournal has failed, or the status of an earlier failure; no record
+  reaches the disk after a failure until a call to Journal_restart.
+*/
+int Journal_wait(Journal_T oJournal, size_t ulRecord);
+
+/* Like Journal_wait, for every record appended to oJournal so far. */
+int Journal_sync(Journal_T oJournal);
+
+/*
+  Replaces the file of oJournal with a new journal holding only the
+  records numbered after ulAfter, once the client has saved the
+  effect of every record through ulAfter elsewhere, durably; those
+  records count as being on disk from then on. ulOffset must be what
+  Journal_getBytes returned while ulAfter was the last record
+  appended. Records may go on being appended during the restart; the
+  ones that already reached the old file are copied to the new one,
+  which is then renamed into place, so that a crash leaves either the
+  old file or the new one. Returns SUCCESS, or IO_ERROR if the new
+  file could not be written, in which case oJournal keeps its old
+  file. If oJournal has failed, the restart clears the failure, but
+  only if no record (or attempt to append one) came after ulAfter;
+  otherwise it returns the status of the failure, keeping the old
+  file, so the caller must keep records from being appended until
+  Journal_restart returns to be sure of clearing it.
+*/
+int Journal_restart(Journal_T oJournal, size_t ulAfter,
+                    size_t ulOffset);
+
+/*
+  Returns SUCCESS if oJournal has not failed, or the status of the
+  failure.
+*/
+int Journal_getStatus(Journal_T oJournal);
+
+/* Returns the number of the last record appended to oJournal. */
+size_t Journal_getLastRecord(Journal_T oJournal);
+
+/*
+  Returns the number of bytes of the records in oJournal's file, being
+  written to it, and waiting to be written to it.
+*/
+size_t Journal_getBytes(Journal_T oJournal);
+
+/*
+  Renames the file named pcFrom to pcTo, replacing any file of that
+  name, and makes the rename durable. Returns SUCCESS, or IO_ERROR if
+  the file could not be renamed.
+*/
+int Journal_rename(const char *pcFrom, const char *pcTo);
+
+#endif
@@ -4,161 +4,457 @@
 /*--------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "dynarray.h"
+#include "intern.h"
 #include "path.h"
+#include "pathExt.h"
 
-/* An absolute path */
+/*
+  x86 processors all have the SSE2 vector instructions, and most recent
+  ones AVX2 too, so there pathnames are scanned 16 or 32 characters at
+  a time. Elsewhere, or if PATH_NO_SIMD is defined, they are scanned a
+  byte at a time. Either way, a scan reads only the characters of the
+  pathname, whose length the caller knows, and never past its end.
+*/
+#if defined(__GNUC__) && defined(__SSE2__) && !defined(PATH_NO_SIMD)
+#define PATH_SIMD
+#include <immintrin.h>
+#endif
+
+/*
+  Compiled with PATH_HEAP_ONLY defined, this module makes paths only
+  from the heap and never interns their components, and links without
+  the arena and intern modules, as clients that only use Path_new and
+  the functions that work on its paths need. Then every arena passed
+  to it must be NULL, and no path may be interned.
+*/
+
+/*
+  One component of a path, with what comparisons need to tell it from
+  another without looking at its characters
+*/
+struct component {
+   /* The component as a string of its own */
+   const char *pcName;
+   /* The offset of the component's first character in the pathname */
+   size_t ulOffset;
+   /* The string length of the component */
+   size_t ulLength;
+   /* The hash code of the component (see Path_hashComponent) */
+   size_t ulHash;
+};
+
+/*
+  An absolute path. Each path is a single allocation: this header, then
+  the component array, then the pathname, then (unless the components
+  are interned) a second copy of the pathname with every '/' replaced
+  by '\0' that holds the components.
+  A path never changes once built, so copies of it share the one
+  allocation, which is freed when the last of them is.
+*/
 struct path {
    /* The string representation of the path,
       which uses '/' as the component delimiter */
    const char *pcPath;
    /* The string length of pcPath */
    size_t ulLength;
-   /* The ordered collection of component strings in the path */
-   DynArray_T oDComponents;
+   /* The number of components in the path */
+   size_t ulDepth;
+   /* Whether the components are interned strings rather than part of
+      the path's own allocation */
+   boolean bIsInterned;
+   /* The arena the path was allocated from, or NULL for the heap */
+   Arena_T oAArena;
+   /* The number of references to the path not yet freed, which
+      threads may change at the same time */
+   size_t ulRefs;
+   /* The ordered offsets and lengths of the components in the path,
+      ulDepth of them, followed by the path's characters */
+   struct component asComponents[1];
 };
 
 /*
-  Frees pcStr. This wrapper is used to match the requirements of the
-  callback function pointer passed to DynArray_map. pvExtra is unused.
+  The state of a scan of a pathname, which validates it and counts its
+  components without allocating
 */
-static void Path_freeString(char *pcStr, void *pvExtra) {
-   /* pcStr may be NULL, as this is a no-op to free.
-      pvExtra may be NULL, as it is unused. */
-   free(pcStr);
-}
+struct pathScan {
+   /* The number of '/' delimiters among the characters scanned so
+      far */
+   size_t ulDelimiters;
+   /* Whether the last of them is a '/' */
+   boolean bEndsInDelimiter;
+};
 
 /*
-  Sets *poDComponents to be an ordered collection of component strings
-  in pcPath, or NULL if an error occurs.
-  Returns one of the following statuses:
-  * SUCCESS if no error occurrs
-  * BAD_PATH if pcPath is the empty string,
-             or begins or ends with a '/',
-             or contains consecutive '/' delimiters
-  * MEMORY_ERROR if memory could not be allocated to complete request
+  Adds the ulLength characters at pcChars, which continue a pathname,
+  to *psScan a byte at a time. Returns BAD_PATH if they contain a
+  '\0', or a '/' directly after another (or after the last character
+  scanned before them), and SUCCESS otherwise.
 */
-static int Path_split(const char *pcPath, DynArray_T *poDComponents) {
-   const char *pcStart = pcPath;
-   const char *pcEnd = pcPath;
-   char *pcCopy;
-   DynArray_T oDSubstrings;
+static int Path_scanBytes(const char *pcChars, size_t ulLength,
+                          struct pathScan *psScan) {
+   size_t i;
 
-   assert(pcPath != NULL);
-   assert(poDComponents != NULL);
+   assert(pcChars != NULL || ulLength == 0);
+   assert(psScan != NULL);
 
-   /* path cannot be empty string */
-   if(*pcPath == '\0') {
-      *poDComponents = NULL;
-      return BAD_PATH;
+   for(i = 0; i < ulLength; i++) {
+      if(pcChars[i] == '\0')
+         return BAD_PATH;
+      if(pcChars[i] == '/') {
+         if(psScan->bEndsInDelimiter)
+            return BAD_PATH;
+         psScan->ulDelimiters++;
+         psScan->bEndsInDelimiter = TRUE;
+      }
+      else
+         psScan->bEndsInDelimiter = FALSE;
    }
+   return SUCCESS;
+}
 
-   oDSubstrings = DynArray_new(0);
-   if(oDSubstrings == NULL) {
-      *poDComponents = NULL;
-      return MEMORY_ERROR;
-   }
+#ifdef PATH_SIMD
 
-   /* validate and split pcPath */
-   while(*pcEnd != '\0') {
-      pcEnd = pcStart;
-      /* component can't start with delimiter */
-      if(*pcEnd == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return BAD_PATH;
-      }
+/*
+  Adds the next ulWidth characters of a pathname, none of them a '\0',
+  to *psScan, given as a bit mask in which bit i of ulDelimiters is
+  set if the i-th of them is a '/'. Returns BAD_PATH if the pathname
+  contains consecutive '/' delimiters so far, and SUCCESS otherwise.
+*/
+static int Path_scanBlock(struct pathScan *psScan,
+                          unsigned long ulDelimiters, size_t ulWidth) {
+   assert(psScan != NULL);
+   assert(ulWidth > 0 && ulWidth <= 32);
+
+   /* a delimiter directly after another, in this block or across the
+      boundary with the one before */
+   if((ulDelimiters & (ulDelimiters >> 1)) != 0 ||
+      (psScan->bEndsInDelimiter && (ulDelimiters & 1) != 0))
+      return BAD_PATH;
 
-      /* advance pcEnd to end of next token */
-      while(*pcEnd != '/' && *pcEnd != '\0')
-         pcEnd++;
+   psScan->ulDelimiters += (size_t) __builtin_popcountl(ulDelimiters);
+   psScan->bEndsInDelimiter =
+      (boolean) ((ulDelimiters >> (ulWidth - 1)) & 1);
+   return SUCCESS;
+}
 
-      /* final component can't end with slash */
-      if(*pcEnd == '\0' && *(pcEnd-1) == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return BAD_PATH;
+/*
+  Adds the ulLength characters at pcChars, which continue a pathname,
+  to *psScan, 16 at a time with SSE2 instructions. Returns BAD_PATH if
+  they contain a '\0' or consecutive '/' delimiters, and SUCCESS
+  otherwise. The loads are unaligned, and each lies within the
+  ulLength characters, so none reads past them: the last few
+  characters are scanned as the end of a block that overlaps the one
+  before, or a byte at a time if there are fewer than 16 in all.
+*/
+static int Path_scanSse2(const char *pcChars, size_t ulLength,
+                         struct pathScan *psScan) {
+   const __m128i vDelimiter = _mm_set1_epi8('/');
+   const __m128i vEnd = _mm_setzero_si128();
+   const size_t ulWidth = sizeof(__m128i);
+   __m128i vChars;
+   size_t ulSkip = 0;
+   size_t i = 0;
+
+   assert(pcChars != NULL || ulLength == 0);
+   assert(psScan != NULL);
+
+   if(ulLength < ulWidth)
+      return Path_scanBytes(pcChars, ulLength, psScan);
+
+   /* the block at i, without the ulSkip characters already scanned
+      at its start */
+   while(i < ulLength) {
+      if(i + ulWidth > ulLength) {
+         ulSkip = i + ulWidth - ulLength;
+         i = ulLength - ulWidth;
       }
+      vChars = _mm_loadu_si128((const __m128i *) (pcChars + i));
+      if(((unsigned int) _mm_movemask_epi8(
+             _mm_cmpeq_epi8(vChars, vEnd)) >> ulSkip) != 0)
+         return BAD_PATH;
+      if(Path_scanBlock(psScan, (unsigned int) _mm_movemask_epi8(
+                           _mm_cmpeq_epi8(vChars, vDelimiter)) >> ulSkip,
+                        ulWidth - ulSkip) != SUCCESS)
+         return BAD_PATH;
+      i += ulWidth;
+   }
+   return SUCCESS;
+}
 
-      pcCopy = calloc((size_t)(pcEnd-pcStart+1), sizeof(char));
-      if(pcCopy == NULL) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
+/*
+  Like Path_scanSse2, but 32 characters at a time with AVX2
+  instructions, handing fewer than 32 in all to Path_scanSse2. Must
+  only be called if the processor has them.
+*/
+__attribute__((target("avx2")))
+static int Path_scanAvx2(const char *pcChars, size_t ulLength,
+                         struct pathScan *psScan) {
+   const __m256i vDelimiter = _mm256_set1_epi8('/');
+   const __m256i vEnd = _mm256_setzero_si256();
+   const size_t ulWidth = sizeof(__m256i);
+   __m256i vChars;
+   size_t ulSkip = 0;
+   size_t i = 0;
+
+   assert(pcChars != NULL || ulLength == 0);
+   assert(psScan != NULL);
+
+   if(ulLength < ulWidth)
+      return Path_scanSse2(pcChars, ulLength, psScan);
+
+   while(i < ulLength) {
+      if(i + ulWidth > ulLength) {
+         ulSkip = i + ulWidth - ulLength;
+         i = ulLength - ulWidth;
       }
+      vChars = _mm256_loadu_si256((const __m256i *) (pcChars + i));
+      if(((unsigned int) _mm256_movemask_epi8(
+             _mm256_cmpeq_epi8(vChars, vEnd)) >> ulSkip) != 0)
+         return BAD_PATH;
+      if(Path_scanBlock(psScan, (unsigned int) _mm256_movemask_epi8(
+                           _mm256_cmpeq_epi8(vChars, vDelimiter)) >>
+                        ulSkip, ulWidth - ulSkip) != SUCCESS)
+         return BAD_PATH;
+      i += ulWidth;
+   }
+   return SUCCESS;
+}
 
-      if( DynArray_add(oDSubstrings, pcCopy) == 0) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
-      }
+#endif
 
-      while(pcStart != pcEnd) {
-         *pcCopy = *pcStart;
-         pcCopy++;
-         pcStart++;
-      }
+/*
+  Returns the size of the single allocation that holds a path of
+  string length ulLength with ulDepth components, interned if
+  bIsInterned.
+*/
+static size_t Path_getSize(size_t ulLength, size_t ulDepth,
+                           boolean bIsInterned) {
+   return offsetof(struct path, asComponents) +
+      ulDepth * sizeof(struct component) +
+      (bIsInterned ? 1 : 2) * (ulLength + 1);
+}
 
-      pcStart++;
-   }
+/*
+  Returns ulSize bytes for a path from oAArena, or from the heap if
+  oAArena is NULL, or NULL if memory could not be allocated.
+*/
+static struct path *Path_allocate(Arena_T oAArena, size_t ulSize) {
+#ifdef PATH_HEAP_ONLY
+   assert(oAArena == NULL);
+   (void) oAArena;
+#else
+   if(oAArena != NULL)
+      return Arena_alloc(oAArena, ulSize);
+#endif
+   return malloc(ulSize);
+}
 
-   *poDComponents = oDSubstrings;
-   return SUCCESS;
+/*
+  Frees the path psPath of size ulSize that Path_allocate returned for
+  oAArena.
+*/
+static void Path_release(Arena_T oAArena, struct path *psPath,
+                         size_t ulSize) {
+#ifdef PATH_HEAP_ONLY
+   assert(oAArena == NULL);
+   (void) oAArena;
+   (void) ulSize;
+#else
+   if(oAArena != NULL) {
+      Arena_release(oAArena, psPath, ulSize);
+      return;
+   }
+#endif
+   free(psPath);
 }
 
+/*
+  Returns the interned string of the ulLength characters at pcChars,
+  or NULL if memory could not be allocated.
+*/
+static const char *Path_intern(const char *pcChars, size_t ulLength) {
+#ifdef PATH_HEAP_ONLY
+   assert(FALSE);
+   (void) pcChars;
+   (void) ulLength;
+   return NULL;
+#else
+   return Intern_string(pcChars, ulLength);
+#endif
+}
 
-int Path_new(const char *pcPath, Path_T *poPResult) {
+/*
+  Creates a new path object from the first ulLength characters of
+  pcPath, which must be a well-formed path with exactly ulDepth
+  components (pcPath need not be '\0'-terminated after them),
+  allocating it from oAArena, or from the heap if oAArena is NULL,
+  and interning its components if bIsInterned.
+  Returns an int SUCCESS status and sets *poPResult to be the new path
+  if successful. Otherwise, sets *poPResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int Path_build(Arena_T oAArena, const char *pcPath,
+                      size_t ulLength, size_t ulDepth,
+                      boolean bIsInterned, Path_T *poPResult) {
    struct path *psNew;
-   int iSplitResult;
+   char *pcBuild;
+   char *pcSplit = NULL;
+   size_t ulSize;
+   size_t ulIndex;
+   size_t ulLevel = 0;
+   size_t ulStart = 0;
+   size_t ulHash = 0;
 
    assert(pcPath != NULL);
+   assert(ulDepth > 0);
    assert(poPResult != NULL);
 
-   psNew = calloc(1, sizeof(struct path));
+   ulSize = Path_getSize(ulLength, ulDepth, bIsInterned);
+   psNew = Path_allocate(oAArena, ulSize);
    if(psNew == NULL) {
       *poPResult = NULL;
       return MEMORY_ERROR;
    }
 
-   /* instantiate and fill list of components */
-   iSplitResult = Path_split(pcPath, &psNew->oDComponents);
-   if(iSplitResult != SUCCESS) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return iSplitResult;
+   pcBuild = (char *) &psNew->asComponents[ulDepth];
+   memcpy(pcBuild, pcPath, ulLength);
+   pcBuild[ulLength] = '\0';
+   if(!bIsInterned) {
+      pcSplit = pcBuild + ulLength + 1;
+      memcpy(pcSplit, pcBuild, ulLength + 1);
    }
 
-   psNew->ulLength = strlen(pcPath);
-   psNew->pcPath = malloc(psNew->ulLength+1);
-   if(psNew->pcPath == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
+   /* record and hash each component, terminating it in the copy if
+      it is not interned */
+   for(ulIndex = 0; ulIndex <= ulLength; ulIndex++) {
+      if(ulIndex == ulLength || pcBuild[ulIndex] == '/') {
+         struct component *psComp = &psNew->asComponents[ulLevel];
+
+         assert(ulLevel < ulDepth);
+         psComp->ulOffset = ulStart;
+         psComp->ulLength = ulIndex - ulStart;
+         psComp->ulHash = ulHash;
+         if(bIsInterned) {
+            psComp->pcName = Path_intern(pcBuild + ulStart,
+                                         psComp->ulLength);
+            if(psComp->pcName == NULL) {
+               Path_release(oAArena, psNew, ulSize);
+               *poPResult = NULL;
+               return MEMORY_ERROR;
+            }
+         }
+         else {
+            psComp->pcName = pcSplit + ulStart;
+            pcSplit[ulIndex] = '\0';
+         }
+         ulLevel++;
+         ulStart = ulIndex + 1;
+         ulHash = 0;
+      }
+      else
+         ulHash = ulHash * PATH_HASH_MULTIPLIER +
+            (size_t) pcBuild[ulIndex];
    }
-   strcpy((char *)psNew->pcPath, pcPath);
+   assert(ulLevel == ulDepth);
+
+   psNew->pcPath = pcBuild;
+   psNew->ulLength = ulLength;
+   psNew->ulDepth = ulDepth;
+   psNew->bIsInterned = bIsInterned;
+   psNew->oAArena = oAArena;
+   psNew->ulRefs = 1;
 
    *poPResult = psNew;
    return SUCCESS;
 }
 
+
+int Path_new(const char *pcPath, Path_T *poPResult) {
+   return Path_newIn(NULL, pcPath, poPResult);
+}
+
+int Path_newIn(Arena_T oAArena, const char *pcPath, Path_T *poPResult) {
+   return Path_newInterned(oAArena, pcPath, FALSE, poPResult);
+}
+
+int Path_newInterned(Arena_T oAArena, const char *pcPath,
+                     boolean bIsInterned, Path_T *poPResult) {
+   size_t ulDepth;
+   size_t ulLength;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(poPResult != NULL);
+
+   /* reject malformed paths before allocating anything */
+   ulLength = strlen(pcPath);
+   iStatus = Path_checkSpan(pcPath, ulLength, &ulDepth);
+   if(iStatus != SUCCESS) {
+      *poPResult = NULL;
+      return iStatus;
+   }
+
+   return Path_build(oAArena, pcPath, ulLength, ulDepth, bIsInterned,
+                     poPResult);
+}
+
+int Path_checkSpan(const char *pcPath, size_t ulLength,
+                   size_t *pulDepth) {
+   struct pathScan sScan = {0, FALSE};
+   int iStatus;
+
+   assert(pcPath != NULL || ulLength == 0);
+   assert(pulDepth != NULL);
+
+   /* path cannot be empty, nor can it start with delimiter */
+   if(ulLength == 0 || *pcPath == '/')
+      return BAD_PATH;
+
+   /* the fastest scanner the processor supports rules out a '\0' and
+      consecutive delimiters */
+#ifdef PATH_SIMD
+   if(__builtin_cpu_supports("avx2"))
+      iStatus = Path_scanAvx2(pcPath, ulLength, &sScan);
+   else
+      iStatus = Path_scanSse2(pcPath, ulLength, &sScan);
+#else
+   iStatus = Path_scanBytes(pcPath, ulLength, &sScan);
+#endif
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* nor can it end with one */
+   if(sScan.bEndsInDelimiter)
+      return BAD_PATH;
+
+   *pulDepth = sScan.ulDelimiters + 1;
+   return SUCCESS;
+}
+
+int Path_newSpan(Arena_T oAArena, const char *pcPath, size_t ulLength,
+                 boolean bIsInterned, Path_T *poPResult) {
+   size_t ulDepth;
+   int iStatus;
+
+   assert(pcPath != NULL || ulLength == 0);
+   assert(poPResult != NULL);
+
+   iStatus = Path_checkSpan(pcPath, ulLength, &ulDepth);
+   if(iStatus != SUCCESS) {
+      *poPResult = NULL;
+      return iStatus;
+   }
+
+   return Path_build(oAArena, pcPath, ulLength, ulDepth, bIsInterned,
+                     poPResult);
+}
+
 int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
-   struct path *psNew;
-   size_t ulIndex, ulLength, ulSum;
-   const char *pcComponent;
-   char *pcCopy;
-   char *pcBuild;
-   char *pcInsert;
+   const struct component *psLast;
 
    assert(oPPath != NULL);
    assert(poPResult != NULL);
@@ -175,83 +471,51 @@ int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
       return NO_SUCH_PATH;
    }
 
-   psNew = calloc(1, sizeof(struct path));
-   if(psNew == NULL) {
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   psNew->oDComponents = DynArray_new(ulDepth);
-   if(psNew->oDComponents == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   pcBuild = calloc(Path_getStrLength(oPPath)+1, sizeof(char));
-   if(pcBuild == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
+   /* the whole of oPPath is oPPath itself */
+   if(ulDepth == Path_getDepth(oPPath))
+      return Path_dup(oPPath, poPResult);
 
-   pcInsert = pcBuild;
-   ulSum = 0;
-
-   for(ulIndex = 0; ulIndex < ulDepth; ulIndex++) {
-      /* deep copy each component to new DynArray */
-      pcComponent = Path_getComponent(oPPath, ulIndex);
-      ulLength = strlen(pcComponent);
-      pcCopy = calloc(ulLength + 1, sizeof(char));
-      if(pcCopy == NULL) {
-         free(pcBuild);
-         Path_free(psNew);
-         *poPResult = NULL;
-         return MEMORY_ERROR;
-      }
-      strcpy(pcCopy, pcComponent);
-      (void) DynArray_set(psNew->oDComponents, ulIndex, pcCopy);
-      /* construct prefix's pathname string */
-      strcpy(pcInsert, pcComponent);
-      pcInsert[ulLength] = '/';
-      ulSum += ulLength + 1;
-      pcInsert += ulLength + 1;
-   }
-   pcBuild[ulSum-1] = '\0';
+   /* the prefix's pathname ends with its last component */
+   psLast = &oPPath->asComponents[ulDepth - 1];
+   return Path_build(oPPath->oAArena, oPPath->pcPath,
+                     psLast->ulOffset + psLast->ulLength, ulDepth,
+                     oPPath->bIsInterned, poPResult);
+}
 
-   /* shrink allocation to fit prefix's pathname string if needed */
-   pcInsert = realloc(pcBuild, ulSum);
-   if(pcInsert == NULL) {
-      free(pcBuild);
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-   psNew->ulLength = ulSum-1;
-   psNew->pcPath = pcInsert;
+int Path_dup(Path_T oPPath, Path_T *poPResult) {
+   assert(oPPath != NULL);
+   assert(poPResult != NULL);
 
-   *poPResult = psNew;
+   (void) __atomic_add_fetch(&((struct path *) oPPath)->ulRefs, 1,
+                             __ATOMIC_RELAXED);
+   *poPResult = oPPath;
    return SUCCESS;
 }
 
-int Path_dup(Path_T oPPath, Path_T *poPResult) {
+int Path_dupIn(Arena_T oAArena, Path_T oPPath, Path_T *poPResult) {
    assert(oPPath != NULL);
    assert(poPResult != NULL);
 
-   return Path_prefix(oPPath, Path_getDepth(oPPath), poPResult);
+   if(oAArena == oPPath->oAArena)
+      return Path_dup(oPPath, poPResult);
+   return Path_build(oAArena, oPPath->pcPath, oPPath->ulLength,
+                     oPPath->ulDepth, oPPath->bIsInterned, poPResult);
 }
 
 void Path_free(Path_T oPPath) {
-   if(oPPath != NULL) {
-      free((char *)oPPath->pcPath);
-
-      if(oPPath->oDComponents != NULL) {
-         DynArray_map(oPPath->oDComponents,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oPPath->oDComponents);
-      }
-   }
-   free((struct path*) oPPath);
+   if(oPPath == NULL)
+      return;
+
+   /* only the last reference frees the memory; the release and
+      acquire order every use of the path before it is freed */
+   if(__atomic_sub_fetch(&((struct path *) oPPath)->ulRefs, 1,
+                         __ATOMIC_ACQ_REL) != 0)
+      return;
+
+   /* the whole path is a single allocation */
+   Path_release(oPPath->oAArena, (struct path*) oPPath,
+                Path_getSize(oPPath->ulLength, oPPath->ulDepth,
+                             oPPath->bIsInterned));
 }
 
 const char *Path_getPathname(Path_T oPPath) {
@@ -267,10 +531,24 @@ size_t Path_getStrLength(Path_T oPPath) {
 }
 
 int Path_comparePath(Path_T oPPath1, Path_T oPPath2) {
+   size_t ulShared;
+   size_t ulOffset;
+
    assert(oPPath1 != NULL);
    assert(oPPath2 != NULL);
 
-   return strcmp(oPPath1->pcPath, oPPath2->pcPath);
+   /* copies share their memory */
+   if(oPPath1 == oPPath2)
+      return 0;
+
+   /* the pathnames agree up to the end of the last component they
+      share, so only compare from there on */
+   ulShared = Path_getSharedPrefixDepth(oPPath1, oPPath2);
+   ulOffset = 0;
+   if(ulShared != 0)
+      ulOffset = oPPath1->asComponents[ulShared - 1].ulOffset +
+         oPPath1->asComponents[ulShared - 1].ulLength;
+   return strcmp(oPPath1->pcPath + ulOffset, oPPath2->pcPath + ulOffset);
 }
 
 int Path_compareString(Path_T oPPath, const char *pcStr) {
@@ -283,7 +561,7 @@ int Path_compareString(Path_T oPPath, const char *pcStr) {
 size_t Path_getDepth(Path_T oPPath) {
    assert(oPPath != NULL);
 
-   return DynArray_getLength(oPPath->oDComponents);
+   return oPPath->ulDepth;
 }
 
 size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
@@ -298,9 +576,26 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
       ulMin = ulDepth1;
    else
       ulMin = ulDepth2;
+
+   /* interned components are equal exactly when they are the same */
+   if(oPPath1->bIsInterned && oPPath2->bIsInterned) {
+      for(i = 0; i < ulMin; i++)
+         if(oPPath1->asComponents[i].pcName !=
+            oPPath2->asComponents[i].pcName)
+            return i;
+      return ulMin;
+   }
+
+   /* most components that differ differ in length or hash, so their
+      characters are only compared to confirm a match */
    for(i = 0; i < ulMin; i++) {
-      if(strcmp(Path_getComponent(oPPath1, i),
-                Path_getComponent(oPPath2, i)))
+      const struct component *psComp1 = &oPPath1->asComponents[i];
+      const struct component *psComp2 = &oPPath2->asComponents[i];
+
+      if(psComp1->ulLength != psComp2->ulLength ||
+         psComp1->ulHash != psComp2->ulHash ||
+         (psComp1->pcName != psComp2->pcName &&
+          memcmp(psComp1->pcName, psComp2->pcName, psComp1->ulLength)))
          return i;
    }
    return ulMin;
@@ -312,5 +607,30 @@ const char *Path_getComponent(Path_T oPPath, size_t ulLevel) {
    if(ulLevel >= Path_getDepth(oPPath))
       return NULL;
 
-   return DynArray_get(oPPath->oDComponents, ulLevel);
+   return oPPath->asComponents[ulLevel].pcName;
+}
+
+size_t Path_getComponentHash(Path_T oPPath, size_t ulLevel) {
+   assert(oPPath != NULL);
+   assert(ulLevel < Path_getDepth(oPPath));
+
+   return oPPath->asComponents[ulLevel].ulHash;
+}
+
+size_t Path_hashComponent(const char *pcComponent) {
+   size_t ulHash = 0;
+
+   assert(pcComponent != NULL);
+
+   while(*pcComponent != '\0') {
+      ulHash = ulHash * PATH_HASH_MULTIPLIER + (size_t) *pcComponent;
+      pcComponent++;
+   }
+   return ulHash;
+}
+
+boolean Path_isInterned(Path_T oPPath) {
+   assert(oPPath != NULL);
+
+   return oPPath->bIsInterned;
 }
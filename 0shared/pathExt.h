@@ -0,0 +1,99 @@
+/*--------------------------------------------------------------------*/
+/* pathExt.h                                                          */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef PATH_EXT_INCLUDED
+#define PATH_EXT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "arena.h"
+#include "path.h"
+
+/*
+  The functions below extend the path interface of path.h, which the
+  provided BDT and DT objects call and so must not change. Paths also
+  behave as follows where path.h leaves room:
+  * A path never changes once created, so Path_dup makes a copy in
+    constant time that shares the path's memory rather than
+    duplicating its contents, and cannot fail. Path_prefix to the
+    path's own depth does the same.
+  * Path_prefix allocates the new path from the same arena as oPPath
+    (or the heap).
+  * Path_free releases a path's memory, to its arena if it came from
+    one, once every copy sharing it has been freed, and does nothing
+    if oPPath is NULL.
+*/
+
+/*
+  Like Path_new, but allocates the new path from oAArena rather than
+  the heap (or from the heap if oAArena is NULL).
+*/
+int Path_newIn(Arena_T oAArena, const char *pcPath, Path_T *poPResult);
+
+/*
+  Like Path_newIn, but if bIsInterned, the components of the new path
+  (and of its copies and prefixes) are interned strings (see
+  intern.h) instead of part of the path's own memory. Paths with
+  interned components take less memory when many of their components
+  recur, and comparing components of two such paths is a pointer
+  comparison.
+*/
+int Path_newInterned(Arena_T oAArena, const char *pcPath,
+                     boolean bIsInterned, Path_T *poPResult);
+
+/*
+  Returns SUCCESS and sets *pulDepth to the number of components of
+  the absolute path in the ulLength characters at pcPath, which need
+  not be followed by a '\0', if they are well-formed by the rules of
+  Path_new; a '\0' among them makes them a BAD_PATH too. Otherwise
+  returns BAD_PATH. Allocates nothing, so a client can check many
+  paths in a large buffer, such as a file's contents, before making
+  any of them.
+*/
+int Path_checkSpan(const char *pcPath, size_t ulLength,
+                   size_t *pulDepth);
+
+/*
+  Like Path_newInterned, but the path is the ulLength characters at
+  pcPath, checked as Path_checkSpan does.
+*/
+int Path_newSpan(Arena_T oAArena, const char *pcPath, size_t ulLength,
+                 boolean bIsInterned, Path_T *poPResult);
+
+/*
+  Like Path_dup, but the copy is in oAArena (or on the heap if oAArena
+  is NULL): it shares oPPath's memory if oPPath is there too, and
+  otherwise is a deep copy allocated there.
+*/
+int Path_dupIn(Arena_T oAArena, Path_T oPPath, Path_T *poPResult);
+
+/*
+  The multiplier of the polynomial hash code that paths compute for
+  their components, for clients that combine component hash codes
+  into hash codes of their own.
+*/
+enum { PATH_HASH_MULTIPLIER = 65599 };
+
+/*
+  Returns the hash code of the component of oPPath at level ulLevel,
+  which must be less than oPPath's depth. Paths compute these when
+  they are created, and compare components by length and hash before
+  comparing their characters.
+*/
+size_t Path_getComponentHash(Path_T oPPath, size_t ulLevel);
+
+/*
+  Returns the hash code of the component pcComponent, the same as
+  Path_getComponentHash returns for a component equal to it.
+*/
+size_t Path_hashComponent(const char *pcComponent);
+
+/*
+  Returns TRUE if oPPath's components are interned, in which case
+  Path_getComponent returns the interned strings, and FALSE if not.
+*/
+boolean Path_isInterned(Path_T oPPath);
+
+#endif
@@ -0,0 +1 @@
+../0shared/arena.h
\ No newline at end of file
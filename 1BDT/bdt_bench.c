@@ -0,0 +1,37 @@
+/*--------------------------------------------------------------------*/
+/* bdt_bench.c                                                        */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#include "bdt.h"
+#include "bench.h"
+
+/* Inserts directory pcPath; a BDT has no files. */
+static int BDTBench_insert(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return BDT_insert(pcPath);
+}
+
+/* Returns whether directory pcPath is in the BDT. */
+static boolean BDTBench_contains(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return BDT_contains(pcPath);
+}
+
+/* Removes directory pcPath and everything below it. */
+static int BDTBench_rm(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return BDT_rm(pcPath);
+}
+
+/* Benchmarks the BDT implementation it is linked with; see bench.h
+   for the command-line arguments and report. */
+int main(int argc, char *argv[]) {
+   static const struct BenchOps sOps = {
+      "BDT", BDT_init, BDT_destroy, BDTBench_insert,
+      BDTBench_contains, BDTBench_rm, NULL, BDT_toString, FALSE,
+      NULL
+   };
+
+   return Bench_main(argc, argv, &sOps);
+}
@@ -0,0 +1 @@
+../0shared/bloom.c
\ No newline at end of file
@@ -0,0 +1 @@
+../0shared/bloom.h
\ No newline at end of file
@@ -0,0 +1 @@
+../0shared/btree.c
\ No newline at end of file
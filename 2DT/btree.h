@@ -0,0 +1 @@
+../0shared/btree.h
\ No newline at end of file
@@ -5,18 +5,61 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "checkerDT.h"
+#include "checkerDTExt.h"
 #include "dynarray.h"
 #include "path.h"
 
+/* The default number of CheckerDT_isValidAt calls per full sweep of
+   the hierarchy; can be overridden when compiling */
+#ifndef CHECKERDT_SWEEP_INTERVAL
+#define CHECKERDT_SWEEP_INTERVAL 1024
+#endif
 
+/* The number of CheckerDT_isValidAt calls per full sweep, or 0 for
+   no sweeps; like the count below, it is shared by every DT, so it
+   is only ever accessed atomically */
+static size_t ulSweepInterval = CHECKERDT_SWEEP_INTERVAL;
+
+/* The number of CheckerDT_isValidAt calls so far */
+static size_t ulCalls = 0;
+
+
+
+/*
+   Sets *poPResult to a new path for oNNode, which the caller must
+   free. It is built on the heap from Node_toString, not taken from
+   Node_getPath, so that checking a node does not leave its full path
+   cached in it.
+   Returns SUCCESS, or MEMORY_ERROR if allocation fails, or BAD_PATH
+   if the node's names do not make a well-formed path.
+*/
+static int CheckerDT_newPath(Node_T oNNode, Path_T *poPResult) {
+   char *pcPath;
+   int iStatus;
+
+   assert(oNNode != NULL);
+   assert(poPResult != NULL);
+
+   *poPResult = NULL;
+   pcPath = Node_toString(oNNode);
+   if(pcPath == NULL)
+      return MEMORY_ERROR;
+   iStatus = Path_new(pcPath, poPResult);
+   free(pcPath);
+   return iStatus;
+}
 
 /* see checkerDT.h for specification */
 boolean CheckerDT_Node_isValid(Node_T oNNode) {
    Node_T oNParent;
-   Path_T oPNPath;
-   Path_T oPPPath;
+   Path_T oPNPath = NULL;
+   Path_T oPPPath = NULL;
+   int iNStatus;
+   int iPStatus;
+   boolean bIsValid = TRUE;
 
    /* Sample check: a NULL pointer is not a valid node */
    if(oNNode == NULL) {
@@ -28,18 +71,32 @@ boolean CheckerDT_Node_isValid(Node_T oNNode) {
       proper prefix of the node's path */
    oNParent = Node_getParent(oNNode);
    if(oNParent != NULL) {
-      oPNPath = Node_getPath(oNNode);
-      oPPPath = Node_getPath(oNParent);
+      iNStatus = CheckerDT_newPath(oNNode, &oPNPath);
+      iPStatus = CheckerDT_newPath(oNParent, &oPPPath);
 
-      if(Path_getSharedPrefixDepth(oPNPath, oPPPath) !=
-         Path_getDepth(oPNPath) - 1) {
-         fprintf(stderr, "P-C nodes don't have P-C paths: (%s) (%s)\n",
-                 Path_getPathname(oPPPath), Path_getPathname(oPNPath));
-         return FALSE;
+      if(iNStatus == SUCCESS && iPStatus == SUCCESS) {
+         if(Path_getSharedPrefixDepth(oPNPath, oPPPath) !=
+            Path_getDepth(oPNPath) - 1) {
+            fprintf(stderr,
+                    "P-C nodes don't have P-C paths: (%s) (%s)\n",
+                    Path_getPathname(oPPPath),
+                    Path_getPathname(oPNPath));
+            bIsValid = FALSE;
+         }
       }
+      else if((iNStatus != SUCCESS && iNStatus != MEMORY_ERROR) ||
+              (iPStatus != SUCCESS && iPStatus != MEMORY_ERROR)) {
+         fprintf(stderr, "Node's names do not make a valid path\n");
+         bIsValid = FALSE;
+      }
+
+      if(oPNPath != NULL)
+         Path_free(oPNPath);
+      if(oPPPath != NULL)
+         Path_free(oPPPath);
    }
 
-   return TRUE;
+   return bIsValid;
 }
 
 /*
@@ -96,3 +153,135 @@ boolean CheckerDT_isValid(boolean bIsInitialized, Node_T oNRoot,
    /* Now checks invariants recursively at each node from the root. */
    return CheckerDT_treeCheck(oNRoot);
 }
+
+/*
+   Checks that oNNode is linked into its parent oNParent's children
+   where it belongs: it is found there by its path, and it sorts
+   strictly between the children on either side of it.
+   Returns FALSE if a broken invariant is found and
+   returns TRUE otherwise.
+*/
+static boolean CheckerDT_linkCheck(Node_T oNParent, Node_T oNNode) {
+   Path_T oPNPath = NULL;
+   Node_T oNFound = NULL;
+   Node_T oNSibling = NULL;
+   size_t ulChildID;
+   int iStatus;
+   boolean bIsValid = TRUE;
+
+   /* running out of memory breaks no invariant; it only skips this */
+   iStatus = CheckerDT_newPath(oNNode, &oPNPath);
+   if(iStatus == MEMORY_ERROR)
+      return TRUE;
+   if(iStatus != SUCCESS) {
+      fprintf(stderr, "Node's names do not make a valid path\n");
+      return FALSE;
+   }
+
+   if(!Node_hasChild(oNParent, oPNPath, &ulChildID) ||
+      Node_getChild(oNParent, ulChildID, &oNFound) != SUCCESS ||
+      oNFound != oNNode) {
+      fprintf(stderr, "Node is not among its parent's children: (%s)\n",
+              Path_getPathname(oPNPath));
+      bIsValid = FALSE;
+   }
+   else if(ulChildID > 0 &&
+      Node_getChild(oNParent, ulChildID - 1, &oNSibling) == SUCCESS &&
+      Node_compare(oNSibling, oNNode) >= 0) {
+      fprintf(stderr, "Children are out of order at: (%s)\n",
+              Path_getPathname(oPNPath));
+      bIsValid = FALSE;
+   }
+   else if(Node_getChild(oNParent, ulChildID + 1, &oNSibling) ==
+           SUCCESS && Node_compare(oNNode, oNSibling) >= 0) {
+      fprintf(stderr, "Children are out of order at: (%s)\n",
+              Path_getPathname(oPNPath));
+      bIsValid = FALSE;
+   }
+
+   Path_free(oPNPath);
+   return bIsValid;
+}
+
+/*
+   Checks oNTouched and each of its ancestors, and that the topmost
+   ancestor is oNRoot.
+   Returns FALSE if a broken invariant is found and
+   returns TRUE otherwise.
+*/
+static boolean CheckerDT_touchedCheck(Node_T oNRoot, Node_T oNTouched) {
+   Node_T oNNode;
+   Node_T oNParent;
+   Node_T oNChild = NULL;
+   size_t ulNumChildren;
+
+   /* only the touched node's own children list may have changed
+      length, so check that getChild agrees with getNumChildren */
+   ulNumChildren = Node_getNumChildren(oNTouched);
+   if(ulNumChildren > 0 &&
+      Node_getChild(oNTouched, ulNumChildren - 1, &oNChild) != SUCCESS) {
+      fprintf(stderr,
+              "getNumChildren claims more children than getChild "
+              "returns\n");
+      return FALSE;
+   }
+
+   for(oNNode = oNTouched; oNNode != NULL; oNNode = oNParent) {
+      if(!CheckerDT_Node_isValid(oNNode))
+         return FALSE;
+
+      oNParent = Node_getParent(oNNode);
+      if(oNParent == NULL) {
+         if(oNNode != oNRoot) {
+            fprintf(stderr, "Node's topmost ancestor is not the root\n");
+            return FALSE;
+         }
+      }
+      else if(!CheckerDT_linkCheck(oNParent, oNNode))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+/* see checkerDTExt.h for specification */
+boolean CheckerDT_isValidAt(boolean bIsInitialized, Node_T oNRoot,
+                            size_t ulCount, Node_T oNTouched) {
+
+   size_t ulInterval;
+
+   /* Every so often, fall back to checking everything */
+   ulInterval = __atomic_load_n(&ulSweepInterval, __ATOMIC_RELAXED);
+   if(ulInterval != 0 &&
+      __atomic_add_fetch(&ulCalls, 1, __ATOMIC_RELAXED) %
+      ulInterval == 0)
+      return CheckerDT_isValid(bIsInitialized, oNRoot, ulCount);
+
+   /* The same top-level invariant as CheckerDT_isValid checks */
+   if(!bIsInitialized)
+      if(ulCount != 0) {
+         fprintf(stderr, "Not initialized, but count is not 0\n");
+         return FALSE;
+      }
+
+   if(oNTouched == NULL)
+      return TRUE;
+   return CheckerDT_touchedCheck(oNRoot, oNTouched);
+}
+
+/* see checkerDTExt.h for specification */
+boolean CheckerDT_isValidPath(Node_T oNRoot, Node_T oNTouched) {
+   if(oNTouched == NULL)
+      return TRUE;
+   return CheckerDT_touchedCheck(oNRoot, oNTouched);
+}
+
+/* see checkerDTExt.h for specification */
+void CheckerDT_setSweepInterval(size_t ulInterval) {
+   __atomic_store_n(&ulSweepInterval, ulInterval, __ATOMIC_RELAXED);
+}
+
+/* see checkerDTExt.h for specification */
+size_t CheckerDT_getSweepInterval(void) {
+   return __atomic_load_n(&ulSweepInterval, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* checkerDTExt.h                                                     */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHECKER_EXT_INCLUDED
+#define CHECKER_EXT_INCLUDED
+
+#include "nodeDT.h"
+#include "checkerDT.h"
+
+
+/*
+   The functions below extend the checker interface of checkerDT.h,
+   which the provided dtBad*.o and nodeDTBad*.o call and so must not
+   change. With nodeDTGood, CheckerDT_Node_isValid compares the paths
+   of oNNode and its parent, so it leaves a path cached in each of
+   them (see Node_getPath in nodeDTExt.h); a full check of the
+   hierarchy therefore leaves one in every node, and the other checks
+   one in every node they touch.
+*/
+
+/*
+   Returns TRUE if the hierarchy is in a valid state or FALSE
+   otherwise, like CheckerDT_isValid, but checks only the part of it
+   that an operation touched: oNTouched (which may be NULL if the
+   operation touched no remaining node), its ancestors, and where
+   each of them sits among its siblings. This takes time proportional
+   to oNTouched's depth rather than to the size of the hierarchy.
+   Every CheckerDT_getSweepInterval()'th call also performs the full
+   CheckerDT_isValid check, counting calls for every hierarchy
+   together; calls on different hierarchies may come from several
+   threads at once.
+*/
+boolean CheckerDT_isValidAt(boolean bIsInitialized,
+                            Node_T oNRoot,
+                            size_t ulCount,
+                            Node_T oNTouched);
+
+/*
+   Returns TRUE if the part of the hierarchy that an operation touched
+   is in a valid state or FALSE otherwise, checking oNTouched (which
+   may be NULL) and its ancestors exactly as CheckerDT_isValidAt does,
+   but never the count or the rest of the hierarchy. For writers that
+   hold only the subtree they changed while other writers change
+   other subtrees.
+*/
+boolean CheckerDT_isValidPath(Node_T oNRoot, Node_T oNTouched);
+
+/*
+   Sets to ulInterval how often CheckerDT_isValidAt also checks the
+   whole hierarchy: 1 for on every call, as CheckerDT_isValid does, or
+   0 for never.
+*/
+void CheckerDT_setSweepInterval(size_t ulInterval);
+
+/*
+   Returns how often CheckerDT_isValidAt also checks the whole
+   hierarchy, as set by CheckerDT_setSweepInterval.
+*/
+size_t CheckerDT_getSweepInterval(void);
+
+#endif
@@ -0,0 +1,346 @@
+/*--------------------------------------------------------------------*/
+/* dtExt.h                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef DT_EXT_INCLUDED
+#define DT_EXT_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+#include "a4def.h"
+#include "dt.h"
+
+/*
+  The functions below extend the DT interface of dt.h, which the
+  provided dtBad*.o also implement and so must not change. Only
+  dtGood implements them.
+*/
+
+/*
+  Like DT_init, but with a hint that the DT will grow to about
+  ulExpectedNodes directories, so that memory for that many can be
+  set aside at once rather than bit by bit. DT_initSized(0) is
+  DT_init().
+*/
+int DT_initSized(size_t ulExpectedNodes);
+
+/*
+  Inserts the directories with absolute paths ppcPaths[0] through
+  ppcPaths[ulCount-1] into the DT, as DT_insert would one at a time
+  with the paths sorted in the order DT_toString lists directories,
+  but in a single pass in which paths sharing a prefix share the work
+  of finding or creating it. Paths already in the DT, whether before
+  the call or earlier in the batch, are skipped. The pass sorts a copy
+  of ppcPaths first unless they are sorted already; ppcPaths itself is
+  not changed.
+  Returns SUCCESS if every path not already in the DT was inserted.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * BAD_PATH or CONFLICTING_PATH, as for DT_insert, for the first
+    path in sorted order that was rejected so; the other paths are
+    still inserted
+  * MEMORY_ERROR if memory could not be allocated to complete request;
+    the paths before the failing one in sorted order remain inserted
+*/
+int DT_insertBatch(const char **ppcPaths, size_t ulCount);
+
+/*
+  Inserts into the DT every directory listed in the manifest file
+  named pcFilename, which holds one absolute path per line, as
+  DT_toString returns (the last line need not end with a newline),
+  just as calling DT_insert on each line in turn would, skipping the
+  lines already in the DT. Every line is checked before any is
+  inserted, and the file is read through a mapping rather than copied
+  into memory. Manifests in the order DT_toString lists directories
+  load fastest.
+  Returns SUCCESS if every line was inserted or already present.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * IO_ERROR if the file cannot be opened or mapped
+  * BAD_PATH or CONFLICTING_PATH, as for DT_insert, if some line is
+    one; then nothing is inserted, and if pulLine is not NULL,
+    *pulLine is set to the number (counting from 1) of the first
+    such line (*pulLine is set to 0 with every other status)
+  * MEMORY_ERROR if memory could not be allocated to complete request;
+    the lines before the one that failed remain inserted
+*/
+int DT_load(const char *pcFilename, size_t *pulLine);
+
+/*
+  Writes the same string representation that DT_toString returns
+  (without its trailing '\0') by calling
+  (*pfWrite)(pcChunk, ulLength, pvExtra) with successive pieces of it,
+  each at most a few kilobytes long. Unlike DT_toString, the memory
+  used does not grow with the size of the DT, only with the length of
+  its longest path.
+  Returns SUCCESS if the whole representation was written.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * any other status pfWrite returns, which stops the dump there;
+    pfWrite must return SUCCESS to continue
+*/
+int DT_dump(int (*pfWrite)(const char *pcChunk, size_t ulLength,
+                           void *pvExtra),
+            void *pvExtra);
+
+/*
+  Writes the same string representation that DT_toString returns
+  (without its trailing '\0') to psFile, as DT_dump does. Returns
+  SUCCESS, INITIALIZATION_ERROR, or MEMORY_ERROR as DT_dump does, or
+  IO_ERROR if writing to psFile fails.
+*/
+int DT_dumpToFile(FILE *psFile);
+
+/*
+  Writes a snapshot of the DT to psFile: a binary image of it (in a
+  versioned format of its own, not the text of DT_toString) that
+  DT_loadSnapshot can restore far faster than the DT could be rebuilt
+  a directory at a time. The snapshot is written in one sequential
+  pass, and only on machines with the same byte order can it be
+  loaded again.
+  Returns SUCCESS if the whole snapshot was written.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * IO_ERROR if writing to psFile fails
+*/
+int DT_saveSnapshot(FILE *psFile);
+
+/*
+  Restores into the DT, which must be empty, the directories of the
+  snapshot that DT_saveSnapshot wrote to the file named pcFilename.
+  The file is read through a mapping rather than copied into memory,
+  and the directories are made directly from it, without the paths
+  DT_insert would need.
+  Returns SUCCESS if every directory was restored.
+  Otherwise, returns, leaving the DT unchanged:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * CONFLICTING_PATH if the DT is not empty
+  * IO_ERROR if the file cannot be opened or mapped, or is not a
+    snapshot of a version and byte order this DT can load
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  If the DT is journaled, its journal holds no record of the load, so
+  DT_checkpoint follows it, and its status is returned instead.
+*/
+int DT_loadSnapshot(const char *pcFilename);
+
+/*
+  Makes the DT, which must be empty, durable: restores into it the
+  snapshot in the file named pcSnapshot, if there is one, then replays
+  the changes recorded since in the journal file named pcJournal
+  (which is created if there is none), and from then on records there
+  every change that DT_insert, DT_insertBatch, DT_load, and DT_rm
+  make. After a crash, calling DT_openJournal with the same two files
+  restores every change whose record reached the disk; a record cut
+  short by the crash is dropped. A background thread writes records
+  to the disk in batches, and once the journal has outgrown both the
+  snapshot and a few megabytes, compacts it with DT_checkpoint.
+  DT_destroy writes out the last records and stops the thread.
+  If bWaitsForDisk is TRUE, each change returns only once its record
+  is on the disk (written and fsynced), so no change that returned is
+  lost; changes waiting at the same time share one write and one
+  fsync. If FALSE, changes return as soon as their records are in
+  memory, so they run nearly as fast as without a journal, and reach
+  the disk within about 10 milliseconds (or at DT_syncJournal).
+  If a change cannot be journaled, it is still made in memory, but the
+  call returns IO_ERROR (or MEMORY_ERROR), as does every later change,
+  until DT_checkpoint succeeds.
+  Returns SUCCESS if the DT was restored and is now journaled.
+  Otherwise, returns, leaving the DT empty and not journaled:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * CONFLICTING_PATH if the DT is not empty or is already journaled
+  * IO_ERROR if either file cannot be read or written, or is not a
+    snapshot or journal this DT can load
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int DT_openJournal(const char *pcSnapshot, const char *pcJournal,
+                   boolean bWaitsForDisk);
+
+/*
+  Waits until the record of every change made to the DT so far is on
+  the disk. Returns SUCCESS, at once if the DT is not journaled.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * IO_ERROR or MEMORY_ERROR if the journal could not be written
+*/
+int DT_syncJournal(void);
+
+/*
+  Writes a snapshot of the journaled DT to a new file, which then
+  replaces its snapshot file, and empties its journal of the changes
+  the snapshot holds, so that DT_openJournal restores the DT from the
+  snapshot and only the changes made since. Insertions and removals
+  wait while the snapshot is taken, but not while it is made durable
+  (unless the journal has failed, when they wait until the checkpoint
+  is done); lookups, DT_toString, and dumps do not wait.
+  Returns SUCCESS if the checkpoint was completed, which also clears
+  any failure of the journal.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the DT is not in an initialized state
+  * IO_ERROR if the DT is not journaled, or a file cannot be written;
+    then the old snapshot and journal are kept
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int DT_checkpoint(void);
+
+/*--------------------------------------------------------------------*/
+
+/*
+  The functions above operate on a single DT per process. A DT_T is
+  an independent DT that clients create and free themselves, so a
+  process can hold any number of them. Each function below behaves
+  like the singleton function of the same name, applied to oDTree;
+  a DT_T is always in an initialized state, so none of them return
+  INITIALIZATION_ERROR.
+*/
+
+/*
+  Thread safety: any of these functions, singleton or handle-based,
+  may be called from several threads at once on the same DT, except
+  DT_init, DT_destroy, DT_new, DT_free, and DT_openJournal, which must
+  not overlap any other call on that DT. Lookups, DT_toString and
+  dumps run in parallel with each other; insertions and removals run
+  one at a time. A dump's pfWrite must not modify the DT being dumped.
+  In a DT from DT_newLockFree, DT_treeContains takes no lock at all,
+  so lookups neither wait for insertions and removals nor delay them.
+*/
+typedef struct DT *DT_T;
+
+/*
+  Returns a new, empty DT, or NULL if memory could not be allocated.
+  The counterpart of DT_init.
+*/
+DT_T DT_new(void);
+
+/* Options for DT_newWith, which may be combined with | */
+enum {
+   /* DT_treeContains takes no lock; see DT_newLockFree */
+   DT_LOCK_FREE_LOOKUPS = 1,
+   /* insertions and removals lock only the subtree they change */
+   DT_STRIPED_WRITES = 2,
+   /* directory names are interned, so that equal names anywhere in
+      any DT with this option share one copy, which is kept for as
+      long as the program runs */
+   DT_INTERN_NAMES = 4,
+   /* the DT also keeps a hash index of its directories by absolute
+      path, so that DT_treeContains and DT_treeRm find an existing
+      directory in one probe instead of a search at every level, at
+      the price of the index's memory (see DT_getIndexBytes); has no
+      effect with DT_LOCK_FREE_LOOKUPS */
+   DT_PATH_INDEX = 8,
+   /* the DT also keeps a Bloom filter of its absolute paths, so that
+      DT_treeContains usually rejects a path that is not in the DT
+      from a hash of the string alone, without parsing it or
+      searching (see DT_getFilterCounts); has no effect with
+      DT_LOCK_FREE_LOOKUPS */
+   DT_MISS_FILTER = 16
+};
+
+/*
+  Returns a new, empty DT with the given options, or NULL if memory
+  could not be allocated. DT_newWith(0) is DT_new().
+  With DT_STRIPED_WRITES, each child of the root and everything below
+  it is guarded by one of a fixed set of locks, chosen by the child's
+  name, so insertions and removals of paths at least 3 deep under
+  different children of the root (e.g. one writer per project in
+  "root/project/...") run in parallel. Operations that create or
+  remove the root or its children still take the whole DT, and
+  DT_treeToString and dumps wait for every writer.
+*/
+DT_T DT_newWith(int iOptions);
+
+/*
+  Like DT_newWith, but with a hint that the DT will grow to about
+  ulExpectedNodes directories, as for DT_initSized.
+  DT_newSized(iOptions, 0) is DT_newWith(iOptions).
+  Except with DT_LOCK_FREE_LOOKUPS, a DT keeps its directories in a
+  pool of memory of its own: the memory of removed directories is
+  reused by later insertions, and DT_free and DT_destroy release the
+  whole pool at once instead of visiting every directory.
+*/
+DT_T DT_newSized(int iOptions, size_t ulExpectedNodes);
+
+/*
+  Returns a new, empty DT like DT_new, except that DT_treeContains on
+  it takes no lock: it reads an immutable copy of each directory's
+  subdirectories that insertions and removals replace rather than
+  change, and nodes they remove are freed only once no lookup can
+  still be reading them. This makes lookups scale with threads even
+  while the DT changes, at the price of more memory per directory and
+  insertions and removals that take time linear in the number of
+  subdirectories of the directory they change. Returns NULL if memory
+  could not be allocated.
+*/
+DT_T DT_newLockFree(void);
+
+/*
+  Removes all contents of oDTree and frees it.
+  The counterpart of DT_destroy.
+*/
+void DT_free(DT_T oDTree);
+
+/*
+  Returns the number of bytes oDTree's path index (see DT_PATH_INDEX)
+  currently takes, or 0 if oDTree has none.
+*/
+size_t DT_getIndexBytes(DT_T oDTree);
+
+/*
+  Stores in *pulChecks the number of DT_treeContains calls on oDTree
+  that consulted its miss filter (see DT_MISS_FILTER), in *pulMisses
+  the number of them the filter answered alone, and in
+  *pulFalsePositives the number of them it let through that then did
+  not find their path, so that the filter's false-positive rate is
+  *pulFalsePositives / (*pulMisses + *pulFalsePositives). Stores 0 in
+  all three if oDTree has no filter.
+*/
+void DT_getFilterCounts(DT_T oDTree, size_t *pulChecks,
+                        size_t *pulMisses, size_t *pulFalsePositives);
+
+/* Like DT_insert, on oDTree. */
+int DT_treeInsert(DT_T oDTree, const char *pcPath);
+
+/* Like DT_insertBatch, on oDTree. */
+int DT_treeInsertBatch(DT_T oDTree, const char **ppcPaths,
+                       size_t ulCount);
+
+/* Like DT_load, on oDTree. */
+int DT_treeLoad(DT_T oDTree, const char *pcFilename, size_t *pulLine);
+
+/* Like DT_saveSnapshot, on oDTree. */
+int DT_treeSaveSnapshot(DT_T oDTree, FILE *psFile);
+
+/* Like DT_loadSnapshot, on oDTree. */
+int DT_treeLoadSnapshot(DT_T oDTree, const char *pcFilename);
+
+/* Like DT_openJournal, on oDTree; DT_free closes the journal. */
+int DT_treeOpenJournal(DT_T oDTree, const char *pcSnapshot,
+                       const char *pcJournal, boolean bWaitsForDisk);
+
+/* Like DT_syncJournal, on oDTree. */
+int DT_treeSyncJournal(DT_T oDTree);
+
+/* Like DT_checkpoint, on oDTree. */
+int DT_treeCheckpoint(DT_T oDTree);
+
+/* Like DT_contains, on oDTree. */
+boolean DT_treeContains(DT_T oDTree, const char *pcPath);
+
+/* Like DT_rm, on oDTree. */
+int DT_treeRm(DT_T oDTree, const char *pcPath);
+
+/* Like DT_toString, on oDTree. */
+char *DT_treeToString(DT_T oDTree);
+
+/* Like DT_dump, on oDTree. */
+int DT_treeDump(DT_T oDTree,
+                int (*pfWrite)(const char *pcChunk, size_t ulLength,
+                               void *pvExtra),
+                void *pvExtra);
+
+/* Like DT_dumpToFile, on oDTree. */
+int DT_treeDumpToFile(DT_T oDTree, FILE *psFile);
+
+#endif
@@ -3,30 +3,90 @@
 /* Author: Christopher Moretti                                        */
 /*--------------------------------------------------------------------*/
 
+/* pthread_rwlock_t is POSIX, not ISO C */
+#define _XOPEN_SOURCE 600
+
 #include <stddef.h>
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "arena.h"
+#include "bloom.h"
 #include "dynarray.h"
+#include "epoch.h"
+#include "journal.h"
 #include "path.h"
+#include "pathExt.h"
 #include "nodeDT.h"
+#include "nodeDTExt.h"
 #include "checkerDT.h"
+#include "checkerDTExt.h"
 #include "dt.h"
+#include "dtExt.h"
 
 
 /*
   A Directory Tree is a representation of a hierarchy of directories,
-  represented as an AO with 3 state variables:
+  represented as an ADT with 2 state variables, locks, and a mode:
 */
+struct DT {
+   /* 0. the lock that makes it safe to use from several threads */
+   pthread_rwlock_t sLock;
+   /* 1. a pointer to the root node in the hierarchy */
+   Node_T oNRoot;
+   /* 2. a counter of the number of nodes in the hierarchy */
+   size_t ulCount;
+   /* 3. whether lookups take no lock, reading published nodes */
+   boolean bIsLockFree;
+   /* 4. the locks for the subtrees below the root's children, or
+      NULL if writers always hold sLock exclusively */
+   pthread_rwlock_t *psStripes;
+   /* 5. the arena holding every node and path in the hierarchy, or
+      NULL if they come from the heap */
+   Arena_T oAArena;
+   /* 6. whether the names of the nodes are interned */
+   boolean bInternsNames;
+   /* 7. the index of every node by its absolute path, or NULL if
+      lookups always walk down from the root */
+   struct pathIndex *psIndex;
+   /* 8. the filter of the absolute paths in the hierarchy, or NULL
+      if lookups of missing paths always search for them */
+   struct missFilter *psFilter;
+   /* 9. the journal of the changes to the hierarchy, or NULL if they
+      are not journaled */
+   struct treeJournal *psJournal;
+};
 
-/* 1. a flag for being in an initialized state (TRUE) or not (FALSE) */
+/*
+  The singleton interface (DT_init, DT_insert, ...) operates on one
+  DT of its own, which is usable only while the flag is TRUE.
+*/
 static boolean bIsInitialized;
-/* 2. a pointer to the root node in the hierarchy */
-static Node_T oNRoot;
-/* 3. a counter of the number of nodes in the hierarchy */
-static size_t ulCount;
+static struct DT sDTree = {
+   PTHREAD_RWLOCK_INITIALIZER, NULL, 0, FALSE, NULL, NULL, FALSE, NULL,
+   NULL, NULL
+};
+
+/* The number of subtree locks in a DT with striped writes */
+enum { DT_STRIPES = 64 };
+
+/* The status with which DT_insertPath asks to be retried while
+   holding all of the tree, never returned to clients */
+enum { DT_NEEDS_TREE_LOCK = -1 };
+
+/* The memory a typical node takes from its DT's arena, with its name,
+   inline children and cached path, for turning a hint of how many
+   nodes to expect into one of how many bytes */
+enum { DT_BYTES_PER_NODE = 192 };
 
 
 
@@ -39,371 +99,3058 @@ static size_t ulCount;
 */
 
 /*
-  Traverses the DT starting at the root as far as possible towards
+  Traverses oDTree starting at the root as far as possible towards
   absolute path oPPath. If able to traverse, returns an int SUCCESS
-  status and sets *poNFurthest to the furthest node reached (which may
-  be only a prefix of oPPath, or even NULL if the root is NULL).
+  status, sets *poNFurthest to the furthest node reached (which may
+  be only a prefix of oPPath, or even NULL if the root is NULL), and
+  sets *pulDepth to that node's depth (0 if it is NULL).
   Otherwise, sets *poNFurthest to NULL and returns with status:
   * CONFLICTING_PATH if the root's path is not a prefix of oPPath
-  * MEMORY_ERROR if memory could not be allocated to complete request
+
+  The traversal walks oPPath's components in place, so it makes no
+  allocations and does work linear in oPPath's depth.
 */
-static int DT_traversePath(Path_T oPPath, Node_T *poNFurthest) {
+static int DT_traversePath(DT_T oDTree, Path_T oPPath,
+                           Node_T *poNFurthest, size_t *pulDepth) {
    int iStatus;
-   Path_T oPPrefix = NULL;
    Node_T oNCurr;
    Node_T oNChild = NULL;
    size_t ulDepth;
    size_t i;
-   size_t ulChildID;
 
+   assert(oDTree != NULL);
    assert(oPPath != NULL);
    assert(poNFurthest != NULL);
+   assert(pulDepth != NULL);
+
+   *pulDepth = 0;
 
    /* root is NULL -> won't find anything */
-   if(oNRoot == NULL) {
+   if(oDTree->oNRoot == NULL) {
       *poNFurthest = NULL;
       return SUCCESS;
    }
 
-   iStatus = Path_prefix(oPPath, 1, &oPPrefix);
-   if(iStatus != SUCCESS) {
-      *poNFurthest = NULL;
-      return iStatus;
-   }
-
-   if(Path_comparePath(Node_getPath(oNRoot), oPPrefix)) {
-      Path_free(oPPrefix);
+   /* the root's name must be oPPath's first component */
+   if(strcmp(Node_getName(oDTree->oNRoot),
+             Path_getComponent(oPPath, 0))) {
       *poNFurthest = NULL;
       return CONFLICTING_PATH;
    }
-   Path_free(oPPrefix);
-   oPPrefix = NULL;
 
-   oNCurr = oNRoot;
+   oNCurr = oDTree->oNRoot;
    ulDepth = Path_getDepth(oPPath);
-   for(i = 2; i <= ulDepth; i++) {
-      iStatus = Path_prefix(oPPath, i, &oPPrefix);
+   for(i = 1; i < ulDepth; i++) {
+      iStatus = Node_getChildByComponent(oNCurr, oPPath, i, &oNChild);
       if(iStatus != SUCCESS) {
-         *poNFurthest = NULL;
-         return iStatus;
-      }
-      if(Node_hasChild(oNCurr, oPPrefix, &ulChildID)) {
-         /* go to that child and continue with next prefix */
-         Path_free(oPPrefix);
-         oPPrefix = NULL;
-         iStatus = Node_getChild(oNCurr, ulChildID, &oNChild);
-         if(iStatus != SUCCESS) {
-            *poNFurthest = NULL;
-            return iStatus;
-         }
-         oNCurr = oNChild;
-      }
-      else {
-         /* oNCurr doesn't have child with path oPPrefix:
+         /* oNCurr doesn't have child with component i of oPPath:
             this is as far as we can go */
          break;
       }
+      /* go to that child and continue with next component */
+      oNCurr = oNChild;
    }
 
-   Path_free(oPPrefix);
    *poNFurthest = oNCurr;
+   *pulDepth = i;
    return SUCCESS;
 }
 
 /*
-  Traverses the DT to find a node with absolute path pcPath. Returns a
+  Traverses oDTree to find a node with absolute path oPPath. Returns a
   int SUCCESS status and sets *poNResult to be the node, if found.
   Otherwise, sets *poNResult to NULL and returns with status:
-  * INITIALIZATION_ERROR if the DT is not in an initialized state
-  * BAD_PATH if pcPath does not represent a well-formatted path
-  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
-  * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
-  * MEMORY_ERROR if memory could not be allocated to complete request
+  * CONFLICTING_PATH if the root's path is not a prefix of oPPath
+  * NO_SUCH_PATH if no node with oPPath exists in the hierarchy
+  The caller must hold oDTree's lock.
  */
-static int DT_findNode(const char *pcPath, Node_T *poNResult) {
-   Path_T oPPath = NULL;
+static int DT_findNode(DT_T oDTree, Path_T oPPath, Node_T *poNResult) {
    Node_T oNFound = NULL;
+   size_t ulFoundDepth;
    int iStatus;
 
-   assert(pcPath != NULL);
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
    assert(poNResult != NULL);
 
-   if(!bIsInitialized) {
-      *poNResult = NULL;
-      return INITIALIZATION_ERROR;
-   }
-
-   iStatus = Path_new(pcPath, &oPPath);
+   iStatus = DT_traversePath(oDTree, oPPath, &oNFound, &ulFoundDepth);
    if(iStatus != SUCCESS) {
       *poNResult = NULL;
       return iStatus;
    }
 
-   iStatus = DT_traversePath(oPPath, &oNFound);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return iStatus;
-   }
-
    if(oNFound == NULL) {
-      Path_free(oPPath);
       *poNResult = NULL;
       return NO_SUCH_PATH;
    }
 
-   if(Path_comparePath(Node_getPath(oNFound), oPPath) != 0) {
-      Path_free(oPPath);
+   /* the traversal only follows oPPath's components, so the furthest
+      node is oPPath exactly when it is as deep as oPPath */
+   if(ulFoundDepth != Path_getDepth(oPPath)) {
       *poNResult = NULL;
       return NO_SUCH_PATH;
    }
 
-   Path_free(oPPath);
    *poNResult = oNFound;
    return SUCCESS;
 }
-/*--------------------------------------------------------------------*/
 
+/* --------------------------------------------------------------------
 
-int DT_insert(const char *pcPath) {
-   int iStatus;
-   Path_T oPPath = NULL;
-   Node_T oNFirstNew = NULL;
-   Node_T oNCurr = NULL;
-   size_t ulDepth, ulIndex;
-   size_t ulNewNodes = 0;
+  Each DT has a reader-writer lock: lookups and traversals share it,
+  so any number of them run in parallel, while insertions and
+  removals hold it exclusively. Paths are parsed before taking the
+  lock, to keep the time it is held short.
+
+  A DT with striped writes also has a reader-writer lock per stripe,
+  where each of the root's children (and everything below it) belongs
+  to the stripe its name hashes to. An operation on a path at least 3
+  deep holds sLock shared and only its own stripe exclusively, so
+  writers in different top-level subtrees run in parallel. Changes to
+  the root or its children list still hold sLock exclusively, and
+  traversals of the whole tree hold every stripe.
+*/
 
-   assert(pcPath != NULL);
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
+/* Acquires oDTree's lock for reading. */
+static void DT_readLock(DT_T oDTree) {
+   assert(oDTree != NULL);
 
-   /* validate pcPath and generate a Path_T for it */
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+   (void) pthread_rwlock_rdlock(&oDTree->sLock);
+}
 
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS)
-      return iStatus;
+/* Acquires oDTree's lock for writing. */
+static void DT_writeLock(DT_T oDTree) {
+   assert(oDTree != NULL);
 
-   /* find the closest ancestor of oPPath already in the tree */
-   iStatus= DT_traversePath(oPPath, &oNCurr);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      return iStatus;
-   }
+   (void) pthread_rwlock_wrlock(&oDTree->sLock);
+}
 
-   /* no ancestor node found, so if root is not NULL,
-      pcPath isn't underneath root. */
-   if(oNCurr == NULL && oNRoot != NULL) {
-      Path_free(oPPath);
-      return CONFLICTING_PATH;
+/* Releases oDTree's lock. */
+static void DT_unlock(DT_T oDTree) {
+   assert(oDTree != NULL);
+
+   (void) pthread_rwlock_unlock(&oDTree->sLock);
+}
+
+/*
+  Returns the stripe of oDTree guarding the subtree of oPPath's
+  component at depth 2, which oPPath must have, or NULL if oDTree does
+  not have striped writes.
+*/
+static pthread_rwlock_t *DT_getStripe(DT_T oDTree, Path_T oPPath) {
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
+   assert(Path_getDepth(oPPath) >= 2);
+
+   if(oDTree->psStripes == NULL)
+      return NULL;
+
+   /* the path hashed its components when it was made */
+   return &oDTree->psStripes[Path_getComponentHash(oPPath, 1) %
+                             DT_STRIPES];
+}
+
+/*
+  Acquires what a lookup of oPPath in oDTree must hold: sLock shared
+  and, if oPPath is deep enough to have one, its stripe shared.
+  Returns the stripe, or NULL if none was taken.
+*/
+static pthread_rwlock_t *DT_readLockPath(DT_T oDTree, Path_T oPPath) {
+   pthread_rwlock_t *psStripe = NULL;
+
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
+
+   DT_readLock(oDTree);
+   if(Path_getDepth(oPPath) >= 2) {
+      psStripe = DT_getStripe(oDTree, oPPath);
+      if(psStripe != NULL)
+         (void) pthread_rwlock_rdlock(psStripe);
    }
+   return psStripe;
+}
 
-   ulDepth = Path_getDepth(oPPath);
-   if(oNCurr == NULL) /* new root! */
-      ulIndex = 1;
-   else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+/*
+  Acquires what an insertion or removal of oPPath in oDTree must hold:
+  sLock shared and oPPath's stripe exclusively, if oPPath is at least
+  3 deep and oDTree has striped writes, or else sLock exclusively.
+  Returns the stripe, or NULL if sLock is held exclusively.
+*/
+static pthread_rwlock_t *DT_writeLockPath(DT_T oDTree, Path_T oPPath) {
+   pthread_rwlock_t *psStripe = NULL;
 
-      /* oNCurr is the node we're trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       Node_getPath(oNCurr))) {
-         Path_free(oPPath);
-         return ALREADY_IN_TREE;
-      }
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
+
+   if(Path_getDepth(oPPath) >= 3)
+      psStripe = DT_getStripe(oDTree, oPPath);
+   if(psStripe == NULL) {
+      DT_writeLock(oDTree);
+      return NULL;
    }
+   DT_readLock(oDTree);
+   (void) pthread_rwlock_wrlock(psStripe);
+   return psStripe;
+}
 
-   /* starting at oNCurr, build rest of the path one level at a time */
-   while(ulIndex <= ulDepth) {
-      Path_T oPPrefix = NULL;
-      Node_T oNNewNode = NULL;
+/* Releases psStripe, if not NULL, and then oDTree's lock. */
+static void DT_unlockPath(DT_T oDTree, pthread_rwlock_t *psStripe) {
+   assert(oDTree != NULL);
 
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
-         return iStatus;
-      }
+   if(psStripe != NULL)
+      (void) pthread_rwlock_unlock(psStripe);
+   DT_unlock(oDTree);
+}
 
-      /* insert the new node for this level */
-      iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
-         return iStatus;
-      }
+/* Acquires oDTree's lock and all of its stripes, all shared. */
+static void DT_readLockAll(DT_T oDTree) {
+   size_t i;
 
-      /* set up for next level */
-      Path_free(oPPrefix);
-      oNCurr = oNNewNode;
-      ulNewNodes++;
-      if(oNFirstNew == NULL)
-         oNFirstNew = oNCurr;
-      ulIndex++;
+   assert(oDTree != NULL);
+
+   DT_readLock(oDTree);
+   if(oDTree->psStripes != NULL)
+      for(i = 0; i < DT_STRIPES; i++)
+         (void) pthread_rwlock_rdlock(&oDTree->psStripes[i]);
+}
+
+/* Releases what DT_readLockAll acquired. */
+static void DT_unlockAll(DT_T oDTree) {
+   size_t i;
+
+   assert(oDTree != NULL);
+
+   if(oDTree->psStripes != NULL)
+      for(i = 0; i < DT_STRIPES; i++)
+         (void) pthread_rwlock_unlock(&oDTree->psStripes[i]);
+   DT_unlock(oDTree);
+}
+
+/* --------------------------------------------------------------------
+
+  A DT with a path index also keeps every node in a hash table keyed
+  by its absolute path, so that an exact-match lookup is one probe
+  (and a walk up from the node found to confirm it) instead of a
+  search at every level. The key is a hash code combining the hash
+  codes of the path's components, which a Path_T computes already.
+  Insertions add their new nodes to the index and removals drop the
+  nodes of the subtree as Node_freeWith frees them. Writers that hold
+  only a stripe share the index with other writers, so it has a lock
+  of its own, which DTs without striped writes never need.
+*/
+
+/* The number of slots a path index starts with, a power of 2 */
+enum { DT_INDEX_MIN_SLOTS = 64 };
+
+/* One slot of a path index */
+struct indexSlot {
+   /* the hash code of the node's path (see DT_hashPath) */
+   size_t ulHash;
+   /* the node, or NULL if the slot is empty */
+   Node_T oNNode;
+};
+
+/*
+  A path index: an open addressing (linear probing) hash table of
+  nodes, kept at most half full.
+*/
+struct pathIndex {
+   /* the lock guarding the index if the DT has striped writes */
+   pthread_rwlock_t sLock;
+   /* the number of nodes in the index */
+   size_t ulLength;
+   /* the number of slots in psSlots, a power of 2 */
+   size_t ulSlots;
+   /* the slots */
+   struct indexSlot *psSlots;
+};
+
+/*
+  Returns the hash code of the prefix of oPPath with depth ulDepth, as
+  a polynomial in the hash codes of its components.
+*/
+static size_t DT_hashPath(Path_T oPPath, size_t ulDepth) {
+   size_t ulHash = 0;
+   size_t i;
+
+   assert(oPPath != NULL);
+   assert(ulDepth <= Path_getDepth(oPPath));
+
+   for(i = 0; i < ulDepth; i++)
+      ulHash = ulHash * PATH_HASH_MULTIPLIER +
+         Path_getComponentHash(oPPath, i);
+   return ulHash;
+}
+
+/*
+  Returns the hash code of oNNode's absolute path, the same as
+  DT_hashPath's for that path, computed from the names of oNNode and
+  its ancestors (which, unlike Node_getPath, allocates nothing).
+*/
+static size_t DT_hashNode(Node_T oNNode) {
+   size_t ulHash = 0;
+   size_t ulPower = 1;
+
+   assert(oNNode != NULL);
+
+   /* the polynomial's terms, lowest power (deepest component) first */
+   for(; oNNode != NULL; oNNode = Node_getParent(oNNode)) {
+      ulHash += ulPower * Path_hashComponent(Node_getName(oNNode));
+      ulPower *= PATH_HASH_MULTIPLIER;
    }
+   return ulHash;
+}
 
-   Path_free(oPPath);
-   /* update DT state variables to reflect insertion */
-   if(oNRoot == NULL)
-      oNRoot = oNFirstNew;
-   ulCount += ulNewNodes;
+/*
+  Returns TRUE if oNNode's absolute path is oPPath, comparing names on
+  the way up from oNNode to the root, and FALSE if not.
+*/
+static boolean DT_nodeHasPath(Node_T oNNode, Path_T oPPath) {
+   const char *pcName;
+   const char *pcComponent;
+   size_t ulLevel;
 
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
-   return SUCCESS;
+   assert(oNNode != NULL);
+   assert(oPPath != NULL);
+
+   for(ulLevel = Path_getDepth(oPPath); ulLevel > 0; ulLevel--) {
+      if(oNNode == NULL)
+         return FALSE;
+      pcName = Node_getName(oNNode);
+      pcComponent = Path_getComponent(oPPath, ulLevel - 1);
+      if(pcName != pcComponent && strcmp(pcName, pcComponent))
+         return FALSE;
+      oNNode = Node_getParent(oNNode);
+   }
+   return (boolean) (oNNode == NULL);
 }
 
-boolean DT_contains(const char *pcPath) {
-   int iStatus;
-   Node_T oNFound = NULL;
+/*
+  Returns a new, empty path index with room for about ulExpectedNodes
+  nodes, or NULL if memory could not be allocated.
+*/
+static struct pathIndex *DT_newIndex(size_t ulExpectedNodes) {
+   struct pathIndex *psIndex;
+   size_t ulSlots = DT_INDEX_MIN_SLOTS;
 
-   assert(pcPath != NULL);
+   while(ulSlots <= 2 * ulExpectedNodes)
+      ulSlots *= 2;
+
+   psIndex = malloc(sizeof(struct pathIndex));
+   if(psIndex == NULL)
+      return NULL;
+   psIndex->psSlots = calloc(ulSlots, sizeof(struct indexSlot));
+   if(psIndex->psSlots == NULL ||
+      pthread_rwlock_init(&psIndex->sLock, NULL) != 0) {
+      free(psIndex->psSlots);
+      free(psIndex);
+      return NULL;
+   }
+   psIndex->ulLength = 0;
+   psIndex->ulSlots = ulSlots;
+   return psIndex;
+}
 
-   iStatus = DT_findNode(pcPath, &oNFound);
-   return (boolean) (iStatus == SUCCESS);
+/* Frees psIndex, but none of the nodes in it. */
+static void DT_freeIndex(struct pathIndex *psIndex) {
+   assert(psIndex != NULL);
+
+   (void) pthread_rwlock_destroy(&psIndex->sLock);
+   free(psIndex->psSlots);
+   free(psIndex);
 }
 
+/*
+  Acquires oDTree's index lock, for writing if bForWriting and for
+  reading otherwise, if oDTree has striped writes; without them,
+  holding the DT's lock already excludes every other writer.
+*/
+static void DT_lockIndex(DT_T oDTree, boolean bForWriting) {
+   assert(oDTree != NULL);
+   assert(oDTree->psIndex != NULL);
+
+   if(oDTree->psStripes == NULL)
+      return;
+   if(bForWriting)
+      (void) pthread_rwlock_wrlock(&oDTree->psIndex->sLock);
+   else
+      (void) pthread_rwlock_rdlock(&oDTree->psIndex->sLock);
+}
 
-int DT_rm(const char *pcPath) {
-   int iStatus;
-   Node_T oNFound = NULL;
+/* Releases what DT_lockIndex acquired. */
+static void DT_unlockIndex(DT_T oDTree) {
+   assert(oDTree != NULL);
+   assert(oDTree->psIndex != NULL);
 
-   assert(pcPath != NULL);
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
+   if(oDTree->psStripes != NULL)
+      (void) pthread_rwlock_unlock(&oDTree->psIndex->sLock);
+}
 
-   iStatus = DT_findNode(pcPath, &oNFound);
+/*
+  Stores oNNode, whose path has hash code ulHash, in the first empty
+  slot of psIndex at or after its home slot. psIndex must have an
+  empty slot.
+*/
+static void DT_indexPut(struct pathIndex *psIndex, Node_T oNNode,
+                        size_t ulHash) {
+   size_t ulSlot;
+
+   assert(psIndex != NULL);
+   assert(oNNode != NULL);
+
+   ulSlot = ulHash & (psIndex->ulSlots - 1);
+   while(psIndex->psSlots[ulSlot].oNNode != NULL)
+      ulSlot = (ulSlot + 1) & (psIndex->ulSlots - 1);
+   psIndex->psSlots[ulSlot].ulHash = ulHash;
+   psIndex->psSlots[ulSlot].oNNode = oNNode;
+}
 
-   if(iStatus != SUCCESS)
-       return iStatus;
+/*
+  Makes room in psIndex for ulExtra more nodes, doubling its slots as
+  often as needed to keep it at most half full. Returns SUCCESS, or
+  MEMORY_ERROR (leaving psIndex unchanged) if memory could not be
+  allocated.
+*/
+static int DT_reserveIndex(struct pathIndex *psIndex, size_t ulExtra) {
+   struct indexSlot *psOld;
+   size_t ulOldSlots;
+   size_t ulSlots;
+   size_t i;
 
-   ulCount -= Node_free(oNFound);
-   if(ulCount == 0)
-      oNRoot = NULL;
+   assert(psIndex != NULL);
+
+   ulSlots = psIndex->ulSlots;
+   while(2 * (psIndex->ulLength + ulExtra) > ulSlots)
+      ulSlots *= 2;
+   if(ulSlots == psIndex->ulSlots)
+      return SUCCESS;
 
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
+   psOld = psIndex->psSlots;
+   ulOldSlots = psIndex->ulSlots;
+   psIndex->psSlots = calloc(ulSlots, sizeof(struct indexSlot));
+   if(psIndex->psSlots == NULL) {
+      psIndex->psSlots = psOld;
+      return MEMORY_ERROR;
+   }
+   psIndex->ulSlots = ulSlots;
+   for(i = 0; i < ulOldSlots; i++)
+      if(psOld[i].oNNode != NULL)
+         DT_indexPut(psIndex, psOld[i].oNNode, psOld[i].ulHash);
+   free(psOld);
    return SUCCESS;
 }
 
-int DT_init(void) {
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
+/*
+  Returns the node of oDTree with absolute path oPPath according to
+  its path index, or NULL if there is none. The caller must hold
+  oDTree's lock for reading.
+*/
+static Node_T DT_indexFind(DT_T oDTree, Path_T oPPath) {
+   struct pathIndex *psIndex;
+   Node_T oNNode;
+   size_t ulHash;
+   size_t ulSlot;
+
+   assert(oDTree != NULL);
+   assert(oDTree->psIndex != NULL);
+   assert(oPPath != NULL);
 
-   if(bIsInitialized)
-      return INITIALIZATION_ERROR;
+   psIndex = oDTree->psIndex;
+   ulHash = DT_hashPath(oPPath, Path_getDepth(oPPath));
 
-   bIsInitialized = TRUE;
-   oNRoot = NULL;
-   ulCount = 0;
+   DT_lockIndex(oDTree, FALSE);
+   ulSlot = ulHash & (psIndex->ulSlots - 1);
+   while((oNNode = psIndex->psSlots[ulSlot].oNNode) != NULL) {
+      if(psIndex->psSlots[ulSlot].ulHash == ulHash &&
+         DT_nodeHasPath(oNNode, oPPath))
+         break;
+      ulSlot = (ulSlot + 1) & (psIndex->ulSlots - 1);
+   }
+   DT_unlockIndex(oDTree);
 
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
-   return SUCCESS;
+   return oNNode;
 }
 
-int DT_destroy(void) {
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
+/*
+  Adds the new nodes from oNFirstNew down to oNLast, which form a
+  chain ending at oPPath, to oDTree's path index. Returns SUCCESS, or
+  MEMORY_ERROR (adding none of them) if memory could not be allocated.
+*/
+static int DT_indexChain(DT_T oDTree, Path_T oPPath, Node_T oNFirstNew,
+                         Node_T oNLast) {
+   Node_T oNNode;
+   size_t ulNewNodes = 1;
+   size_t ulDepth;
+   int iStatus;
 
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+   assert(oDTree != NULL);
+   assert(oDTree->psIndex != NULL);
+   assert(oPPath != NULL);
+   assert(oNFirstNew != NULL);
+   assert(oNLast != NULL);
+
+   for(oNNode = oNLast; oNNode != oNFirstNew;
+       oNNode = Node_getParent(oNNode))
+      ulNewNodes++;
 
-   if(oNRoot) {
-      ulCount -= Node_free(oNRoot);
-      oNRoot = NULL;
+   DT_lockIndex(oDTree, TRUE);
+   iStatus = DT_reserveIndex(oDTree->psIndex, ulNewNodes);
+   if(iStatus == SUCCESS) {
+      /* each new node's path is the prefix of oPPath at its depth */
+      ulDepth = Path_getDepth(oPPath);
+      for(oNNode = oNLast; ; oNNode = Node_getParent(oNNode)) {
+         DT_indexPut(oDTree->psIndex, oNNode,
+                     DT_hashPath(oPPath, ulDepth));
+         if(oNNode == oNFirstNew)
+            break;
+         ulDepth--;
+      }
+      oDTree->psIndex->ulLength += ulNewNodes;
    }
+   DT_unlockIndex(oDTree);
 
-   bIsInitialized = FALSE;
+   return iStatus;
+}
 
-   assert(CheckerDT_isValid(bIsInitialized, oNRoot, ulCount));
-   return SUCCESS;
+/*
+  Removes node oNDoomed from the path index pvIndex, shifting back any
+  later nodes in the same probe sequence so that no lookup stops early
+  at the hole. Has the signature Node_freeWith expects.
+*/
+static void DT_unindexNode(Node_T oNDoomed, void *pvIndex) {
+   struct pathIndex *psIndex = pvIndex;
+   size_t ulMask;
+   size_t ulHole;
+   size_t ulNext;
+   size_t ulHome;
+
+   assert(oNDoomed != NULL);
+   assert(psIndex != NULL);
+
+   ulMask = psIndex->ulSlots - 1;
+   ulHole = DT_hashNode(oNDoomed) & ulMask;
+   while(psIndex->psSlots[ulHole].oNNode != oNDoomed) {
+      assert(psIndex->psSlots[ulHole].oNNode != NULL);
+      ulHole = (ulHole + 1) & ulMask;
+   }
+
+   for(ulNext = (ulHole + 1) & ulMask;
+       psIndex->psSlots[ulNext].oNNode != NULL;
+       ulNext = (ulNext + 1) & ulMask) {
+      ulHome = psIndex->psSlots[ulNext].ulHash & ulMask;
+      /* a node may fill the hole only if its home slot is not
+         cyclically after the hole and up to its current slot */
+      if(ulHole <= ulNext ? (ulHome <= ulHole || ulHome > ulNext)
+                          : (ulHome <= ulHole && ulHome > ulNext)) {
+         psIndex->psSlots[ulHole] = psIndex->psSlots[ulNext];
+         ulHole = ulNext;
+      }
+   }
+   psIndex->psSlots[ulHole].oNNode = NULL;
+   psIndex->ulLength--;
 }
 
+/*
+  Frees the subtree rooted at oNNode in oDTree, first removing it from
+  oDTree's path index if there is one. Returns the number of nodes
+  freed.
+*/
+static size_t DT_freeSubtree(DT_T oDTree, Node_T oNNode) {
+   size_t ulCount;
+
+   assert(oDTree != NULL);
+   assert(oNNode != NULL);
+
+   if(oDTree->psIndex == NULL)
+      return Node_free(oNNode);
+
+   DT_lockIndex(oDTree, TRUE);
+   ulCount = Node_freeWith(oNNode, DT_unindexNode, oDTree->psIndex);
+   DT_unlockIndex(oDTree);
+   return ulCount;
+}
 
 /* --------------------------------------------------------------------
 
-  The following auxiliary functions are used for generating the
-  string representation of the DT.
+  Nodes store only their own names, so a traversal that needs each
+  node's full pathname assembles it in a buffer from its parent's
+  pathname, which a pre-order traversal has always just produced.
 */
 
 /*
-  Performs a pre-order traversal of the tree rooted at n,
-  inserting each payload to DynArray_T d beginning at index i.
-  Returns the next unused index in d after the insertion(s).
+  Performs a pre-order traversal of oDTree without recursion, calling
+  (*pfLine)(pcLine, ulLength, pvExtra) with each node's pathname
+  followed by a newline. Stops early if pfLine returns anything but
+  SUCCESS. The only memory used is a buffer for the pathname of the
+  current node and a stack of its ancestors' child indices, so it
+  grows with the depth of oDTree rather than its size.
+  Returns SUCCESS, MEMORY_ERROR if that memory cannot be allocated,
+  or the status pfLine returned.
 */
-static size_t DT_preOrderTraversal(Node_T n, DynArray_T d, size_t i) {
-   size_t c;
+static int DT_preOrderTraversal(DT_T oDTree,
+                                int (*pfLine)(const char *pcLine,
+                                              size_t ulLength,
+                                              void *pvExtra),
+                                void *pvExtra) {
+   Node_T oNNode;
+   Node_T oNNext = NULL;
+   char *pcPath = NULL;
+   size_t *pulIndices = NULL;
+   void *pvNew;
+   const char *pcName;
+   size_t ulPathLength = 0;
+   size_t ulPathCapacity = 0;
+   size_t ulDepth = 0;
+   size_t ulDepthCapacity = 0;
+   size_t ulNameLength;
+   int iStatus = SUCCESS;
+
+   assert(oDTree != NULL);
+   assert(pfLine != NULL);
+
+   oNNode = oDTree->oNRoot;
+   while(oNNode != NULL) {
+      /* extend the parent's pathname with this node's name */
+      pcName = Node_getName(oNNode);
+      ulNameLength = strlen(pcName);
+      if(ulPathLength + ulNameLength + 2 > ulPathCapacity) {
+         ulPathCapacity = 2 * (ulPathLength + ulNameLength + 2);
+         pvNew = realloc(pcPath, ulPathCapacity);
+         if(pvNew == NULL) {
+            iStatus = MEMORY_ERROR;
+            break;
+         }
+         pcPath = pvNew;
+      }
+      if(ulPathLength != 0)
+         pcPath[ulPathLength++] = '/';
+      memcpy(pcPath + ulPathLength, pcName, ulNameLength);
+      ulPathLength += ulNameLength;
+      pcPath[ulPathLength] = '\n';
+
+      iStatus = (*pfLine)(pcPath, ulPathLength + 1, pvExtra);
+      if(iStatus != SUCCESS)
+         break;
 
-   assert(d != NULL);
+      /* visit the first child next, if any... */
+      if(Node_getChild(oNNode, 0, &oNNext) == SUCCESS) {
+         if(ulDepth == ulDepthCapacity) {
+            ulDepthCapacity = 2 * ulDepthCapacity + 16;
+            pvNew = realloc(pulIndices,
+                            ulDepthCapacity * sizeof(size_t));
+            if(pvNew == NULL) {
+               iStatus = MEMORY_ERROR;
+               break;
+            }
+            pulIndices = pvNew;
+         }
+         pulIndices[ulDepth++] = 0;
+         oNNode = oNNext;
+         continue;
+      }
 
-   if(n != NULL) {
-      (void) DynArray_set(d, i, n);
-      i++;
-      for(c = 0; c < Node_getNumChildren(n); c++) {
-         int iStatus;
-         Node_T oNChild = NULL;
-         iStatus = Node_getChild(n,c, &oNChild);
-         assert(iStatus == SUCCESS);
-         i = DT_preOrderTraversal(oNChild, d, i);
+      /* ...or else the next sibling of the nearest ancestor that has
+         one, dropping names from the pathname on the way up */
+      for(;;) {
+         if(ulDepth == 0) {
+            oNNode = NULL;
+            break;
+         }
+         ulPathLength -= strlen(Node_getName(oNNode)) + 1;
+         oNNode = Node_getParent(oNNode);
+         if(Node_getChild(oNNode, ++pulIndices[ulDepth - 1],
+                          &oNNext) == SUCCESS) {
+            oNNode = oNNext;
+            break;
+         }
+         ulDepth--;
       }
    }
-   return i;
+
+   free(pulIndices);
+   free(pcPath);
+   return iStatus;
 }
 
+/* --------------------------------------------------------------------
+
+  A DT with a miss filter also keeps a Bloom filter of the absolute
+  paths in it, so that a lookup of a path that is not there is
+  usually answered from a hash of the string alone, before the path
+  is parsed or the tree is searched. Insertions add their new paths
+  to the filter before making them reachable. Removals cannot take
+  paths out of a Bloom filter, so they only count what they removed;
+  once removed paths make up too much of the filter, or it holds more
+  paths than it was sized for, the next writer to notice rebuilds it
+  from the paths still in the DT. Lookups consult the filter under
+  the DT's shared lock, so the rebuild, holding it exclusively, can
+  replace the filter under them.
+*/
+
+/* The fewest paths a miss filter is sized for */
+enum { DT_FILTER_MIN_PATHS = 1024 };
+
+/* A miss filter, and its counters, which threads may change at the
+   same time */
+struct missFilter {
+   /* the filter of every path in the DT, and perhaps of some paths
+      removed since it was built */
+   Bloom_T oBBloom;
+   /* the number of paths oBBloom was sized for */
+   size_t ulCapacity;
+   /* the number of paths added since the filter was built */
+   size_t ulAdded;
+   /* the number of paths removed since the filter was built */
+   size_t ulRemoved;
+   /* the number of lookups that consulted the filter, that it
+      answered alone, and that it passed on to find nothing */
+   size_t ulChecks;
+   size_t ulMisses;
+   size_t ulFalsePositives;
+};
+
 /*
-  Alternate version of strlen that uses pulAcc as an in-out parameter
-  to accumulate a string length, rather than returning the length of
-  oNNode's path, and also always adds one addition byte to the sum.
+  Adds character c to the two hash codes *pulHash1 and *pulHash2 of
+  the characters before it.
 */
-static void DT_strlenAccumulate(Node_T oNNode, size_t *pulAcc) {
-   assert(pulAcc != NULL);
+static void DT_hashChar(size_t *pulHash1, size_t *pulHash2, char c) {
+   const size_t HASH_MULTIPLIER2 = 31;
+
+   assert(pulHash1 != NULL);
+   assert(pulHash2 != NULL);
 
-   if(oNNode != NULL)
-      *pulAcc += (Path_getStrLength(Node_getPath(oNNode)) + 1);
+   *pulHash1 = *pulHash1 * PATH_HASH_MULTIPLIER + (size_t) c;
+   *pulHash2 = *pulHash2 * HASH_MULTIPLIER2 + (size_t) c;
 }
 
 /*
-  Alternate version of strcat that inverts the typical argument
-  order, appending oNNode's path onto pcAcc, and also always adds one
-  newline at the end of the concatenated string.
+  Returns a new miss filter sized for ulCapacity paths, or
+  DT_FILTER_MIN_PATHS if that is more, or NULL if memory could not be
+  allocated.
 */
-static void DT_strcatAccumulate(Node_T oNNode, char *pcAcc) {
-   assert(pcAcc != NULL);
+static struct missFilter *DT_newFilter(size_t ulCapacity) {
+   struct missFilter *psFilter;
 
-   if(oNNode != NULL) {
-      strcat(pcAcc, Path_getPathname(Node_getPath(oNNode)));
-      strcat(pcAcc, "\n");
+   if(ulCapacity < DT_FILTER_MIN_PATHS)
+      ulCapacity = DT_FILTER_MIN_PATHS;
+
+   psFilter = calloc(1, sizeof(struct missFilter));
+   if(psFilter == NULL)
+      return NULL;
+   psFilter->oBBloom = Bloom_new(ulCapacity);
+   if(psFilter->oBBloom == NULL) {
+      free(psFilter);
+      return NULL;
    }
+   psFilter->ulCapacity = ulCapacity;
+   return psFilter;
 }
-/*--------------------------------------------------------------------*/
-
-char *DT_toString(void) {
-   DynArray_T nodes;
-   size_t totalStrlen = 1;
-   char *result = NULL;
 
-   if(!bIsInitialized)
-      return NULL;
+/* Frees psFilter. */
+static void DT_freeFilter(struct missFilter *psFilter) {
+   assert(psFilter != NULL);
 
-   nodes = DynArray_new(ulCount);
-   (void) DT_preOrderTraversal(oNRoot, nodes, 0);
+   Bloom_free(psFilter->oBBloom);
+   free(psFilter);
+}
 
-   DynArray_map(nodes, (void (*)(void *, void*)) DT_strlenAccumulate,
-                (void*) &totalStrlen);
+/*
+  Adds to oDTree's miss filter the pathnames of the prefixes of
+  well-formed pcPath with depth ulFromDepth or more.
+*/
+static void DT_filterAdd(DT_T oDTree, const char *pcPath,
+                         size_t ulFromDepth) {
+   size_t ulHash1 = 0;
+   size_t ulHash2 = 0;
+   size_t ulDepth = 0;
+   size_t ulAdded = 0;
+
+   assert(oDTree != NULL);
+   assert(oDTree->psFilter != NULL);
+   assert(pcPath != NULL);
 
-   result = malloc(totalStrlen);
-   if(result == NULL) {
-      DynArray_free(nodes);
-      return NULL;
+   /* a prefix's hash codes are those of pcPath up to its end */
+   for(;; pcPath++) {
+      if(*pcPath == '/' || *pcPath == '\0') {
+         ulDepth++;
+         if(ulDepth >= ulFromDepth) {
+            Bloom_add(oDTree->psFilter->oBBloom, ulHash1, ulHash2);
+            ulAdded++;
+         }
+         if(*pcPath == '\0')
+            break;
+      }
+      DT_hashChar(&ulHash1, &ulHash2, *pcPath);
    }
-   *result = '\0';
 
-   DynArray_map(nodes, (void (*)(void *, void*)) DT_strcatAccumulate,
-                (void *) result);
+   (void) __atomic_add_fetch(&oDTree->psFilter->ulAdded, ulAdded,
+                             __ATOMIC_RELAXED);
+}
 
-   DynArray_free(nodes);
+/*
+  Adds the pathname in the ulLength bytes at pcLine, followed by a
+  newline, to the Bloom filter pvBloom. Has the signature
+  DT_preOrderTraversal expects.
+*/
+static int DT_filterLine(const char *pcLine, size_t ulLength,
+                         void *pvBloom) {
+   size_t ulHash1 = 0;
+   size_t ulHash2 = 0;
+   size_t i;
 
-   return result;
+   assert(pcLine != NULL);
+   assert(pvBloom != NULL);
+
+   for(i = 0; i + 1 < ulLength; i++)
+      DT_hashChar(&ulHash1, &ulHash2, pcLine[i]);
+   Bloom_add(pvBloom, ulHash1, ulHash2);
+   return SUCCESS;
+}
+
+/*
+  Returns FALSE if oDTree's miss filter shows that pcPath is certainly
+  not in oDTree, and TRUE if it may be, counting the lookup.
+*/
+static boolean DT_filterMayContain(DT_T oDTree, const char *pcPath) {
+   struct missFilter *psFilter;
+   size_t ulHash1 = 0;
+   size_t ulHash2 = 0;
+   boolean bMayContain;
+
+   assert(oDTree != NULL);
+   assert(oDTree->psFilter != NULL);
+   assert(pcPath != NULL);
+
+   psFilter = oDTree->psFilter;
+   for(; *pcPath != '\0'; pcPath++)
+      DT_hashChar(&ulHash1, &ulHash2, *pcPath);
+
+   DT_readLock(oDTree);
+   bMayContain = Bloom_mayContain(psFilter->oBBloom, ulHash1, ulHash2);
+   DT_unlock(oDTree);
+
+   (void) __atomic_add_fetch(&psFilter->ulChecks, 1, __ATOMIC_RELAXED);
+   if(!bMayContain)
+      (void) __atomic_add_fetch(&psFilter->ulMisses, 1,
+                                __ATOMIC_RELAXED);
+   return bMayContain;
+}
+
+/*
+  Returns TRUE if psFilter holds more paths than it was sized for, or
+  if more than half of the paths added to it have been removed since.
+*/
+static boolean DT_filterIsStale(struct missFilter *psFilter) {
+   size_t ulAdded;
+   size_t ulRemoved;
+
+   assert(psFilter != NULL);
+
+   /* writers check before taking the lock, so the counts may be
+      changing */
+   ulAdded = __atomic_load_n(&psFilter->ulAdded, __ATOMIC_RELAXED);
+   ulRemoved = __atomic_load_n(&psFilter->ulRemoved, __ATOMIC_RELAXED);
+   return (boolean) (ulAdded > __atomic_load_n(&psFilter->ulCapacity,
+                                               __ATOMIC_RELAXED) ||
+                     2 * ulRemoved > ulAdded);
+}
+
+/*
+  Rebuilds oDTree's miss filter from the paths in oDTree, sized for
+  twice as many. Returns SUCCESS, or MEMORY_ERROR, leaving the old
+  filter, if memory could not be allocated. The caller must hold
+  oDTree's lock for writing.
+*/
+static int DT_rebuildFilter(DT_T oDTree) {
+   struct missFilter *psFilter;
+   Bloom_T oBNew;
+   size_t ulCapacity;
+
+   assert(oDTree != NULL);
+   assert(oDTree->psFilter != NULL);
+
+   psFilter = oDTree->psFilter;
+   ulCapacity = 2 * oDTree->ulCount;
+   if(ulCapacity < DT_FILTER_MIN_PATHS)
+      ulCapacity = DT_FILTER_MIN_PATHS;
+   oBNew = Bloom_new(ulCapacity);
+   if(oBNew == NULL)
+      return MEMORY_ERROR;
+   if(DT_preOrderTraversal(oDTree, DT_filterLine, oBNew) != SUCCESS) {
+      Bloom_free(oBNew);
+      return MEMORY_ERROR;
+   }
+
+   Bloom_free(psFilter->oBBloom);
+   psFilter->oBBloom = oBNew;
+   __atomic_store_n(&psFilter->ulCapacity, ulCapacity, __ATOMIC_RELAXED);
+   __atomic_store_n(&psFilter->ulAdded, oDTree->ulCount,
+                    __ATOMIC_RELAXED);
+   __atomic_store_n(&psFilter->ulRemoved, 0, __ATOMIC_RELAXED);
+   return SUCCESS;
+}
+
+/*
+  Rebuilds oDTree's miss filter, as DT_rebuildFilter does, if it is
+  stale. The caller must not hold oDTree's lock. If memory could not
+  be allocated, the old filter, which still holds every path in
+  oDTree, stays.
+*/
+static void DT_refreshFilter(DT_T oDTree) {
+   struct missFilter *psFilter;
+
+   assert(oDTree != NULL);
+
+   psFilter = oDTree->psFilter;
+   if(psFilter == NULL || !DT_filterIsStale(psFilter))
+      return;
+
+   DT_writeLock(oDTree);
+   /* another writer may have rebuilt it first */
+   if(DT_filterIsStale(psFilter))
+      (void) DT_rebuildFilter(oDTree);
+   DT_unlock(oDTree);
+}
+
+/* --------------------------------------------------------------------
+
+  A journaled DT appends a record of each successful insertion and
+  removal to a write-ahead journal while it still holds the lock it
+  made the change under, so that changes to the same part of the tree
+  are journaled in the order they were made, and waits for the record
+  to reach the disk only after releasing the lock, so that the writers
+  waiting meanwhile share a single write and fsync. A background thread
+  writes out records that no writer waits for, and compacts the
+  journal into a snapshot once it has grown larger than the last one.
+*/
+
+/* The operations of journal records, each with an absolute path */
+enum { DT_JOURNAL_INSERT = 'I', DT_JOURNAL_RM = 'R' };
+
+/* The number of milliseconds between the compactor's rounds */
+enum { DT_COMPACT_PERIOD_MS = 10 };
+
+/* The fewest bytes a journal grows to before it is compacted */
+enum { DT_COMPACT_MIN_BYTES = 4 * 1024 * 1024 };
+
+/* A DT's journal, and the state of its compaction */
+struct treeJournal {
+   /* the journal itself */
+   Journal_T oJournal;
+   /* whether each change waits for its record to reach the disk */
+   boolean bWaitsForDisk;
+   /* the name of the snapshot file that compaction writes */
+   char *pcSnapshot;
+   /* the size of the last snapshot */
+   size_t ulSnapshotBytes;
+   /* the lock that makes checkpoints happen one at a time, and guards
+      ulSnapshotBytes and bIsStopping */
+   pthread_mutex_t sMutex;
+   /* signalled to stop the compactor */
+   pthread_cond_t sStop;
+   /* whether the compactor should stop */
+   boolean bIsStopping;
+   /* the compactor */
+   pthread_t sCompactor;
+};
+
+/*
+  Appends a record of operation iOp on oPPath to oDTree's journal, if
+  it has one. Returns SUCCESS and sets *pulRecord to the record's
+  number (or 0 if there is no journal), or returns the status of the
+  journal's failure. The caller must hold the lock the change was made
+  under.
+*/
+static int DT_journalChange(DT_T oDTree, int iOp, Path_T oPPath,
+                            size_t *pulRecord) {
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
+   assert(pulRecord != NULL);
+
+   *pulRecord = 0;
+   if(oDTree->psJournal == NULL)
+      return SUCCESS;
+   /* the record keeps the '\0', so that replay can use it in place */
+   return Journal_append(oDTree->psJournal->oJournal, iOp,
+                         Path_getPathname(oPPath),
+                         Path_getStrLength(oPPath) + 1, pulRecord);
+}
+
+/*
+  Waits until the journal record numbered ulRecord is on disk, if
+  oDTree's changes wait for their records. Returns SUCCESS, or the
+  status of the journal's failure. The caller must not hold oDTree's
+  lock.
+*/
+static int DT_waitForJournal(DT_T oDTree, size_t ulRecord) {
+   assert(oDTree != NULL);
+
+   if(ulRecord == 0 || !oDTree->psJournal->bWaitsForDisk)
+      return SUCCESS;
+   return Journal_wait(oDTree->psJournal->oJournal, ulRecord);
+}
+
+/*
+  Stops oDTree's compactor, writes out its journal, and frees both.
+  Returns SUCCESS, or the status of the journal's failure.
+*/
+static int DT_closeJournal(DT_T oDTree) {
+   struct treeJournal *psJournal;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(oDTree->psJournal != NULL);
+
+   psJournal = oDTree->psJournal;
+   (void) pthread_mutex_lock(&psJournal->sMutex);
+   psJournal->bIsStopping = TRUE;
+   (void) pthread_cond_signal(&psJournal->sStop);
+   (void) pthread_mutex_unlock(&psJournal->sMutex);
+   (void) pthread_join(psJournal->sCompactor, NULL);
+
+   iStatus = Journal_close(psJournal->oJournal);
+   (void) pthread_cond_destroy(&psJournal->sStop);
+   (void) pthread_mutex_destroy(&psJournal->sMutex);
+   free(psJournal->pcSnapshot);
+   free(psJournal);
+   oDTree->psJournal = NULL;
+   return iStatus;
+}
+
+#ifndef NDEBUG
+/*
+  Returns TRUE if oDTree is valid around oNTouched, as far as a writer
+  can tell: everywhere it checks if bHoldsTree (including that its
+  path index, if any, holds as many nodes as oDTree), and only along
+  the path to oNTouched if it holds just a stripe, since other writers
+  may be changing the rest of oDTree and its count.
+*/
+static boolean DT_isValidAt(DT_T oDTree, Node_T oNTouched,
+                            boolean bHoldsTree) {
+   assert(oDTree != NULL);
+
+   if(bHoldsTree && oDTree->psIndex != NULL &&
+      oDTree->psIndex->ulLength != oDTree->ulCount)
+      return FALSE;
+   if(bHoldsTree)
+      return CheckerDT_isValidAt(TRUE, oDTree->oNRoot, oDTree->ulCount,
+                                 oNTouched);
+   return CheckerDT_isValidPath(oDTree->oNRoot, oNTouched);
+}
+
+/*
+  Returns TRUE if oDTree's count is ulCountBefore, as it was before a
+  change, plus the ulAdded nodes the change made and less the
+  ulRemoved nodes it freed, and FALSE otherwise, so that a count that
+  drifts is caught at the change that made it drift rather than at
+  the next full sweep. Returns TRUE if not bHoldsTree, since writers
+  in other stripes may be changing the count too.
+*/
+static boolean DT_isCountValid(DT_T oDTree, size_t ulCountBefore,
+                               size_t ulAdded, size_t ulRemoved,
+                               boolean bHoldsTree) {
+   assert(oDTree != NULL);
+
+   if(!bHoldsTree)
+      return TRUE;
+   return (boolean) (oDTree->ulCount ==
+                     ulCountBefore + ulAdded - ulRemoved);
+}
+
+/*
+  Returns the number of nodes from oNNode up through its ancestors,
+  stopping before oNAncestor, or at the root if oNAncestor is NULL.
+*/
+static size_t DT_countChain(Node_T oNNode, Node_T oNAncestor) {
+   size_t ulNodes = 0;
+
+   for(; oNNode != oNAncestor; oNNode = Node_getParent(oNNode)) {
+      assert(oNNode != NULL);
+      ulNodes++;
+   }
+   return ulNodes;
+}
+#endif
+
+/* --------------------------------------------------------------------
+
+  A lock-free DT also lets lookups run without the lock, so they never
+  wait for insertions and removals (nor hold them up). Writers still
+  take the lock among themselves, and publish each change to the
+  nodes' immutable child tables only once it is complete: a new
+  subtree becomes visible all at once, and a removed one disappears
+  all at once before Node_free retires it. Lookups run between
+  Epoch_enter and Epoch_exit, so nothing they can reach is freed
+  under them.
+*/
+
+/*
+  Makes the new nodes from oNFirstNew down to oNLast, which form a
+  chain, visible to lock-free lookups, deepest first so that the
+  chain is complete before oNFirstNew makes it reachable. Returns
+  SUCCESS, or MEMORY_ERROR if memory could not be allocated, in which
+  case oNFirstNew is still unreachable.
+*/
+static int DT_publishChain(Node_T oNFirstNew, Node_T oNLast) {
+   Node_T oNNode;
+   int iStatus;
+
+   assert(oNFirstNew != NULL);
+   assert(oNLast != NULL);
+
+   for(oNNode = oNLast; ; oNNode = Node_getParent(oNNode)) {
+      iStatus = Node_publish(oNNode);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      if(oNNode == oNFirstNew)
+         break;
+   }
+   return SUCCESS;
+}
+
+/*
+  Returns TRUE if a lock-free lookup finds absolute path oPPath in
+  oDTree, and FALSE if not. The caller must be between Epoch_enter
+  and Epoch_exit.
+*/
+static boolean DT_findPublished(DT_T oDTree, Path_T oPPath) {
+   Node_T oNCurr;
+   size_t ulDepth;
+   size_t i;
+
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
+
+   oNCurr = __atomic_load_n(&oDTree->oNRoot, __ATOMIC_ACQUIRE);
+   if(oNCurr == NULL ||
+      strcmp(Node_getName(oNCurr), Path_getComponent(oPPath, 0)))
+      return FALSE;
+
+   ulDepth = Path_getDepth(oPPath);
+   for(i = 1; i < ulDepth && oNCurr != NULL; i++)
+      oNCurr = Node_getPublishedChild(oNCurr,
+                                      Path_getComponent(oPPath, i));
+   return (boolean) (oNCurr != NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Frees the first ulStripes stripes of oDTree, and the array of them.
+*/
+static void DT_freeStripes(DT_T oDTree, size_t ulStripes) {
+   size_t i;
+
+   assert(oDTree != NULL);
+
+   for(i = 0; i < ulStripes; i++)
+      (void) pthread_rwlock_destroy(&oDTree->psStripes[i]);
+   free(oDTree->psStripes);
+}
+
+DT_T DT_newWith(int iOptions) {
+   return DT_newSized(iOptions, 0);
+}
+
+DT_T DT_newSized(int iOptions, size_t ulExpectedNodes) {
+   DT_T oDTree;
+   size_t i;
+
+   oDTree = malloc(sizeof(struct DT));
+   if(oDTree == NULL)
+      return NULL;
+   if(pthread_rwlock_init(&oDTree->sLock, NULL) != 0) {
+      free(oDTree);
+      return NULL;
+   }
+   oDTree->oNRoot = NULL;
+   oDTree->ulCount = 0;
+   oDTree->psJournal = NULL;
+   oDTree->bIsLockFree =
+      (boolean) ((iOptions & DT_LOCK_FREE_LOOKUPS) != 0);
+   oDTree->bInternsNames =
+      (boolean) ((iOptions & DT_INTERN_NAMES) != 0);
+
+   oDTree->psStripes = NULL;
+   if(iOptions & DT_STRIPED_WRITES) {
+      oDTree->psStripes = malloc(DT_STRIPES * sizeof(pthread_rwlock_t));
+      for(i = 0; oDTree->psStripes != NULL && i < DT_STRIPES; i++)
+         if(pthread_rwlock_init(&oDTree->psStripes[i], NULL) != 0)
+            break;
+      if(oDTree->psStripes == NULL || i < DT_STRIPES) {
+         if(oDTree->psStripes != NULL)
+            DT_freeStripes(oDTree, i);
+         (void) pthread_rwlock_destroy(&oDTree->sLock);
+         free(oDTree);
+         return NULL;
+      }
+   }
+
+   /* lock-free lookups may still be reading a node after it is
+      removed, so its memory must stay with the epoch reclaimer
+      rather than being reused at once */
+   oDTree->oAArena = NULL;
+   if(!oDTree->bIsLockFree) {
+      /* even a DT without striped writes builds cached paths under
+         a shared lock, so the arena is always thread-safe */
+      oDTree->oAArena = Arena_new(ulExpectedNodes * DT_BYTES_PER_NODE,
+                                  TRUE);
+      if(oDTree->oAArena == NULL) {
+         if(oDTree->psStripes != NULL)
+            DT_freeStripes(oDTree, DT_STRIPES);
+         (void) pthread_rwlock_destroy(&oDTree->sLock);
+         free(oDTree);
+         return NULL;
+      }
+   }
+
+   /* lock-free lookups take no lock, so they could not share an
+      index with writers; they walk the published nodes instead */
+   oDTree->psIndex = NULL;
+   if((iOptions & DT_PATH_INDEX) && !oDTree->bIsLockFree) {
+      oDTree->psIndex = DT_newIndex(ulExpectedNodes);
+      if(oDTree->psIndex == NULL) {
+         Arena_free(oDTree->oAArena);
+         if(oDTree->psStripes != NULL)
+            DT_freeStripes(oDTree, DT_STRIPES);
+         (void) pthread_rwlock_destroy(&oDTree->sLock);
+         free(oDTree);
+         return NULL;
+      }
+   }
+
+   /* likewise for the miss filter */
+   oDTree->psFilter = NULL;
+   if((iOptions & DT_MISS_FILTER) && !oDTree->bIsLockFree) {
+      oDTree->psFilter = DT_newFilter(ulExpectedNodes);
+      if(oDTree->psFilter == NULL) {
+         if(oDTree->psIndex != NULL)
+            DT_freeIndex(oDTree->psIndex);
+         Arena_free(oDTree->oAArena);
+         if(oDTree->psStripes != NULL)
+            DT_freeStripes(oDTree, DT_STRIPES);
+         (void) pthread_rwlock_destroy(&oDTree->sLock);
+         free(oDTree);
+         return NULL;
+      }
+   }
+
+   assert(CheckerDT_isValidAt(TRUE, oDTree->oNRoot, oDTree->ulCount,
+                              NULL));
+   return oDTree;
+}
+
+DT_T DT_new(void) {
+   return DT_newWith(0);
+}
+
+DT_T DT_newLockFree(void) {
+   return DT_newWith(DT_LOCK_FREE_LOOKUPS);
+}
+
+void DT_free(DT_T oDTree) {
+   assert(oDTree != NULL);
+   /* tearing down the tree takes linear time anyway, so this is the
+      one place a full check every time costs nothing extra */
+   assert(CheckerDT_isValid(TRUE, oDTree->oNRoot, oDTree->ulCount));
+
+   if(oDTree->psJournal != NULL)
+      (void) DT_closeJournal(oDTree);
+
+   /* every node is in the arena, if there is one, so freeing it
+      frees them all without visiting any */
+   if(oDTree->oAArena != NULL)
+      Arena_free(oDTree->oAArena);
+   else if(oDTree->oNRoot != NULL)
+      (void) Node_free(oDTree->oNRoot);
+   (void) pthread_rwlock_destroy(&oDTree->sLock);
+   if(oDTree->psStripes != NULL)
+      DT_freeStripes(oDTree, DT_STRIPES);
+   if(oDTree->psIndex != NULL)
+      DT_freeIndex(oDTree->psIndex);
+   if(oDTree->psFilter != NULL)
+      DT_freeFilter(oDTree->psFilter);
+   /* no lookups are left, so the retired nodes can go now */
+   if(oDTree->bIsLockFree)
+      Epoch_reclaim();
+   free(oDTree);
+}
+
+size_t DT_getIndexBytes(DT_T oDTree) {
+   size_t ulBytes;
+
+   assert(oDTree != NULL);
+
+   if(oDTree->psIndex == NULL)
+      return 0;
+
+   DT_readLock(oDTree);
+   DT_lockIndex(oDTree, FALSE);
+   ulBytes = sizeof(struct pathIndex) +
+      oDTree->psIndex->ulSlots * sizeof(struct indexSlot);
+   DT_unlockIndex(oDTree);
+   DT_unlock(oDTree);
+   return ulBytes;
+}
+
+void DT_getFilterCounts(DT_T oDTree, size_t *pulChecks,
+                        size_t *pulMisses, size_t *pulFalsePositives) {
+   struct missFilter *psFilter;
+
+   assert(oDTree != NULL);
+   assert(pulChecks != NULL);
+   assert(pulMisses != NULL);
+   assert(pulFalsePositives != NULL);
+
+   psFilter = oDTree->psFilter;
+   if(psFilter == NULL) {
+      *pulChecks = *pulMisses = *pulFalsePositives = 0;
+      return;
+   }
+   *pulChecks = __atomic_load_n(&psFilter->ulChecks, __ATOMIC_RELAXED);
+   *pulMisses = __atomic_load_n(&psFilter->ulMisses, __ATOMIC_RELAXED);
+   *pulFalsePositives = __atomic_load_n(&psFilter->ulFalsePositives,
+                                        __ATOMIC_RELAXED);
+}
+
+/*
+  Creates the nodes for oPPath's prefixes of depth ulIndex (at least
+  1) down to oPPath itself, below oNParent, which must be the node for
+  the prefix of depth ulIndex - 1 (or NULL, making the first new node
+  the root of the empty oDTree). Makes them reachable by every kind of
+  lookup and counts them. Returns SUCCESS and sets *poNLast to the
+  node for oPPath, or returns MEMORY_ERROR, leaving oDTree unchanged,
+  if memory could not be allocated. The caller must hold a lock
+  covering oPPath for writing, as DT_insertPath's caller does.
+*/
+static int DT_addChain(DT_T oDTree, Path_T oPPath, Node_T oNParent,
+                       size_t ulIndex, Node_T *poNLast) {
+   int iStatus = SUCCESS;
+   Node_T oNFirstNew = NULL;
+   Node_T oNCurr = oNParent;
+   size_t ulDepth;
+   size_t ulNewNodes = 0;
+
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
+   assert(ulIndex >= 1 && ulIndex <= Path_getDepth(oPPath));
+   assert(poNLast != NULL);
+
+   /* the new paths must pass the miss filter before lookups can
+      reach them */
+   if(oDTree->psFilter != NULL)
+      DT_filterAdd(oDTree, Path_getPathname(oPPath), ulIndex);
+
+   /* starting at oNParent, build rest of the path one level at a
+      time */
+   ulDepth = Path_getDepth(oPPath);
+   while(ulIndex <= ulDepth) {
+      Node_T oNNewNode = NULL;
+
+      /* insert the new node for this level, straight from oPPath's
+         prefix rather than from a Path_T of its own */
+      iStatus = Node_newIn(oDTree->oAArena, oPPath, ulIndex, oNCurr,
+                           &oNNewNode);
+      if(iStatus != SUCCESS) {
+         if(oNFirstNew != NULL)
+            (void) Node_free(oNFirstNew);
+         return iStatus;
+      }
+
+      /* set up for next level */
+      oNCurr = oNNewNode;
+      ulNewNodes++;
+      if(oNFirstNew == NULL)
+         oNFirstNew = oNCurr;
+      ulIndex++;
+   }
+
+   if(oDTree->bIsLockFree)
+      iStatus = DT_publishChain(oNFirstNew, oNCurr);
+   else if(oDTree->psIndex != NULL)
+      iStatus = DT_indexChain(oDTree, oPPath, oNFirstNew, oNCurr);
+   if(iStatus != SUCCESS) {
+      (void) Node_free(oNFirstNew);
+      return iStatus;
+   }
+
+   /* update DT state variables to reflect insertion (writers in
+      other stripes may be updating the count too) */
+   if(oDTree->oNRoot == NULL)
+      __atomic_store_n(&oDTree->oNRoot, oNFirstNew, __ATOMIC_RELEASE);
+   (void) __atomic_add_fetch(&oDTree->ulCount, ulNewNodes,
+                             __ATOMIC_RELAXED);
+
+   *poNLast = oNCurr;
+   return SUCCESS;
+}
+
+/*
+  Inserts oPPath, and any of its ancestors not yet present, into
+  oDTree, returning the status that DT_treeInsert documents. The
+  caller must hold oDTree's lock for writing if bHoldsTree, or else
+  oPPath's stripe for writing; in the latter case, if the insertion
+  would change the root or its children, nothing changes and
+  DT_NEEDS_TREE_LOCK is returned instead.
+*/
+static int DT_insertPath(DT_T oDTree, Path_T oPPath,
+                         boolean bHoldsTree) {
+   int iStatus;
+   Node_T oNCurr = NULL;
+   Node_T oNLast = NULL;
+   size_t ulDepth, ulIndex;
+   size_t ulCountBefore;
+
+   assert(oDTree != NULL);
+   assert(oPPath != NULL);
+   assert(DT_isValidAt(oDTree, NULL, bHoldsTree));
+
+   /* find the closest ancestor of oPPath already in the tree */
+   iStatus = DT_traversePath(oDTree, oPPath, &oNCurr, &ulIndex);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* a stripe only covers the subtrees below the root's children */
+   if(!bHoldsTree && ulIndex < 2)
+      return DT_NEEDS_TREE_LOCK;
+
+   /* no ancestor node found, so if root is not NULL,
+      oPPath isn't underneath root. */
+   if(oNCurr == NULL && oDTree->oNRoot != NULL)
+      return CONFLICTING_PATH;
+
+   ulDepth = Path_getDepth(oPPath);
+   if(oNCurr == NULL) /* new root! */
+      ulIndex = 1;
+   else {
+      /* start one level below the closest ancestor */
+      ulIndex++;
+
+      /* oNCurr is the node we're trying to insert */
+      if(ulIndex == ulDepth+1)
+         return ALREADY_IN_TREE;
+   }
+
+   ulCountBefore = __atomic_load_n(&oDTree->ulCount, __ATOMIC_RELAXED);
+   iStatus = DT_addChain(oDTree, oPPath, oNCurr, ulIndex, &oNLast);
+   assert(DT_isValidAt(oDTree, iStatus == SUCCESS ? oNLast : oNCurr,
+                       bHoldsTree));
+   assert(DT_isCountValid(oDTree, ulCountBefore, iStatus == SUCCESS ?
+                          DT_countChain(oNLast, oNCurr) : 0, 0,
+                          bHoldsTree));
+   (void) ulCountBefore;
+   return iStatus;
+}
+
+int DT_treeInsert(DT_T oDTree, const char *pcPath) {
+   Path_T oPPath = NULL;
+   pthread_rwlock_t *psStripe;
+   size_t ulRecord = 0;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(pcPath != NULL);
+
+   /* validate pcPath and generate a Path_T for it, whose names the
+      new nodes share if they are interned (lookups and removals do
+      not intern theirs, so that names not in the DT are not kept) */
+   iStatus = Path_newInterned(oDTree->oAArena, pcPath,
+                               oDTree->bInternsNames, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   psStripe = DT_writeLockPath(oDTree, oPPath);
+   iStatus = DT_insertPath(oDTree, oPPath, (boolean) (psStripe == NULL));
+   if(iStatus == DT_NEEDS_TREE_LOCK) {
+      DT_unlockPath(oDTree, psStripe);
+      psStripe = NULL;
+      DT_writeLock(oDTree);
+      iStatus = DT_insertPath(oDTree, oPPath, TRUE);
+   }
+   if(iStatus == SUCCESS)
+      iStatus = DT_journalChange(oDTree, DT_JOURNAL_INSERT, oPPath,
+                                 &ulRecord);
+   DT_unlockPath(oDTree, psStripe);
+
+   Path_free(oPPath);
+   DT_refreshFilter(oDTree);
+   if(iStatus == SUCCESS)
+      iStatus = DT_waitForJournal(oDTree, ulRecord);
+   return iStatus;
+}
+
+/*
+  Returns the rank of character c in the order in which DT_insertBatch
+  sorts pathnames: the end of the pathname first, then the delimiter,
+  then all other characters by value. Sorting pathnames by these ranks
+  sorts paths by their components one at a time, so every path comes
+  after its ancestors and right after the paths it shares the longest
+  prefix with, and siblings come in the order their nodes are kept.
+*/
+static int DT_rankChar(char c) {
+   if(c == '\0')
+      return 0;
+   if(c == '/')
+      return 1;
+   return (int) (unsigned char) c + 2;
+}
+
+/*
+  Compares pathnames pcPath1 and pcPath2 by the ranks of their
+  characters (see DT_rankChar). Returns <0, 0, or >0 if pcPath1 is
+  "less than", "equal to", or "greater than" pcPath2, respectively.
+*/
+static int DT_comparePathnames(const char *pcPath1,
+                               const char *pcPath2) {
+   assert(pcPath1 != NULL);
+   assert(pcPath2 != NULL);
+
+   while(*pcPath1 != '\0' && *pcPath1 == *pcPath2) {
+      pcPath1++;
+      pcPath2++;
+   }
+   return DT_rankChar(*pcPath1) - DT_rankChar(*pcPath2);
+}
+
+/* DT_comparePathnames, on pointers to the pathnames, for qsort. */
+static int DT_comparePathnameAt(const void *pvPath1,
+                                const void *pvPath2) {
+   assert(pvPath1 != NULL);
+   assert(pvPath2 != NULL);
+
+   return DT_comparePathnames(*(const char *const *) pvPath1,
+                              *(const char *const *) pvPath2);
+}
+
+/*
+  Where a run of insertions under one write lock last got to: the
+  nodes along the last path inserted, which the next path can start
+  from as far as it shares a prefix with that one
+*/
+struct insertCursor {
+   /* the last path inserted, or NULL before the first */
+   Path_T oPPrev;
+   /* apoNStack[i] is the node of oPPrev's prefix of depth i + 1, for
+      i < ulReached */
+   Node_T *apoNStack;
+   /* the number of nodes apoNStack has room for */
+   size_t ulSlots;
+   /* the number of nodes of oPPrev's prefixes in apoNStack */
+   size_t ulReached;
+};
+
+/* Frees what psCursor holds. */
+static void DT_freeCursor(struct insertCursor *psCursor) {
+   assert(psCursor != NULL);
+
+   if(psCursor->oPPrev != NULL)
+      Path_free(psCursor->oPPrev);
+   free(psCursor->apoNStack);
+}
+
+/*
+  Inserts oPPath, and any of its ancestors not yet present, into
+  oDTree, starting from psCursor rather than from the root, and moves
+  psCursor to oPPath, which it takes ownership of. Returns SUCCESS and
+  sets *poNNode to oPPath's new node, or returns ALREADY_IN_TREE,
+  CONFLICTING_PATH, or MEMORY_ERROR as DT_insertPath would. The
+  caller must hold oDTree's lock for writing.
+*/
+static int DT_insertAtCursor(DT_T oDTree, struct insertCursor *psCursor,
+                             Path_T oPPath, Node_T *poNNode) {
+   Node_T *apoNBigger;
+   Node_T oNNode;
+   size_t ulDepth;
+   size_t ulShared;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(psCursor != NULL);
+   assert(oPPath != NULL);
+   assert(poNNode != NULL);
+
+   /* keep the nodes of the prefix shared with the previous path */
+   if(psCursor->oPPrev != NULL) {
+      ulShared = Path_getSharedPrefixDepth(psCursor->oPPrev, oPPath);
+      if(ulShared < psCursor->ulReached)
+         psCursor->ulReached = ulShared;
+      Path_free(psCursor->oPPrev);
+   }
+   psCursor->oPPrev = oPPath;
+
+   ulDepth = Path_getDepth(oPPath);
+   if(psCursor->ulSlots < ulDepth) {
+      apoNBigger = realloc(psCursor->apoNStack,
+                           ulDepth * sizeof(Node_T));
+      if(apoNBigger == NULL)
+         return MEMORY_ERROR;
+      psCursor->apoNStack = apoNBigger;
+      psCursor->ulSlots = ulDepth;
+   }
+
+   if(psCursor->ulReached == 0 && oDTree->oNRoot != NULL) {
+      /* the root's name must be oPPath's first component */
+      if(strcmp(Node_getName(oDTree->oNRoot),
+                Path_getComponent(oPPath, 0)))
+         return CONFLICTING_PATH;
+      psCursor->apoNStack[psCursor->ulReached++] = oDTree->oNRoot;
+   }
+
+   /* go on down from there as far as the tree already reaches */
+   while(psCursor->ulReached > 0 && psCursor->ulReached < ulDepth &&
+         Node_getChildByComponent(
+            psCursor->apoNStack[psCursor->ulReached-1], oPPath,
+            psCursor->ulReached, &oNNode) == SUCCESS)
+      psCursor->apoNStack[psCursor->ulReached++] = oNNode;
+   if(psCursor->ulReached == ulDepth)
+      return ALREADY_IN_TREE;
+
+   /* and build the rest: paths in sorted order hand a parent its new
+      children in name order, so each lands after the earlier ones */
+   iStatus = DT_addChain(oDTree, oPPath, psCursor->ulReached > 0 ?
+                         psCursor->apoNStack[psCursor->ulReached-1] :
+                         NULL,
+                         psCursor->ulReached + 1, &oNNode);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   *poNNode = oNNode;
+   while(psCursor->ulReached < ulDepth) {
+      psCursor->apoNStack[--ulDepth] = oNNode;
+      oNNode = Node_getParent(oNNode);
+   }
+   psCursor->ulReached = Path_getDepth(oPPath);
+   return SUCCESS;
+}
+
+int DT_treeInsertBatch(DT_T oDTree, const char **ppcPaths,
+                       size_t ulCount) {
+   const char **ppcSorted = ppcPaths;
+   struct insertCursor sCursor = {NULL, NULL, 0, 0};
+   Path_T oPPath;
+   Node_T oNNode;
+   size_t ulRecord = 0;
+   int iStatus = SUCCESS;
+   int iPathStatus;
+   size_t i;
+
+   assert(oDTree != NULL);
+   assert(ppcPaths != NULL || ulCount == 0);
+
+   /* sort a copy of the pathnames, unless they already are */
+   for(i = 1; i < ulCount; i++)
+      if(DT_comparePathnames(ppcPaths[i-1], ppcPaths[i]) > 0)
+         break;
+   if(i < ulCount) {
+      ppcSorted = malloc(ulCount * sizeof(const char *));
+      if(ppcSorted == NULL)
+         return MEMORY_ERROR;
+      memcpy(ppcSorted, ppcPaths, ulCount * sizeof(const char *));
+      qsort(ppcSorted, ulCount, sizeof(const char *),
+            DT_comparePathnameAt);
+   }
+
+   DT_writeLock(oDTree);
+   assert(DT_isValidAt(oDTree, NULL, TRUE));
+
+   for(i = 0; i < ulCount; i++) {
+      iPathStatus = Path_newInterned(oDTree->oAArena, ppcSorted[i],
+                                     oDTree->bInternsNames, &oPPath);
+      if(iPathStatus == SUCCESS)
+         iPathStatus = DT_insertAtCursor(oDTree, &sCursor, oPPath,
+                                         &oNNode);
+      /* oPPath now belongs to the cursor, which keeps it until the
+         next path */
+      if(iPathStatus == SUCCESS)
+         iPathStatus = DT_journalChange(oDTree, DT_JOURNAL_INSERT,
+                                        oPPath, &ulRecord);
+      if(iPathStatus == SUCCESS || iPathStatus == ALREADY_IN_TREE)
+         continue;
+      if(iStatus == SUCCESS || iPathStatus == MEMORY_ERROR ||
+         iPathStatus == IO_ERROR)
+         iStatus = iPathStatus;
+      if(iPathStatus == MEMORY_ERROR || iPathStatus == IO_ERROR)
+         break;
+   }
+
+   assert(DT_isValidAt(oDTree, NULL, TRUE));
+   DT_unlock(oDTree);
+
+   DT_freeCursor(&sCursor);
+   if(ppcSorted != ppcPaths)
+      free(ppcSorted);
+   DT_refreshFilter(oDTree);
+   /* the whole batch waits for the disk once */
+   if(iStatus == SUCCESS)
+      iStatus = DT_waitForJournal(oDTree, ulRecord);
+   return iStatus;
+}
+
+/* --------------------------------------------------------------------
+
+  DT_treeLoad reads a manifest, a file listing one absolute path per
+  line (as DT_toString does), straight from a mapping of the file. A
+  first pass, made before the DT is locked, checks every line, so that
+  a bad manifest changes nothing, and counts how many children each
+  line's directory is listed with. A second pass inserts the lines in
+  order, each starting from where the previous one left off, and sets
+  aside room for each new directory's children as soon as it is made.
+*/
+
+/*
+  Maps the file named pcFilename into memory for reading from start to
+  end. Returns SUCCESS and sets *ppcText to the mapping and *pulSize
+  to its size, which the caller passes to munmap, unless it is 0:
+  then there is no mapping, and *ppcText is NULL. Otherwise returns
+  IO_ERROR if the file cannot be opened or mapped.
+*/
+static int DT_mapFile(const char *pcFilename, const char **ppcText,
+                      size_t *pulSize) {
+   int iFile;
+   struct stat sStat;
+   void *pvText;
+
+   assert(pcFilename != NULL);
+   assert(ppcText != NULL);
+   assert(pulSize != NULL);
+
+   *ppcText = NULL;
+   *pulSize = 0;
+
+   iFile = open(pcFilename, O_RDONLY);
+   if(iFile < 0)
+      return IO_ERROR;
+   if(fstat(iFile, &sStat) != 0) {
+      (void) close(iFile);
+      return IO_ERROR;
+   }
+   /* an empty file cannot be mapped, and need not be */
+   if(sStat.st_size == 0) {
+      (void) close(iFile);
+      return SUCCESS;
+   }
+   pvText = mmap(NULL, (size_t) sStat.st_size, PROT_READ, MAP_PRIVATE,
+                 iFile, 0);
+   (void) close(iFile);
+   if(pvText == MAP_FAILED)
+      return IO_ERROR;
+   (void) posix_madvise(pvText, (size_t) sStat.st_size,
+                        POSIX_MADV_SEQUENTIAL);
+
+   *ppcText = pvText;
+   *pulSize = (size_t) sStat.st_size;
+   return SUCCESS;
+}
+
+/* One line of a manifest, as the first pass last saw at its depth */
+struct manifestLine {
+   /* the line, which ends at a '\n' rather than a '\0' */
+   const char *pcLine;
+   /* the line's length */
+   size_t ulLength;
+   /* the line's index, counting from 0 */
+   size_t ulIndex;
+};
+
+/*
+  Sets *pulLength to the length of the line at pcLine, which ends at
+  the next '\n' or else at pcEnd, and returns where the next line
+  begins.
+*/
+static const char *DT_nextLine(const char *pcLine, const char *pcEnd,
+                               size_t *pulLength) {
+   const char *pcNewline;
+
+   assert(pcLine != NULL);
+   assert(pcEnd != NULL);
+   assert(pulLength != NULL);
+
+   pcNewline = memchr(pcLine, '\n', (size_t) (pcEnd - pcLine));
+   if(pcNewline == NULL) {
+      *pulLength = (size_t) (pcEnd - pcLine);
+      return pcEnd;
+   }
+   *pulLength = (size_t) (pcNewline - pcLine);
+   return pcNewline + 1;
+}
+
+/*
+  Checks the lines of the manifest in the ulSize characters at pcText
+  as the first pass over it. Returns SUCCESS and sets *paulChildren to
+  a new array holding, for each line, the number of later lines that
+  list its directory's children in the order DT_toString would.
+  Otherwise, returns BAD_PATH or CONFLICTING_PATH, as DT_insert would
+  into an empty DT for the first line that is one, and sets *pulLine
+  to that line's number (counting from 1), or returns MEMORY_ERROR.
+  Either way, if the first line is a good path, sets *ppcRoot and
+  *pulRootLength to its first component, which every line up to the
+  one that failed shares; otherwise, sets *ppcRoot to NULL.
+*/
+static int DT_checkManifest(const char *pcText, size_t ulSize,
+                            size_t **paulChildren, size_t *pulLine,
+                            const char **ppcRoot,
+                            size_t *pulRootLength) {
+   const char *pcEnd = pcText + ulSize;
+   const char *pcLine = pcText;
+   const char *pcNext;
+   const char *pcSlash;
+   const char *pcRoot = NULL;
+   size_t ulRootLength = 0;
+   size_t ulLength;
+   size_t ulDepth;
+   size_t *aulChildren = NULL;
+   size_t *aulBigger;
+   size_t ulLines = 0;
+   size_t ulLineSlots = 0;
+   /* psStack[i] is the last line of depth i + 1, for i < ulStacked */
+   struct manifestLine *psStack = NULL;
+   struct manifestLine *psBigger;
+   struct manifestLine *psParent;
+   size_t ulStacked = 0;
+   size_t ulStackSlots = 0;
+   int iStatus = SUCCESS;
+
+   assert(pcText != NULL);
+   assert(paulChildren != NULL);
+   assert(pulLine != NULL);
+   assert(ppcRoot != NULL);
+   assert(pulRootLength != NULL);
+
+   for(; pcLine < pcEnd; pcLine = pcNext, ulLines++) {
+      pcNext = DT_nextLine(pcLine, pcEnd, &ulLength);
+
+      iStatus = Path_checkSpan(pcLine, ulLength, &ulDepth);
+      if(iStatus != SUCCESS)
+         break;
+
+      /* the first component must be the one the first line names */
+      if(pcRoot == NULL) {
+         pcRoot = pcLine;
+         pcSlash = memchr(pcLine, '/', ulLength);
+         ulRootLength = pcSlash == NULL ? ulLength :
+            (size_t) (pcSlash - pcLine);
+      }
+      if(ulLength < ulRootLength ||
+         (ulLength > ulRootLength && pcLine[ulRootLength] != '/') ||
+         memcmp(pcLine, pcRoot, ulRootLength) != 0) {
+         iStatus = CONFLICTING_PATH;
+         break;
+      }
+
+      if(ulLines == ulLineSlots) {
+         ulLineSlots = ulLineSlots == 0 ? 1024 : 2 * ulLineSlots;
+         aulBigger = realloc(aulChildren, ulLineSlots * sizeof(size_t));
+         if(aulBigger == NULL) {
+            iStatus = MEMORY_ERROR;
+            break;
+         }
+         aulChildren = aulBigger;
+      }
+      aulChildren[ulLines] = 0;
+
+      if(ulDepth > ulStackSlots) {
+         psBigger = realloc(psStack,
+                            2 * ulDepth * sizeof(struct manifestLine));
+         if(psBigger == NULL) {
+            iStatus = MEMORY_ERROR;
+            break;
+         }
+         psStack = psBigger;
+         ulStackSlots = 2 * ulDepth;
+      }
+
+      /* count the line as a child of the last line one level up, if
+         that one is its parent */
+      if(ulDepth > 1 && ulDepth - 1 <= ulStacked) {
+         psParent = &psStack[ulDepth - 2];
+         if(psParent->ulLength < ulLength &&
+            pcLine[psParent->ulLength] == '/' &&
+            memcmp(pcLine, psParent->pcLine, psParent->ulLength) == 0)
+            aulChildren[psParent->ulIndex]++;
+      }
+      psStack[ulDepth - 1].pcLine = pcLine;
+      psStack[ulDepth - 1].ulLength = ulLength;
+      psStack[ulDepth - 1].ulIndex = ulLines;
+      ulStacked = ulDepth;
+   }
+
+   free(psStack);
+   *ppcRoot = pcRoot;
+   *pulRootLength = ulRootLength;
+   if(iStatus != SUCCESS) {
+      free(aulChildren);
+      if(iStatus != MEMORY_ERROR)
+         *pulLine = ulLines + 1;
+      return iStatus;
+   }
+   *paulChildren = aulChildren;
+   return SUCCESS;
+}
+
+int DT_treeLoad(DT_T oDTree, const char *pcFilename, size_t *pulLine) {
+   size_t ulSize;
+   const char *pcText;
+   const char *pcLine;
+   const char *pcNext;
+   const char *pcEnd;
+   size_t ulLength;
+   size_t *aulChildren = NULL;
+   size_t ulBadLine = 0;
+   const char *pcRoot;
+   const char *pcTreeRoot;
+   size_t ulRootLength;
+   struct insertCursor sCursor = {NULL, NULL, 0, 0};
+   Path_T oPPath;
+   Node_T oNNode;
+   size_t ulRecord = 0;
+   int iStatus;
+   size_t i;
+
+   assert(oDTree != NULL);
+   assert(pcFilename != NULL);
+
+   if(pulLine != NULL)
+      *pulLine = 0;
+
+   iStatus = DT_mapFile(pcFilename, &pcText, &ulSize);
+   /* an empty manifest lists nothing */
+   if(iStatus != SUCCESS || ulSize == 0)
+      return iStatus;
+   pcEnd = pcText + ulSize;
+
+   /* check the lines before taking the lock, so that other threads
+      wait only while the lines are inserted */
+   iStatus = DT_checkManifest(pcText, ulSize, &aulChildren, &ulBadLine,
+                              &pcRoot, &ulRootLength);
+
+   DT_writeLock(oDTree);
+   assert(DT_isValidAt(oDTree, NULL, TRUE));
+
+   /* every line checked begins with the manifest's root, so if
+      oDTree's root is another, the first line is the first conflict */
+   if(pcRoot != NULL && oDTree->oNRoot != NULL) {
+      pcTreeRoot = Node_getName(oDTree->oNRoot);
+      if(strlen(pcTreeRoot) != ulRootLength ||
+         memcmp(pcTreeRoot, pcRoot, ulRootLength) != 0) {
+         iStatus = CONFLICTING_PATH;
+         ulBadLine = 1;
+      }
+   }
+
+   for(pcLine = pcText, i = 0; iStatus == SUCCESS && pcLine < pcEnd;
+       pcLine = pcNext, i++) {
+      pcNext = DT_nextLine(pcLine, pcEnd, &ulLength);
+      iStatus = Path_newSpan(oDTree->oAArena, pcLine, ulLength,
+                             oDTree->bInternsNames, &oPPath);
+      if(iStatus == SUCCESS)
+         iStatus = DT_insertAtCursor(oDTree, &sCursor, oPPath,
+                                     &oNNode);
+      if(iStatus == SUCCESS)
+         iStatus = DT_journalChange(oDTree, DT_JOURNAL_INSERT, oPPath,
+                                    &ulRecord);
+      /* its children come next, if the manifest is in order; if
+         there is no room for them, they are added one at a time */
+      if(iStatus == SUCCESS && aulChildren[i] > 0)
+         (void) Node_reserveChildren(oNNode, aulChildren[i]);
+      if(iStatus == ALREADY_IN_TREE)
+         iStatus = SUCCESS;
+   }
+
+   assert(DT_isValidAt(oDTree, NULL, TRUE));
+   DT_unlock(oDTree);
+
+   DT_freeCursor(&sCursor);
+   free(aulChildren);
+   (void) munmap((void *) pcText, ulSize);
+   DT_refreshFilter(oDTree);
+   if(iStatus == SUCCESS)
+      iStatus = DT_waitForJournal(oDTree, ulRecord);
+   if(pulLine != NULL)
+      *pulLine = ulBadLine;
+   return iStatus;
+}
+
+boolean DT_treeContains(DT_T oDTree, const char *pcPath) {
+   Path_T oPPath = NULL;
+   Node_T oNFound = NULL;
+   pthread_rwlock_t *psStripe;
+   boolean bIsFound;
+
+   assert(oDTree != NULL);
+   assert(pcPath != NULL);
+
+   /* a definite miss needs neither a path nor a search */
+   if(oDTree->psFilter != NULL && !DT_filterMayContain(oDTree, pcPath))
+      return FALSE;
+
+   /* the path is only needed for this lookup, so it comes from the
+      heap rather than the arena, whose mutex would serialize readers */
+   if(Path_new(pcPath, &oPPath) != SUCCESS)
+      bIsFound = FALSE;
+   else if(oDTree->bIsLockFree && Epoch_enter()) {
+      bIsFound = DT_findPublished(oDTree, oPPath);
+      Epoch_exit();
+   }
+   else {
+      psStripe = DT_readLockPath(oDTree, oPPath);
+      if(oDTree->psIndex != NULL)
+         bIsFound = (boolean) (DT_indexFind(oDTree, oPPath) != NULL);
+      else
+         bIsFound = (boolean) (DT_findNode(oDTree, oPPath, &oNFound) ==
+                               SUCCESS);
+      DT_unlockPath(oDTree, psStripe);
+   }
+   Path_free(oPPath);
+
+   if(!bIsFound && oDTree->psFilter != NULL)
+      (void) __atomic_add_fetch(&oDTree->psFilter->ulFalsePositives, 1,
+                                __ATOMIC_RELAXED);
+   return bIsFound;
+}
+
+int DT_treeRm(DT_T oDTree, const char *pcPath) {
+   Path_T oPPath = NULL;
+   Node_T oNFound = NULL;
+   Node_T oNParent;
+   pthread_rwlock_t *psStripe;
+   size_t ulRemoved;
+   size_t ulCountBefore;
+   size_t ulRecord = 0;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(pcPath != NULL);
+
+   /* as in DT_treeContains, the path is only for finding the node */
+   iStatus = Path_new(pcPath, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   psStripe = DT_writeLockPath(oDTree, oPPath);
+   assert(DT_isValidAt(oDTree, NULL, (boolean) (psStripe == NULL)));
+
+   /* an index hit needs no walk; a miss walks anyway, to tell a
+      conflicting path from a missing one */
+   if(oDTree->psIndex != NULL &&
+      (oNFound = DT_indexFind(oDTree, oPPath)) != NULL)
+      iStatus = SUCCESS;
+   else
+      iStatus = DT_findNode(oDTree, oPPath, &oNFound);
+   /* hide the subtree from lock-free lookups before freeing it */
+   if(iStatus == SUCCESS && oDTree->bIsLockFree)
+      iStatus = Node_unpublish(oNFound);
+   if(iStatus == SUCCESS) {
+      oNParent = Node_getParent(oNFound);
+      if(oNParent == NULL)
+         __atomic_store_n(&oDTree->oNRoot, NULL, __ATOMIC_RELEASE);
+      ulCountBefore = __atomic_load_n(&oDTree->ulCount,
+                                      __ATOMIC_RELAXED);
+      ulRemoved = DT_freeSubtree(oDTree, oNFound);
+      (void) __atomic_sub_fetch(&oDTree->ulCount, ulRemoved,
+                                __ATOMIC_RELAXED);
+      if(oDTree->psFilter != NULL)
+         (void) __atomic_add_fetch(&oDTree->psFilter->ulRemoved,
+                                   ulRemoved, __ATOMIC_RELAXED);
+
+      assert(DT_isValidAt(oDTree, oNParent,
+                          (boolean) (psStripe == NULL)));
+      assert(DT_isCountValid(oDTree, ulCountBefore, 0, ulRemoved,
+                             (boolean) (psStripe == NULL)));
+      (void) ulCountBefore;
+      iStatus = DT_journalChange(oDTree, DT_JOURNAL_RM, oPPath,
+                                 &ulRecord);
+   }
+
+   DT_unlockPath(oDTree, psStripe);
+   Path_free(oPPath);
+   DT_refreshFilter(oDTree);
+   if(iStatus == SUCCESS)
+      iStatus = DT_waitForJournal(oDTree, ulRecord);
+   return iStatus;
+}
+
+/* --------------------------------------------------------------------
+
+  The singleton interface checks that its DT is initialized, then
+  forwards to the handle-based one.
+*/
+
+int DT_insert(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeInsert(&sDTree, pcPath);
+}
+
+int DT_insertBatch(const char **ppcPaths, size_t ulCount) {
+   assert(ppcPaths != NULL || ulCount == 0);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeInsertBatch(&sDTree, ppcPaths, ulCount);
+}
+
+int DT_load(const char *pcFilename, size_t *pulLine) {
+   assert(pcFilename != NULL);
+
+   if(!bIsInitialized) {
+      if(pulLine != NULL)
+         *pulLine = 0;
+      return INITIALIZATION_ERROR;
+   }
+   return DT_treeLoad(&sDTree, pcFilename, pulLine);
+}
+
+boolean DT_contains(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return FALSE;
+   return DT_treeContains(&sDTree, pcPath);
+}
+
+int DT_rm(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeRm(&sDTree, pcPath);
+}
+
+int DT_init(void) {
+   return DT_initSized(0);
+}
+
+int DT_initSized(size_t ulExpectedNodes) {
+   assert(CheckerDT_isValidAt(bIsInitialized, sDTree.oNRoot,
+                              sDTree.ulCount, NULL));
+
+   if(bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   bIsInitialized = TRUE;
+   sDTree.oNRoot = NULL;
+   sDTree.ulCount = 0;
+   /* without an arena, nodes simply come from the heap instead */
+   sDTree.oAArena = Arena_new(ulExpectedNodes * DT_BYTES_PER_NODE,
+                              TRUE);
+
+   assert(CheckerDT_isValidAt(bIsInitialized, sDTree.oNRoot,
+                              sDTree.ulCount, NULL));
+   return SUCCESS;
+}
+
+int DT_destroy(void) {
+   /* tearing down the tree takes linear time anyway, so this is the
+      one place a full check every time costs nothing extra */
+   assert(CheckerDT_isValid(bIsInitialized, sDTree.oNRoot,
+                            sDTree.ulCount));
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   if(sDTree.psJournal != NULL)
+      (void) DT_closeJournal(&sDTree);
+
+   if(sDTree.oAArena != NULL) {
+      Arena_free(sDTree.oAArena);
+      sDTree.oAArena = NULL;
+      sDTree.ulCount = 0;
+   }
+   else if(sDTree.oNRoot)
+      sDTree.ulCount -= Node_free(sDTree.oNRoot);
+   sDTree.oNRoot = NULL;
+
+   bIsInitialized = FALSE;
+
+   assert(CheckerDT_isValidAt(bIsInitialized, sDTree.oNRoot,
+                              sDTree.ulCount, NULL));
+   return SUCCESS;
+}
+
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions are used for generating the
+  string representation of the DT from DT_preOrderTraversal.
+*/
+
+/* The most bytes DT_dump passes to its callback at once */
+enum { DT_DUMP_CHUNK = 4096 };
+
+/* The state of a dump in progress */
+struct dumpSink {
+   /* the client's callback, and its extra argument */
+   int (*pfWrite)(const char *pcChunk, size_t ulLength, void *pvExtra);
+   void *pvExtra;
+   /* the number of bytes waiting in acChunk */
+   size_t ulFilled;
+   /* the bytes not yet passed to pfWrite */
+   char acChunk[DT_DUMP_CHUNK];
+};
+
+/* Adds ulLength to the total length *pvTotal. */
+static int DT_countLine(const char *pcLine, size_t ulLength,
+                        void *pvTotal) {
+   assert(pcLine != NULL);
+   assert(pvTotal != NULL);
+
+   (void) pcLine;
+   *(size_t *) pvTotal += ulLength;
+   return SUCCESS;
+}
+
+/* Copies the ulLength bytes at pcLine to *pvEnd and advances it. */
+static int DT_copyLine(const char *pcLine, size_t ulLength,
+                       void *pvEnd) {
+   char **ppcEnd = pvEnd;
+
+   assert(pcLine != NULL);
+   assert(ppcEnd != NULL);
+
+   memcpy(*ppcEnd, pcLine, ulLength);
+   *ppcEnd += ulLength;
+   return SUCCESS;
+}
+
+/* Passes the bytes waiting in *psSink to its callback. */
+static int DT_flushSink(struct dumpSink *psSink) {
+   int iStatus = SUCCESS;
+
+   assert(psSink != NULL);
+
+   if(psSink->ulFilled != 0)
+      iStatus = (*psSink->pfWrite)(psSink->acChunk, psSink->ulFilled,
+                                   psSink->pvExtra);
+   psSink->ulFilled = 0;
+   return iStatus;
+}
+
+/*
+  Adds the ulLength bytes at pcLine to the dump *pvSink, passing them
+  on in full chunks.
+*/
+static int DT_sinkLine(const char *pcLine, size_t ulLength,
+                       void *pvSink) {
+   struct dumpSink *psSink = pvSink;
+   size_t ulPart;
+   int iStatus;
+
+   assert(pcLine != NULL);
+   assert(psSink != NULL);
+
+   while(ulLength != 0) {
+      ulPart = DT_DUMP_CHUNK - psSink->ulFilled;
+      if(ulPart > ulLength)
+         ulPart = ulLength;
+      memcpy(psSink->acChunk + psSink->ulFilled, pcLine, ulPart);
+      psSink->ulFilled += ulPart;
+      pcLine += ulPart;
+      ulLength -= ulPart;
+
+      if(psSink->ulFilled == DT_DUMP_CHUNK) {
+         iStatus = DT_flushSink(psSink);
+         if(iStatus != SUCCESS)
+            return iStatus;
+      }
+   }
+   return SUCCESS;
+}
+
+/* Writes the ulLength bytes at pcChunk to the stream pvFile. */
+static int DT_writeChunk(const char *pcChunk, size_t ulLength,
+                         void *pvFile) {
+   assert(pcChunk != NULL);
+   assert(pvFile != NULL);
+
+   if(fwrite(pcChunk, 1, ulLength, pvFile) != ulLength)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+char *DT_treeToString(DT_T oDTree) {
+   size_t totalStrlen = 1;
+   char *result = NULL;
+   char *end;
+
+   assert(oDTree != NULL);
+
+   /* both passes must see the same tree */
+   DT_readLockAll(oDTree);
+
+   if(DT_preOrderTraversal(oDTree, DT_countLine, &totalStrlen) != SUCCESS) {
+      DT_unlockAll(oDTree);
+      return NULL;
+   }
+
+   result = malloc(totalStrlen);
+   if(result == NULL) {
+      DT_unlockAll(oDTree);
+      return NULL;
+   }
+
+   end = result;
+   if(DT_preOrderTraversal(oDTree, DT_copyLine, &end) != SUCCESS) {
+      DT_unlockAll(oDTree);
+      free(result);
+      return NULL;
+   }
+   DT_unlockAll(oDTree);
+   *end = '\0';
+   assert((size_t)(end - result) + 1 == totalStrlen);
+
+   return result;
+}
+
+int DT_treeDump(DT_T oDTree,
+                int (*pfWrite)(const char *pcChunk, size_t ulLength,
+                               void *pvExtra),
+                void *pvExtra) {
+   struct dumpSink *psSink;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(pfWrite != NULL);
+
+   psSink = malloc(sizeof(struct dumpSink));
+   if(psSink == NULL)
+      return MEMORY_ERROR;
+   psSink->pfWrite = pfWrite;
+   psSink->pvExtra = pvExtra;
+   psSink->ulFilled = 0;
+
+   DT_readLockAll(oDTree);
+   iStatus = DT_preOrderTraversal(oDTree, DT_sinkLine, psSink);
+   if(iStatus == SUCCESS)
+      iStatus = DT_flushSink(psSink);
+   DT_unlockAll(oDTree);
+
+   free(psSink);
+   return iStatus;
+}
+
+int DT_treeDumpToFile(DT_T oDTree, FILE *psFile) {
+   assert(oDTree != NULL);
+   assert(psFile != NULL);
+
+   return DT_treeDump(oDTree, DT_writeChunk, psFile);
+}
+
+char *DT_toString(void) {
+   if(!bIsInitialized)
+      return NULL;
+   return DT_treeToString(&sDTree);
+}
+
+int DT_dump(int (*pfWrite)(const char *pcChunk, size_t ulLength,
+                           void *pvExtra),
+            void *pvExtra) {
+   assert(pfWrite != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeDump(&sDTree, pfWrite, pvExtra);
+}
+
+int DT_dumpToFile(FILE *psFile) {
+   assert(psFile != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeDump(&sDTree, DT_writeChunk, psFile);
+}
+
+
+/* --------------------------------------------------------------------
+
+  A snapshot is a binary image of a DT: a header, then a table of its
+  nodes in breadth-first order, so that the children of each node are
+  consecutive entries, then all of their names, one after another
+  without terminators. Entries refer to names and children by
+  position, so the file holds no pointers, and a DT can be saved in
+  one sequential pass and loaded straight from a mapping of the file.
+  Numbers are written in the byte order of the machine that wrote
+  them, which the header records. The header also records how much of
+  the DT's journal, if it has one, the snapshot holds.
+*/
+
+/* The version of the snapshot format that DT_treeSaveSnapshot writes
+   and DT_treeLoadSnapshot reads: version 2 added ulRecord */
+enum { DT_SNAPSHOT_VERSION = 2 };
+
+/* What a snapshot begins with */
+static const char acSnapshotMagic[8] = {'D', 'T', 'S', 'N', 'A', 'P',
+                                        '\r', '\n'};
+
+/* The byte-order mark, as the writer stored it */
+static const uint32_t uiSnapshotByteOrder = 0x01020304;
+
+/* The start of a snapshot */
+struct snapshotHeader {
+   /* acSnapshotMagic */
+   char acMagic[8];
+   /* DT_SNAPSHOT_VERSION */
+   uint32_t uiVersion;
+   /* uiSnapshotByteOrder */
+   uint32_t uiByteOrder;
+   /* the number of nodes in the table */
+   uint64_t ulNodes;
+   /* the total length of the names after the table */
+   uint64_t ulNameBytes;
+   /* the number of the last journal record whose change the snapshot
+      holds, or 0 */
+   uint64_t ulRecord;
+};
+
+/* One node of a snapshot's table */
+struct snapshotNode {
+   /* the offset of the node's name among the names */
+   uint64_t ulNameOffset;
+   /* the index in the table of the node's first child, if it has
+      any: the children are that entry and the ones after it */
+   uint64_t ulFirstChild;
+   /* the number of children */
+   uint64_t ulChildren;
+   /* the length of the name */
+   uint32_t uiNameLength;
+   /* zero, to keep entries a multiple of 8 bytes long */
+   uint32_t uiReserved;
+};
+
+/*
+  Sets *papoNodes to a new array of oDTree's ulCount nodes in
+  breadth-first order, visiting each node's children in order.
+  Returns SUCCESS, or MEMORY_ERROR if memory could not be allocated.
+  The caller must hold every lock of oDTree.
+*/
+static int DT_listBreadthFirst(DT_T oDTree, Node_T **papoNodes) {
+   Node_T *apoNodes;
+   Node_T oNChild = NULL;
+   size_t ulNext = 0;
+   size_t ulListed = 0;
+   size_t ulChildren;
+   size_t i;
+
+   assert(oDTree != NULL);
+   assert(papoNodes != NULL);
+
+   apoNodes = malloc((oDTree->ulCount + 1) * sizeof(Node_T));
+   if(apoNodes == NULL)
+      return MEMORY_ERROR;
+   if(oDTree->oNRoot != NULL)
+      apoNodes[ulListed++] = oDTree->oNRoot;
+
+   /* the array itself is the queue */
+   for(ulNext = 0; ulNext < ulListed; ulNext++) {
+      ulChildren = Node_getNumChildren(apoNodes[ulNext]);
+      assert(ulListed + ulChildren <= oDTree->ulCount);
+      for(i = 0; i < ulChildren; i++) {
+         (void) Node_getChild(apoNodes[ulNext], i, &oNChild);
+         apoNodes[ulListed++] = oNChild;
+      }
+   }
+   assert(ulListed == oDTree->ulCount);
+
+   *papoNodes = apoNodes;
+   return SUCCESS;
+}
+
+/*
+  Returns TRUE if the ulSize bytes at pcText are a snapshot that
+  DT_treeLoadSnapshot can load, checking every entry of its table, and
+  FALSE if not.
+*/
+static boolean DT_isValidSnapshot(const char *pcText, size_t ulSize) {
+   const struct snapshotHeader *psHeader;
+   const struct snapshotNode *psNodes;
+   uint64_t ulNextChild = 1;
+   uint64_t i;
+
+   assert(pcText != NULL || ulSize == 0);
+
+   if(ulSize < sizeof(struct snapshotHeader))
+      return FALSE;
+   psHeader = (const struct snapshotHeader *) pcText;
+   if(memcmp(psHeader->acMagic, acSnapshotMagic,
+             sizeof(acSnapshotMagic)) != 0 ||
+      psHeader->uiVersion != DT_SNAPSHOT_VERSION ||
+      psHeader->uiByteOrder != uiSnapshotByteOrder)
+      return FALSE;
+
+   /* the table and names must fill the rest of the file exactly */
+   ulSize -= sizeof(struct snapshotHeader);
+   if(psHeader->ulNodes > ulSize / sizeof(struct snapshotNode) ||
+      psHeader->ulNameBytes != ulSize -
+         psHeader->ulNodes * sizeof(struct snapshotNode))
+      return FALSE;
+
+   /* the children of each node must follow every node listed so far,
+      and come right after the children of the nodes before it, so
+      that every node but the root is some node's child exactly once */
+   psNodes = (const struct snapshotNode *) (psHeader + 1);
+   for(i = 0; i < psHeader->ulNodes; i++) {
+      if(i != 0 && i >= ulNextChild)
+         return FALSE;
+      if(psNodes[i].ulChildren != 0) {
+         if(psNodes[i].ulFirstChild != ulNextChild ||
+            psNodes[i].ulChildren > psHeader->ulNodes - ulNextChild)
+            return FALSE;
+         ulNextChild += psNodes[i].ulChildren;
+      }
+      if(psNodes[i].uiNameLength == 0 ||
+         psNodes[i].ulNameOffset > psHeader->ulNameBytes ||
+         psNodes[i].uiNameLength >
+            psHeader->ulNameBytes - psNodes[i].ulNameOffset)
+         return FALSE;
+   }
+   return (boolean) (psHeader->ulNodes == 0 ||
+                     ulNextChild == psHeader->ulNodes);
+}
+
+/*
+  Creates, below the empty oDTree's nonexistent root, the nodes of the
+  valid snapshot in the ulSize bytes at pcText, storing node i of its
+  table in apoNodes[i], and makes them reachable by every kind of
+  lookup (except through oDTree's root, which the caller sets).
+  Returns SUCCESS, IO_ERROR if the snapshot holds a name that is not
+  a valid path component, or the same name twice among siblings, or
+  MEMORY_ERROR; in either error case, frees every node it made. The
+  caller must hold oDTree's lock for writing.
+*/
+static int DT_buildSnapshot(DT_T oDTree, const char *pcText,
+                            Node_T *apoNodes) {
+   const struct snapshotHeader *psHeader;
+   const struct snapshotNode *psNodes;
+   const char *pcNames;
+   Path_T oPPath;
+   uint64_t i;
+   uint64_t j;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(oDTree->oNRoot == NULL);
+   assert(pcText != NULL);
+   assert(apoNodes != NULL);
+
+   psHeader = (const struct snapshotHeader *) pcText;
+   psNodes = (const struct snapshotNode *) (psHeader + 1);
+   pcNames = (const char *) (psNodes + psHeader->ulNodes);
+   assert(psHeader->ulNodes > 0);
+
+   /* the root needs a path; everything else is made from its name */
+   iStatus = Path_newSpan(oDTree->oAArena, pcNames +
+                          psNodes[0].ulNameOffset,
+                          psNodes[0].uiNameLength,
+                          oDTree->bInternsNames, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus == BAD_PATH ? IO_ERROR : iStatus;
+   if(Path_getDepth(oPPath) != 1) {
+      Path_free(oPPath);
+      return IO_ERROR;
+   }
+   iStatus = Node_newIn(oDTree->oAArena, oPPath, 1, NULL, &apoNodes[0]);
+   Path_free(oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(i = 0; iStatus == SUCCESS && i < psHeader->ulNodes; i++) {
+      if(psNodes[i].ulChildren == 0)
+         continue;
+      /* on failure, the children are still added one at a time */
+      (void) Node_reserveChildren(apoNodes[i],
+                                  (size_t) psNodes[i].ulChildren);
+      for(j = 0; iStatus == SUCCESS && j < psNodes[i].ulChildren;
+          j++) {
+         const struct snapshotNode *psChild =
+            &psNodes[psNodes[i].ulFirstChild + j];
+
+         iStatus = Node_newChild(apoNodes[i],
+                                 pcNames + psChild->ulNameOffset,
+                                 psChild->uiNameLength,
+                                 oDTree->bInternsNames,
+                                 &apoNodes[psNodes[i].ulFirstChild + j]);
+      }
+   }
+   if(iStatus == BAD_PATH || iStatus == ALREADY_IN_TREE)
+      iStatus = IO_ERROR;
+
+   /* the root is not reachable yet, so its nodes can be published in
+      any order */
+   for(i = 0; iStatus == SUCCESS && oDTree->bIsLockFree &&
+          i < psHeader->ulNodes; i++)
+      iStatus = Node_publish(apoNodes[i]);
+
+   if(iStatus == SUCCESS && oDTree->psIndex != NULL) {
+      DT_lockIndex(oDTree, TRUE);
+      iStatus = DT_reserveIndex(oDTree->psIndex,
+                                (size_t) psHeader->ulNodes);
+      if(iStatus == SUCCESS) {
+         for(i = 0; i < psHeader->ulNodes; i++)
+            DT_indexPut(oDTree->psIndex, apoNodes[i],
+                        DT_hashNode(apoNodes[i]));
+         oDTree->psIndex->ulLength += (size_t) psHeader->ulNodes;
+      }
+      DT_unlockIndex(oDTree);
+   }
+
+   if(iStatus != SUCCESS)
+      (void) Node_free(apoNodes[0]);
+   return iStatus;
+}
+
+/*
+  Writes a snapshot of oDTree to psFile, adding its size to *pulBytes.
+  Returns SUCCESS, or MEMORY_ERROR or IO_ERROR as DT_treeSaveSnapshot
+  does. The caller must hold every lock of oDTree.
+*/
+static int DT_writeSnapshot(DT_T oDTree, FILE *psFile,
+                            size_t *pulBytes) {
+   struct dumpSink *psSink;
+   struct snapshotHeader sHeader;
+   struct snapshotNode sNode;
+   Node_T *apoNodes = NULL;
+   const char *pcName;
+   uint64_t ulNextChild = 1;
+   uint64_t ulNameOffset = 0;
+   size_t ulChildren;
+   size_t i;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(psFile != NULL);
+   assert(pulBytes != NULL);
+
+   psSink = malloc(sizeof(struct dumpSink));
+   if(psSink == NULL)
+      return MEMORY_ERROR;
+   psSink->pfWrite = DT_writeChunk;
+   psSink->pvExtra = psFile;
+   psSink->ulFilled = 0;
+
+   iStatus = DT_listBreadthFirst(oDTree, &apoNodes);
+
+   /* the name lengths are only known node by node, so the header's
+      total comes from a pass over the names first */
+   memset(&sHeader, 0, sizeof(sHeader));
+   memcpy(sHeader.acMagic, acSnapshotMagic, sizeof(acSnapshotMagic));
+   sHeader.uiVersion = DT_SNAPSHOT_VERSION;
+   sHeader.uiByteOrder = uiSnapshotByteOrder;
+   sHeader.ulNodes = oDTree->ulCount;
+   for(i = 0; iStatus == SUCCESS && i < oDTree->ulCount; i++)
+      sHeader.ulNameBytes += strlen(Node_getName(apoNodes[i]));
+   /* writers append their records while holding the locks the caller
+      holds, so every record so far is of a change the tree has */
+   if(oDTree->psJournal != NULL)
+      sHeader.ulRecord =
+         Journal_getLastRecord(oDTree->psJournal->oJournal);
+   if(iStatus == SUCCESS)
+      iStatus = DT_sinkLine((const char *) &sHeader, sizeof(sHeader),
+                            psSink);
+
+   memset(&sNode, 0, sizeof(sNode));
+   for(i = 0; iStatus == SUCCESS && i < oDTree->ulCount; i++) {
+      ulChildren = Node_getNumChildren(apoNodes[i]);
+      sNode.ulNameOffset = ulNameOffset;
+      sNode.uiNameLength = (uint32_t) strlen(Node_getName(apoNodes[i]));
+      sNode.ulFirstChild = ulChildren != 0 ? ulNextChild : 0;
+      sNode.ulChildren = ulChildren;
+      ulNameOffset += sNode.uiNameLength;
+      ulNextChild += ulChildren;
+      iStatus = DT_sinkLine((const char *) &sNode, sizeof(sNode),
+                            psSink);
+   }
+
+   for(i = 0; iStatus == SUCCESS && i < oDTree->ulCount; i++) {
+      pcName = Node_getName(apoNodes[i]);
+      iStatus = DT_sinkLine(pcName, strlen(pcName), psSink);
+   }
+
+   if(iStatus == SUCCESS)
+      iStatus = DT_flushSink(psSink);
+   if(iStatus == SUCCESS)
+      *pulBytes += sizeof(sHeader) +
+         oDTree->ulCount * sizeof(sNode) + (size_t) ulNameOffset;
+   free(apoNodes);
+   free(psSink);
+   return iStatus;
+}
+
+/*
+  Restores into the empty oDTree the snapshot in the file named
+  pcFilename, as DT_treeLoadSnapshot documents, and sets *pulRecord to
+  the number of the last journal record it holds and *pulBytes to its
+  size. Returns the status DT_treeLoadSnapshot documents.
+*/
+static int DT_readSnapshot(DT_T oDTree, const char *pcFilename,
+                           size_t *pulRecord, size_t *pulBytes) {
+   const char *pcText;
+   size_t ulSize;
+   size_t ulNodes;
+   Node_T *apoNodes;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(pcFilename != NULL);
+   assert(pulRecord != NULL);
+   assert(pulBytes != NULL);
+
+   iStatus = DT_mapFile(pcFilename, &pcText, &ulSize);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(!DT_isValidSnapshot(pcText, ulSize)) {
+      if(pcText != NULL)
+         (void) munmap((void *) pcText, ulSize);
+      return IO_ERROR;
+   }
+   ulNodes = (size_t) ((const struct snapshotHeader *) pcText)->ulNodes;
+   *pulRecord =
+      (size_t) ((const struct snapshotHeader *) pcText)->ulRecord;
+   *pulBytes = ulSize;
+
+   apoNodes = malloc((ulNodes + 1) * sizeof(Node_T));
+   if(apoNodes == NULL) {
+      (void) munmap((void *) pcText, ulSize);
+      return MEMORY_ERROR;
+   }
+
+   DT_writeLock(oDTree);
+   assert(DT_isValidAt(oDTree, NULL, TRUE));
+
+   if(oDTree->oNRoot != NULL)
+      iStatus = CONFLICTING_PATH;
+   else if(ulNodes != 0)
+      iStatus = DT_buildSnapshot(oDTree, pcText, apoNodes);
+   if(iStatus == SUCCESS && ulNodes != 0) {
+      __atomic_store_n(&oDTree->oNRoot, apoNodes[0], __ATOMIC_RELEASE);
+      (void) __atomic_add_fetch(&oDTree->ulCount, ulNodes,
+                                __ATOMIC_RELAXED);
+      /* the old filter has none of the new paths, so if there is no
+         room for a new one, the load is undone */
+      if(oDTree->psFilter != NULL &&
+         DT_rebuildFilter(oDTree) != SUCCESS) {
+         oDTree->ulCount -= DT_freeSubtree(oDTree, apoNodes[0]);
+         oDTree->oNRoot = NULL;
+         iStatus = MEMORY_ERROR;
+      }
+   }
+
+   assert(DT_isValidAt(oDTree, NULL, TRUE));
+   DT_unlock(oDTree);
+
+   free(apoNodes);
+   (void) munmap((void *) pcText, ulSize);
+   return iStatus;
+}
+
+int DT_treeSaveSnapshot(DT_T oDTree, FILE *psFile) {
+   size_t ulBytes = 0;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(psFile != NULL);
+
+   DT_readLockAll(oDTree);
+   iStatus = DT_writeSnapshot(oDTree, psFile, &ulBytes);
+   DT_unlockAll(oDTree);
+   return iStatus;
+}
+
+int DT_treeLoadSnapshot(DT_T oDTree, const char *pcFilename) {
+   size_t ulRecord;
+   size_t ulBytes;
+   int iStatus;
+
+   assert(oDTree != NULL);
+   assert(pcFilename != NULL);
+
+   iStatus = DT_readSnapshot(oDTree, pcFilename, &ulRecord, &ulBytes);
+   /* the journal has no record of the load, so a checkpoint takes its
+      place */
+   if(iStatus == SUCCESS && oDTree->psJournal != NULL)
+      iStatus = DT_treeCheckpoint(oDTree);
+   return iStatus;
+}
+
+int DT_saveSnapshot(FILE *psFile) {
+   assert(psFile != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeSaveSnapshot(&sDTree, psFile);
+}
+
+int DT_loadSnapshot(const char *pcFilename) {
+   assert(pcFilename != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeLoadSnapshot(&sDTree, pcFilename);
+}
+
+/* --------------------------------------------------------------------
+
+  A journaled DT keeps its state in two files: a snapshot of it as of
+  its last checkpoint, and a journal of the changes since. Opening the
+  journal restores that state, and a checkpoint saves the whole DT as a
+  new snapshot and restarts the journal with only the changes made
+  since. Each snapshot records the number of the last journal record
+  it holds, so that if a crash comes between writing the snapshot and
+  restarting the journal, the records the snapshot already holds are
+  skipped rather than replayed twice.
+*/
+
+/*
+  Replays on the DT pvDTree the journal record of operation iOp with
+  the ulLength bytes at pcData. Returns SUCCESS, IO_ERROR if the record
+  is not one that a DT writes, or MEMORY_ERROR.
+*/
+static int DT_replayChange(int iOp, const char *pcData, size_t ulLength,
+                           void *pvDTree) {
+   int iStatus;
+
+   assert(pcData != NULL);
+   assert(pvDTree != NULL);
+
+   if(ulLength == 0 || pcData[ulLength-1] != '\0')
+      return IO_ERROR;
+   if(iOp == DT_JOURNAL_INSERT)
+      iStatus = DT_treeInsert(pvDTree, pcData);
+   else if(iOp == DT_JOURNAL_RM)
+      iStatus = DT_treeRm(pvDTree, pcData);
+   else
+      return IO_ERROR;
+
+   /* each change succeeded when it was made, and changes to the same
+      part of the tree were journaled in order, so only running out of
+      memory keeps one from succeeding again */
+   if(iStatus == MEMORY_ERROR)
+      return iStatus;
+   return SUCCESS;
+}
+
+/*
+  Runs the compactor of the journaled DT pvDTree: every
+  DT_COMPACT_PERIOD_MS milliseconds until it is stopped, writes out
+  the records that no writer waits for, and checkpoints the DT if the
+  journal has outgrown both DT_COMPACT_MIN_BYTES and the last
+  snapshot. Failures are left for the writers to find in the journal.
+*/
+static void *DT_compact(void *pvDTree) {
+   DT_T oDTree = pvDTree;
+   struct treeJournal *psJournal;
+   struct timespec sWake;
+   size_t ulLimit;
+
+   assert(oDTree != NULL);
+   assert(oDTree->psJournal != NULL);
+
+   psJournal = oDTree->psJournal;
+   (void) pthread_mutex_lock(&psJournal->sMutex);
+   while(!psJournal->bIsStopping) {
+      (void) clock_gettime(CLOCK_REALTIME, &sWake);
+      sWake.tv_nsec += DT_COMPACT_PERIOD_MS * 1000000L;
+      if(sWake.tv_nsec >= 1000000000L) {
+         sWake.tv_sec++;
+         sWake.tv_nsec -= 1000000000L;
+      }
+      (void) pthread_cond_timedwait(&psJournal->sStop, &psJournal->sMutex,
+                                    &sWake);
+      if(psJournal->bIsStopping)
+         break;
+      ulLimit = psJournal->ulSnapshotBytes > DT_COMPACT_MIN_BYTES ?
+         psJournal->ulSnapshotBytes : DT_COMPACT_MIN_BYTES;
+      (void) pthread_mutex_unlock(&psJournal->sMutex);
+
+      (void) Journal_sync(psJournal->oJournal);
+      if(Journal_getBytes(psJournal->oJournal) > ulLimit)
+         (void) DT_treeCheckpoint(oDTree);
+
+      (void) pthread_mutex_lock(&psJournal->sMutex);
+   }
+   (void) pthread_mutex_unlock(&psJournal->sMutex);
+   return NULL;
+}
+
+/*
+  Removes every node of oDTree, undoing a restore that could not be
+  completed. The caller must not hold oDTree's lock.
+*/
+static void DT_clear(DT_T oDTree) {
+   size_t ulRemoved;
+
+   assert(oDTree != NULL);
+
+   DT_writeLock(oDTree);
+   if(oDTree->oNRoot != NULL) {
+      ulRemoved = DT_freeSubtree(oDTree, oDTree->oNRoot);
+      __atomic_store_n(&oDTree->oNRoot, NULL, __ATOMIC_RELEASE);
+      oDTree->ulCount -= ulRemoved;
+      if(oDTree->psFilter != NULL)
+         (void) __atomic_add_fetch(&oDTree->psFilter->ulRemoved,
+                                   ulRemoved, __ATOMIC_RELAXED);
+   }
+   DT_unlock(oDTree);
+   DT_refreshFilter(oDTree);
+}
+
+int DT_treeOpenJournal(DT_T oDTree, const char *pcSnapshot,
+                       const char *pcJournal, boolean bWaitsForDisk) {
+   struct treeJournal *psJournal;
+   size_t ulRecord = 0;
+   size_t ulBytes = 0;
+   int iStatus = SUCCESS;
+
+   assert(oDTree != NULL);
+   assert(pcSnapshot != NULL);
+   assert(pcJournal != NULL);
+
+   if(oDTree->psJournal != NULL || oDTree->oNRoot != NULL)
+      return CONFLICTING_PATH;
+
+   psJournal = calloc(1, sizeof(struct treeJournal));
+   if(psJournal == NULL)
+      return MEMORY_ERROR;
+   psJournal->pcSnapshot = malloc(strlen(pcSnapshot) + 1);
+   if(psJournal->pcSnapshot == NULL) {
+      free(psJournal);
+      return MEMORY_ERROR;
+   }
+   strcpy(psJournal->pcSnapshot, pcSnapshot);
+   psJournal->bWaitsForDisk = bWaitsForDisk;
+
+   /* restore the last checkpoint, if there was one, and then the
+      changes since, which are not journaled again */
+   if(access(pcSnapshot, F_OK) == 0)
+      iStatus = DT_readSnapshot(oDTree, pcSnapshot, &ulRecord, &ulBytes);
+   if(iStatus == SUCCESS)
+      iStatus = Journal_open(pcJournal, ulRecord, DT_replayChange,
+                             oDTree, &psJournal->oJournal);
+   if(iStatus != SUCCESS) {
+      DT_clear(oDTree);
+      free(psJournal->pcSnapshot);
+      free(psJournal);
+      return iStatus;
+   }
+   psJournal->ulSnapshotBytes = ulBytes;
+
+   if(pthread_mutex_init(&psJournal->sMutex, NULL) != 0)
+      iStatus = MEMORY_ERROR;
+   else if(pthread_cond_init(&psJournal->sStop, NULL) != 0) {
+      (void) pthread_mutex_destroy(&psJournal->sMutex);
+      iStatus = MEMORY_ERROR;
+   }
+   else {
+      oDTree->psJournal = psJournal;
+      if(pthread_create(&psJournal->sCompactor, NULL, DT_compact,
+                        oDTree) != 0) {
+         oDTree->psJournal = NULL;
+         (void) pthread_cond_destroy(&psJournal->sStop);
+         (void) pthread_mutex_destroy(&psJournal->sMutex);
+         iStatus = MEMORY_ERROR;
+      }
+   }
+   if(iStatus != SUCCESS) {
+      (void) Journal_close(psJournal->oJournal);
+      DT_clear(oDTree);
+      free(psJournal->pcSnapshot);
+      free(psJournal);
+   }
+   return iStatus;
+}
+
+int DT_treeSyncJournal(DT_T oDTree) {
+   assert(oDTree != NULL);
+
+   if(oDTree->psJournal == NULL)
+      return SUCCESS;
+   return Journal_sync(oDTree->psJournal->oJournal);
+}
+
+int DT_treeCheckpoint(DT_T oDTree) {
+   struct treeJournal *psJournal;
+   char *pcTemporary;
+   FILE *psFile;
+   size_t ulBytes = 0;
+   size_t ulAfter;
+   size_t ulOffset;
+   boolean bWasFailed;
+   int iStatus;
+
+   assert(oDTree != NULL);
+
+   psJournal = oDTree->psJournal;
+   if(psJournal == NULL)
+      return IO_ERROR;
+
+   pcTemporary = malloc(strlen(psJournal->pcSnapshot) + sizeof(".new"));
+   if(pcTemporary == NULL)
+      return MEMORY_ERROR;
+   strcpy(pcTemporary, psJournal->pcSnapshot);
+   strcat(pcTemporary, ".new");
+
+   (void) pthread_mutex_lock(&psJournal->sMutex);
+   psFile = fopen(pcTemporary, "wb");
+   if(psFile == NULL)
+      iStatus = IO_ERROR;
+   else {
+      /* writers wait while the snapshot is taken, and then append
+         after ulOffset the records the restart carries over; lookups
+         go on. A failed journal can only be restarted with nothing
+         to carry over, so then writers wait until it is. */
+      DT_readLockAll(oDTree);
+      ulAfter = Journal_getLastRecord(psJournal->oJournal);
+      ulOffset = Journal_getBytes(psJournal->oJournal);
+      bWasFailed = Journal_getStatus(psJournal->oJournal) != SUCCESS;
+      iStatus = DT_writeSnapshot(oDTree, psFile, &ulBytes);
+      if(!bWasFailed)
+         DT_unlockAll(oDTree);
+
+      if(iStatus == SUCCESS &&
+         (fflush(psFile) != 0 || fsync(fileno(psFile)) != 0))
+         iStatus = IO_ERROR;
+      if(fclose(psFile) != 0 && iStatus == SUCCESS)
+         iStatus = IO_ERROR;
+      if(iStatus == SUCCESS)
+         iStatus = Journal_rename(pcTemporary, psJournal->pcSnapshot);
+      if(iStatus == SUCCESS)
+         iStatus = Journal_restart(psJournal->oJournal, ulAfter,
+                                   ulOffset);
+      if(bWasFailed)
+         DT_unlockAll(oDTree);
+
+      if(iStatus == SUCCESS)
+         psJournal->ulSnapshotBytes = ulBytes;
+      else
+         (void) remove(pcTemporary);
+   }
+   (void) pthread_mutex_unlock(&psJournal->sMutex);
+
+   free(pcTemporary);
+   return iStatus;
+}
+
+int DT_openJournal(const char *pcSnapshot, const char *pcJournal,
+                   boolean bWaitsForDisk) {
+   assert(pcSnapshot != NULL);
+   assert(pcJournal != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeOpenJournal(&sDTree, pcSnapshot, pcJournal,
+                             bWaitsForDisk);
+}
+
+int DT_syncJournal(void) {
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeSyncJournal(&sDTree);
+}
+
+int DT_checkpoint(void) {
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return DT_treeCheckpoint(&sDTree);
 }
@@ -0,0 +1,129 @@
+/*--------------------------------------------------------------------*/
+/* dt_bench.c                                                         */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "dt.h"
+#include "dtExt.h"
+#include "bench.h"
+
+/* Only dtGood may be called from several threads at once, so the
+   Makefile defines DT_BENCH_THREAD_SAFE only when linking with it */
+#ifdef DT_BENCH_THREAD_SAFE
+#define DTBENCH_IS_THREAD_SAFE TRUE
+#else
+#define DTBENCH_IS_THREAD_SAFE FALSE
+#endif
+
+#ifdef DT_BENCH_OPTIONS
+
+/*
+  Linked with dtGood, dt_bench can instead time a DT made by
+  DT_newWith(DT_BENCH_OPTIONS), which the Makefile defines from
+  DTOPTIONS, e.g. make DTOPTIONS="DT_PATH_INDEX|DT_MISS_FILTER", and
+  report its index's size and its filter's counts.
+*/
+
+/* The DT being timed, or NULL between workloads */
+static DT_T oDTBench = NULL;
+
+/* The index size and filter counts oDTBench had when it was freed */
+static size_t ulIndexBytes;
+static size_t ulFilterChecks;
+static size_t ulFilterMisses;
+static size_t ulFilterFalsePositives;
+
+/* Makes the DT to time. */
+static int DTBench_init(void) {
+   oDTBench = DT_newWith(DT_BENCH_OPTIONS);
+   return oDTBench == NULL ? MEMORY_ERROR : SUCCESS;
+}
+
+/* Records the DT's counters for DTBench_report, and frees it. */
+static int DTBench_destroy(void) {
+   ulIndexBytes = DT_getIndexBytes(oDTBench);
+   DT_getFilterCounts(oDTBench, &ulFilterChecks, &ulFilterMisses,
+                      &ulFilterFalsePositives);
+   DT_free(oDTBench);
+   oDTBench = NULL;
+   return SUCCESS;
+}
+
+/* Inserts directory pcPath; a DT has no files. */
+static int DTBench_insert(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return DT_treeInsert(oDTBench, pcPath);
+}
+
+/* Returns whether directory pcPath is in the DT. */
+static boolean DTBench_contains(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return DT_treeContains(oDTBench, pcPath);
+}
+
+/* Removes directory pcPath and everything below it. */
+static int DTBench_rm(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return DT_treeRm(oDTBench, pcPath);
+}
+
+/* Returns the DT's string representation. */
+static char *DTBench_toString(void) {
+   return DT_treeToString(oDTBench);
+}
+
+/*
+  Prints the index size (which never shrinks, so it is the largest
+  the index got) and the filter counts of the DT of workload
+  pcWorkload.
+*/
+static void DTBench_report(const char *pcWorkload) {
+   printf("%-8s index bytes: %lu\n", pcWorkload,
+          (unsigned long) ulIndexBytes);
+   printf("%-8s filter checks: %lu, misses: %lu, "
+          "false positives: %lu\n", pcWorkload,
+          (unsigned long) ulFilterChecks,
+          (unsigned long) ulFilterMisses,
+          (unsigned long) ulFilterFalsePositives);
+}
+
+#else
+
+/* The singleton DT has nothing of its own to report */
+#define DTBench_init DT_init
+#define DTBench_destroy DT_destroy
+#define DTBench_toString DT_toString
+#define DTBench_report NULL
+
+/* Inserts directory pcPath; a DT has no files. */
+static int DTBench_insert(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return DT_insert(pcPath);
+}
+
+/* Returns whether directory pcPath is in the DT. */
+static boolean DTBench_contains(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return DT_contains(pcPath);
+}
+
+/* Removes directory pcPath and everything below it. */
+static int DTBench_rm(const char *pcPath, boolean bIsFile) {
+   (void) bIsFile;
+   return DT_rm(pcPath);
+}
+
+#endif
+
+/* Benchmarks the DT implementation it is linked with; see bench.h
+   for the command-line arguments and report. */
+int main(int argc, char *argv[]) {
+   static const struct BenchOps sOps = {
+      "DT", DTBench_init, DTBench_destroy, DTBench_insert,
+      DTBench_contains, DTBench_rm, NULL, DTBench_toString,
+      DTBENCH_IS_THREAD_SAFE, DTBench_report
+   };
+
+   return Bench_main(argc, argv, &sOps);
+}
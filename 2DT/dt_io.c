@@ -0,0 +1,916 @@
+/*--------------------------------------------------------------------*/
+/* dt_io.c                                                            */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "dt.h"
+#include "dtExt.h"
+
+/* The number of directories in the tree whose dump takes many
+   chunks; its string representation is tens of kilobytes long */
+enum { IO_BIG_NODES = 3000 };
+
+/* The longest path a test builds */
+enum { IO_MAX_PATH = 64 };
+
+/* Where a snapshot's table of nodes begins, and where in an entry of
+   it the index of the node's first child is, as dtGood.c lays
+   snapshots out */
+enum { IO_SNAPSHOT_TABLE = 40, IO_SNAPSHOT_FIRST_CHILD = 8 };
+
+/* The number of directories a writer inserts while the journal tests
+   checkpoint its DT over and over */
+enum { IO_CHECKPOINT_NODES = 4000 };
+
+/*
+  The pieces of a dump that Io_collect has received, concatenated,
+  and when it should stop the dump.
+*/
+struct collected {
+   /* the bytes received so far, or NULL if there are none */
+   char *pcBytes;
+   /* the number of bytes received so far */
+   size_t ulLength;
+   /* the number of calls to Io_collect so far */
+   size_t ulCalls;
+   /* the call on which Io_collect returns NOT_A_FILE instead of
+      SUCCESS, or 0 for none */
+   size_t ulStopAt;
+};
+
+/* A journaled DT that Io_insertMany inserts into, and its results */
+struct writer {
+   DT_T oDTree;
+   /* the number of insertions that failed */
+   size_t ulFailures;
+   /* set once every insertion has returned */
+   int iDone;
+};
+
+/* The file that tests write the files they read back to, in the
+   current directory; each test removes it when done */
+#define IO_TEMP_FILE "dt_io.tmp"
+
+/* The snapshot that the journal tests checkpoint to; they remove it
+   when done */
+#define IO_SNAPSHOT_FILE "dt_io.snap.tmp"
+
+/*
+  Returns the number of elements of array a, which must be an array
+  and not a pointer.
+*/
+#define IO_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/*--------------------------------------------------------------------*/
+
+/* Reports that pcTest failed because pcWhy, and returns 1. */
+static size_t Io_fail(const char *pcTest, const char *pcWhy) {
+   fprintf(stderr, "%s: %s\n", pcTest, pcWhy);
+   return 1;
+}
+
+/*
+  Returns a new DT holding ulNodes directories below "r", two levels
+  deep, or NULL if one could not be built.
+*/
+static DT_T Io_build(size_t ulNodes) {
+   DT_T oDTree;
+   char acPath[IO_MAX_PATH];
+   size_t i;
+
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return NULL;
+   for(i = 0; i < ulNodes; i++) {
+      sprintf(acPath, "r/d%lu/e%lu", (unsigned long) (i % 37),
+              (unsigned long) i);
+      if(DT_treeInsert(oDTree, acPath) != SUCCESS) {
+         DT_free(oDTree);
+         return NULL;
+      }
+   }
+   return oDTree;
+}
+
+/*
+  Appends the ulLength bytes at pcChunk to the struct collected that
+  pvCollected points to. Returns SUCCESS, NOT_A_FILE on the call the
+  struct says to stop at, or MEMORY_ERROR if memory could not be
+  allocated.
+*/
+static int Io_collect(const char *pcChunk, size_t ulLength,
+                      void *pvCollected) {
+   struct collected *psCollected = pvCollected;
+   char *pcBytes;
+
+   psCollected->ulCalls++;
+   if(psCollected->ulCalls == psCollected->ulStopAt)
+      return NOT_A_FILE;
+
+   pcBytes = realloc(psCollected->pcBytes,
+                     psCollected->ulLength + ulLength + 1);
+   if(pcBytes == NULL)
+      return MEMORY_ERROR;
+   memcpy(pcBytes + psCollected->ulLength, pcChunk, ulLength);
+   psCollected->ulLength += ulLength;
+   pcBytes[psCollected->ulLength] = '\0';
+   psCollected->pcBytes = pcBytes;
+   return SUCCESS;
+}
+
+/*
+  Returns TRUE if the ulLength bytes at pcBytes are exactly the string
+  pcString, and FALSE otherwise.
+*/
+static boolean Io_matches(const char *pcBytes, size_t ulLength,
+                          const char *pcString) {
+   return (boolean) (ulLength == strlen(pcString) &&
+                     (ulLength == 0 ||
+                      memcmp(pcBytes, pcString, ulLength) == 0));
+}
+
+/*
+  Checks that dumping oDTree passes pieces that concatenate to
+  exactly DT_treeToString(oDTree), in at least ulMinCalls calls, that
+  a pfWrite failure on the second call stops the dump there, and that
+  DT_treeDumpToFile writes the same bytes. Returns the number of
+  failed checks.
+*/
+static size_t Io_checkDump(DT_T oDTree, size_t ulMinCalls,
+                           const char *pcTest) {
+   struct collected sCollected = {NULL, 0, 0, 0};
+   char *pcString;
+   FILE *psFile;
+   char *pcRead;
+   size_t ulRead;
+   size_t ulFailures = 0;
+
+   pcString = DT_treeToString(oDTree);
+   if(pcString == NULL)
+      return Io_fail(pcTest, "DT_treeToString returned NULL");
+
+   if(DT_treeDump(oDTree, Io_collect, &sCollected) != SUCCESS)
+      ulFailures += Io_fail(pcTest, "DT_treeDump failed");
+   else if(!Io_matches(sCollected.pcBytes, sCollected.ulLength,
+                       pcString))
+      ulFailures += Io_fail(pcTest, "dump differs from DT_toString");
+   else if(sCollected.ulCalls < ulMinCalls)
+      ulFailures += Io_fail(pcTest, "dump came in too few pieces");
+   free(sCollected.pcBytes);
+
+   /* only a dump that takes more than one call can be stopped
+      part-way */
+   if(ulMinCalls > 1) {
+      sCollected.pcBytes = NULL;
+      sCollected.ulLength = 0;
+      sCollected.ulCalls = 0;
+      sCollected.ulStopAt = 2;
+      if(DT_treeDump(oDTree, Io_collect, &sCollected) != NOT_A_FILE)
+         ulFailures += Io_fail(pcTest,
+                               "DT_treeDump hid pfWrite's status");
+      else if(sCollected.ulCalls != 2)
+         ulFailures += Io_fail(pcTest, "DT_treeDump went on after "
+                               "pfWrite failed");
+      free(sCollected.pcBytes);
+   }
+
+   /* the file gets the same bytes as the callback */
+   psFile = tmpfile();
+   pcRead = malloc(strlen(pcString) + 1);
+   if(psFile == NULL || pcRead == NULL)
+      ulFailures += Io_fail(pcTest, "Cannot make a temporary file");
+   else if(DT_treeDumpToFile(oDTree, psFile) != SUCCESS)
+      ulFailures += Io_fail(pcTest, "DT_treeDumpToFile failed");
+   else {
+      rewind(psFile);
+      ulRead = fread(pcRead, 1, strlen(pcString) + 1, psFile);
+      if(!Io_matches(pcRead, ulRead, pcString))
+         ulFailures += Io_fail(pcTest, "file differs from DT_toString");
+   }
+   if(psFile != NULL)
+      (void) fclose(psFile);
+   free(pcRead);
+
+   free(pcString);
+   return ulFailures;
+}
+
+/*
+  Tests DT_treeDump and DT_treeDumpToFile on an empty DT, a small one,
+  and one whose string representation is many chunks long, and
+  DT_dump and DT_dumpToFile on the singleton DT. Returns the number of
+  failed checks.
+*/
+static size_t Io_testDump(void) {
+   DT_T oDTree;
+   struct collected sCollected = {NULL, 0, 0, 0};
+   char *pcString;
+   size_t ulFailures = 0;
+
+   oDTree = Io_build(0);
+   if(oDTree == NULL)
+      return Io_fail("dump", "Cannot build a DT");
+   ulFailures += Io_checkDump(oDTree, 0, "dump, empty");
+   DT_free(oDTree);
+
+   oDTree = Io_build(10);
+   if(oDTree == NULL)
+      return ulFailures + Io_fail("dump", "Cannot build a DT");
+   ulFailures += Io_checkDump(oDTree, 1, "dump, small");
+   DT_free(oDTree);
+
+   /* dumps come in chunks of 4096 bytes, so this takes several */
+   oDTree = Io_build(IO_BIG_NODES);
+   if(oDTree == NULL)
+      return ulFailures + Io_fail("dump", "Cannot build a DT");
+   ulFailures += Io_checkDump(oDTree, 4, "dump, big");
+   DT_free(oDTree);
+
+   /* the singleton interface dumps only while initialized */
+   if(DT_dump(Io_collect, &sCollected) != INITIALIZATION_ERROR)
+      ulFailures += Io_fail("dump, singleton",
+                            "DT_dump worked before DT_init");
+   if(DT_dumpToFile(stdout) != INITIALIZATION_ERROR)
+      ulFailures += Io_fail("dump, singleton",
+                            "DT_dumpToFile worked before DT_init");
+   if(DT_init() != SUCCESS || DT_insert("r/a/b") != SUCCESS ||
+      DT_insert("r/c") != SUCCESS)
+      return ulFailures + Io_fail("dump, singleton",
+                                  "Cannot build the DT");
+   pcString = DT_toString();
+   if(pcString == NULL || DT_dump(Io_collect, &sCollected) != SUCCESS ||
+      !Io_matches(sCollected.pcBytes, sCollected.ulLength, pcString))
+      ulFailures += Io_fail("dump, singleton",
+                            "dump differs from DT_toString");
+   free(pcString);
+   free(sCollected.pcBytes);
+   (void) DT_destroy();
+
+   printf("%-24s %s\n", "dump", ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*
+  Checks that oDTree holds exactly the directories that inserting the
+  ulCount paths ppcExpected one at a time into a new DT gives.
+  Returns the number of failed checks.
+*/
+static size_t Io_checkHolds(DT_T oDTree, const char **ppcExpected,
+                            size_t ulCount, const char *pcTest) {
+   DT_T oDTExpected;
+   char *pcString;
+   char *pcExpected;
+   size_t ulFailures = 0;
+   size_t i;
+
+   oDTExpected = DT_new();
+   if(oDTExpected == NULL)
+      return Io_fail(pcTest, "Out of memory");
+   for(i = 0; i < ulCount; i++)
+      (void) DT_treeInsert(oDTExpected, ppcExpected[i]);
+
+   pcString = DT_treeToString(oDTree);
+   pcExpected = DT_treeToString(oDTExpected);
+   if(pcString == NULL || pcExpected == NULL)
+      ulFailures += Io_fail(pcTest, "DT_treeToString returned NULL");
+   else if(strcmp(pcString, pcExpected) != 0)
+      ulFailures += Io_fail(pcTest, "DT holds the wrong directories");
+   free(pcString);
+   free(pcExpected);
+   DT_free(oDTExpected);
+   return ulFailures;
+}
+
+/*
+  Tests DT_treeInsertBatch on unsorted paths, on paths repeated in the
+  batch or already in the DT, on a batch with a bad path in the
+  middle, and on one that conflicts with the DT's root, and
+  DT_insertBatch on the singleton DT. Returns the number of failed
+  checks.
+*/
+static size_t Io_testBatch(void) {
+   const char *apcUnsorted[] = {"r/b/c", "r/a", "r/b", "r/a/x/y"};
+   const char *apcCopy[IO_COUNT(apcUnsorted)];
+   const char *apcRepeated[] = {"r/a/b", "r/a", "r/c", "r/a/b", "r/a"};
+   const char *apcRepeatedHeld[] = {"r/a/b", "r/c"};
+   const char *apcBad[] = {"r/c", "r//b", "r/a"};
+   const char *apcBadHeld[] = {"r/a", "r/c"};
+   const char *apcConflicting[] = {"s/a", "r/b", "s"};
+   const char *apcConflictingHeld[] = {"r/x", "r/b"};
+   DT_T oDTree;
+   size_t ulFailures = 0;
+
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return Io_fail("batch", "Out of memory");
+   memcpy(apcCopy, apcUnsorted, sizeof(apcUnsorted));
+   if(DT_treeInsertBatch(oDTree, apcUnsorted, IO_COUNT(apcUnsorted))
+      != SUCCESS)
+      ulFailures += Io_fail("batch, unsorted", "insertion failed");
+   ulFailures += Io_checkHolds(oDTree, apcUnsorted,
+                               IO_COUNT(apcUnsorted),
+                               "batch, unsorted");
+   if(memcmp(apcCopy, apcUnsorted, sizeof(apcUnsorted)) != 0)
+      ulFailures += Io_fail("batch, unsorted",
+                            "the caller's array was reordered");
+   DT_free(oDTree);
+
+   /* repeats are skipped, whether from the batch or from before */
+   oDTree = DT_new();
+   if(oDTree == NULL || DT_treeInsert(oDTree, "r/c") != SUCCESS)
+      return ulFailures + Io_fail("batch", "Cannot build a DT");
+   if(DT_treeInsertBatch(oDTree, apcRepeated, IO_COUNT(apcRepeated))
+      != SUCCESS)
+      ulFailures += Io_fail("batch, repeated", "insertion failed");
+   ulFailures += Io_checkHolds(oDTree, apcRepeatedHeld,
+                               IO_COUNT(apcRepeatedHeld),
+                               "batch, repeated");
+   DT_free(oDTree);
+
+   /* a rejected path leaves the rest of the batch to be inserted */
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return ulFailures + Io_fail("batch", "Out of memory");
+   if(DT_treeInsertBatch(oDTree, apcBad, IO_COUNT(apcBad)) != BAD_PATH)
+      ulFailures += Io_fail("batch, bad path",
+                            "BAD_PATH was not reported");
+   ulFailures += Io_checkHolds(oDTree, apcBadHeld, IO_COUNT(apcBadHeld),
+                               "batch, bad path");
+   DT_free(oDTree);
+
+   oDTree = DT_new();
+   if(oDTree == NULL || DT_treeInsert(oDTree, "r/x") != SUCCESS)
+      return ulFailures + Io_fail("batch", "Cannot build a DT");
+   if(DT_treeInsertBatch(oDTree, apcConflicting,
+                         IO_COUNT(apcConflicting)) != CONFLICTING_PATH)
+      ulFailures += Io_fail("batch, conflicting",
+                            "CONFLICTING_PATH was not reported");
+   ulFailures += Io_checkHolds(oDTree, apcConflictingHeld,
+                               IO_COUNT(apcConflictingHeld),
+                               "batch, conflicting");
+   DT_free(oDTree);
+
+   /* the singleton interface inserts only while initialized */
+   if(DT_insertBatch(apcUnsorted, IO_COUNT(apcUnsorted))
+      != INITIALIZATION_ERROR)
+      ulFailures += Io_fail("batch, singleton",
+                            "DT_insertBatch worked before DT_init");
+   if(DT_init() != SUCCESS ||
+      DT_insertBatch(apcUnsorted, IO_COUNT(apcUnsorted)) != SUCCESS ||
+      !DT_contains("r/a/x/y") || !DT_contains("r/b/c"))
+      ulFailures += Io_fail("batch, singleton", "insertion failed");
+   (void) DT_destroy();
+
+   printf("%-24s %s\n", "batch", ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*
+  Writes the ulLength bytes at pcBytes to IO_TEMP_FILE. Returns TRUE
+  if they were written, or FALSE otherwise.
+*/
+static boolean Io_writeBytes(const char *pcBytes, size_t ulLength) {
+   FILE *psFile;
+   boolean bWritten;
+
+   psFile = fopen(IO_TEMP_FILE, "wb");
+   if(psFile == NULL)
+      return FALSE;
+   bWritten = (boolean) (fwrite(pcBytes, 1, ulLength, psFile)
+                         == ulLength);
+   if(fclose(psFile) != 0)
+      bWritten = FALSE;
+   return bWritten;
+}
+
+/*
+  Writes the string pcText to IO_TEMP_FILE. Returns TRUE if it was
+  written, or FALSE otherwise.
+*/
+static boolean Io_writeFile(const char *pcText) {
+   return Io_writeBytes(pcText, strlen(pcText));
+}
+
+/*
+  Checks that loading the manifest pcManifest into oDTree returns
+  iExpected, reports line ulExpectedLine, and leaves oDTree holding
+  exactly the ulHeld paths ppcHeld. Returns the number of failed
+  checks.
+*/
+static size_t Io_checkLoad(DT_T oDTree, const char *pcManifest,
+                           int iExpected, size_t ulExpectedLine,
+                           const char **ppcHeld, size_t ulHeld,
+                           const char *pcTest) {
+   size_t ulLine = 0;
+   size_t ulFailures = 0;
+
+   if(!Io_writeFile(pcManifest))
+      return Io_fail(pcTest, "Cannot write " IO_TEMP_FILE);
+   if(DT_treeLoad(oDTree, IO_TEMP_FILE, &ulLine) != iExpected)
+      ulFailures += Io_fail(pcTest, "DT_treeLoad returned the wrong "
+                            "status");
+   if(ulLine != ulExpectedLine)
+      ulFailures += Io_fail(pcTest, "DT_treeLoad reported the wrong "
+                            "line");
+   (void) remove(IO_TEMP_FILE);
+   return ulFailures + Io_checkHolds(oDTree, ppcHeld, ulHeld, pcTest);
+}
+
+/*
+  Tests DT_treeLoad on good manifests, with and without a final
+  newline and empty, on manifests with a bad or conflicting line,
+  which must change nothing and be reported by number, and on a
+  missing file, and DT_load on the singleton DT. Returns the number
+  of failed checks.
+*/
+static size_t Io_testLoad(void) {
+   const char *apcGood[] = {"r/a/b", "r/c", "r/a/d"};
+   const char *apcEndless[] = {"r/a"};
+   const char *apcOld[] = {"r/x"};
+   DT_T oDTree;
+   size_t ulLine = 0;
+   size_t ulFailures = 0;
+
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return Io_fail("load", "Out of memory");
+   /* the children of r/a are listed apart, out of DT_toString's
+      order, and must still all be inserted */
+   ulFailures += Io_checkLoad(oDTree, "r\nr/a\nr/a/b\nr/c\nr/a/d\n",
+                              SUCCESS, 0, apcGood, IO_COUNT(apcGood),
+                              "load, good");
+   DT_free(oDTree);
+
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return ulFailures + Io_fail("load", "Out of memory");
+   ulFailures += Io_checkLoad(oDTree, "r\nr/a", SUCCESS, 0,
+                              apcEndless, IO_COUNT(apcEndless),
+                              "load, no final newline");
+   ulFailures += Io_checkLoad(oDTree, "", SUCCESS, 0,
+                              apcEndless, IO_COUNT(apcEndless),
+                              "load, empty");
+   DT_free(oDTree);
+
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return ulFailures + Io_fail("load", "Out of memory");
+   ulFailures += Io_checkLoad(oDTree, "r\nr/a\nr//b\nr/c\n", BAD_PATH,
+                              3, NULL, 0, "load, bad path");
+   ulFailures += Io_checkLoad(oDTree, "r\nr/a\nq/b\n",
+                              CONFLICTING_PATH, 3, NULL, 0,
+                              "load, two roots");
+   DT_free(oDTree);
+
+   /* a different root conflicts from the first line, even when a
+      later line is a bad path */
+   oDTree = DT_new();
+   if(oDTree == NULL || DT_treeInsert(oDTree, "r/x") != SUCCESS)
+      return ulFailures + Io_fail("load", "Cannot build a DT");
+   ulFailures += Io_checkLoad(oDTree, "s\ns/a\n", CONFLICTING_PATH, 1,
+                              apcOld, IO_COUNT(apcOld),
+                              "load, conflicting");
+   ulFailures += Io_checkLoad(oDTree, "s\ns//a\n", CONFLICTING_PATH,
+                              1, apcOld, IO_COUNT(apcOld),
+                              "load, conflicting first");
+   if(DT_treeLoad(oDTree, IO_TEMP_FILE, &ulLine) != IO_ERROR ||
+      ulLine != 0)
+      ulFailures += Io_fail("load, missing file",
+                            "IO_ERROR was not reported");
+   DT_free(oDTree);
+
+   if(!Io_writeFile("r\nr/a\n"))
+      ulFailures += Io_fail("load, singleton",
+                            "Cannot write " IO_TEMP_FILE);
+   else {
+      if(DT_load(IO_TEMP_FILE, NULL) != INITIALIZATION_ERROR)
+         ulFailures += Io_fail("load, singleton",
+                               "DT_load worked before DT_init");
+      if(DT_init() != SUCCESS || DT_load(IO_TEMP_FILE, NULL) != SUCCESS
+         || !DT_contains("r/a"))
+         ulFailures += Io_fail("load, singleton", "loading failed");
+      (void) DT_destroy();
+      (void) remove(IO_TEMP_FILE);
+   }
+
+   printf("%-24s %s\n", "load", ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*
+  Sets *ppcBytes to a new array holding the contents of IO_TEMP_FILE
+  and *pulLength to their length. Returns TRUE if the whole file was
+  read, or FALSE otherwise.
+*/
+static boolean Io_readFile(char **ppcBytes, size_t *pulLength) {
+   FILE *psFile;
+   char *pcBytes = NULL;
+   char *pcBigger;
+   size_t ulLength = 0;
+   size_t ulSlots = 0;
+   size_t ulRead;
+
+   psFile = fopen(IO_TEMP_FILE, "rb");
+   if(psFile == NULL)
+      return FALSE;
+   do {
+      if(ulLength == ulSlots) {
+         ulSlots = ulSlots == 0 ? 4096 : 2 * ulSlots;
+         pcBigger = realloc(pcBytes, ulSlots);
+         if(pcBigger == NULL) {
+            free(pcBytes);
+            (void) fclose(psFile);
+            return FALSE;
+         }
+         pcBytes = pcBigger;
+      }
+      ulRead = fread(pcBytes + ulLength, 1, ulSlots - ulLength, psFile);
+      ulLength += ulRead;
+   } while(ulRead != 0);
+   if(ferror(psFile)) {
+      free(pcBytes);
+      (void) fclose(psFile);
+      return FALSE;
+   }
+   (void) fclose(psFile);
+   *ppcBytes = pcBytes;
+   *pulLength = ulLength;
+   return TRUE;
+}
+
+/*
+  Checks that loading the ulLength bytes at pcBytes as a snapshot
+  into oDTree returns iExpected and leaves oDTree as it was. Returns
+  the number of failed checks.
+*/
+static size_t Io_checkSnapshot(DT_T oDTree, const char *pcBytes,
+                               size_t ulLength, int iExpected,
+                               const char *pcTest) {
+   char *pcBefore;
+   char *pcAfter;
+   size_t ulFailures = 0;
+
+   if(!Io_writeBytes(pcBytes, ulLength))
+      return Io_fail(pcTest, "Cannot write " IO_TEMP_FILE);
+   pcBefore = DT_treeToString(oDTree);
+   if(DT_treeLoadSnapshot(oDTree, IO_TEMP_FILE) != iExpected)
+      ulFailures += Io_fail(pcTest, "DT_treeLoadSnapshot returned the "
+                            "wrong status");
+   pcAfter = DT_treeToString(oDTree);
+   if(pcBefore == NULL || pcAfter == NULL)
+      ulFailures += Io_fail(pcTest, "DT_treeToString returned NULL");
+   else if(strcmp(pcBefore, pcAfter) != 0)
+      ulFailures += Io_fail(pcTest, "a failed load changed the DT");
+   free(pcBefore);
+   free(pcAfter);
+   (void) remove(IO_TEMP_FILE);
+   return ulFailures;
+}
+
+/*
+  Tests that saving a DT as a snapshot and loading it into an empty
+  one gives the same DT, and that loading fails, changing nothing,
+  into a DT that is not empty and from a snapshot with a bad magic
+  number, cut short, or with a child index out of place. Returns the
+  number of failed checks.
+*/
+static size_t Io_testSnapshot(void) {
+   DT_T oDTSaved;
+   DT_T oDTree;
+   FILE *psFile;
+   char *pcBytes = NULL;
+   size_t ulLength = 0;
+   char *pcSaved;
+   char *pcLoaded;
+   uint64_t ulFirstChild;
+   size_t ulFailures = 0;
+
+   oDTSaved = Io_build(IO_BIG_NODES);
+   if(oDTSaved == NULL)
+      return Io_fail("snapshot", "Cannot build a DT");
+   psFile = fopen(IO_TEMP_FILE, "wb");
+   if(psFile == NULL) {
+      DT_free(oDTSaved);
+      return Io_fail("snapshot", "Cannot write " IO_TEMP_FILE);
+   }
+   if(DT_treeSaveSnapshot(oDTSaved, psFile) != SUCCESS)
+      ulFailures += Io_fail("snapshot", "DT_treeSaveSnapshot failed");
+   if(fclose(psFile) != 0 || !Io_readFile(&pcBytes, &ulLength) ||
+      ulLength <= IO_SNAPSHOT_TABLE) {
+      free(pcBytes);
+      DT_free(oDTSaved);
+      return ulFailures + Io_fail("snapshot", "Cannot read the "
+                                  "snapshot back");
+   }
+
+   oDTree = DT_new();
+   if(oDTree == NULL) {
+      free(pcBytes);
+      DT_free(oDTSaved);
+      return ulFailures + Io_fail("snapshot", "Out of memory");
+   }
+   if(DT_treeLoadSnapshot(oDTree, IO_TEMP_FILE) != SUCCESS)
+      ulFailures += Io_fail("snapshot, round trip",
+                            "DT_treeLoadSnapshot failed");
+   pcSaved = DT_treeToString(oDTSaved);
+   pcLoaded = DT_treeToString(oDTree);
+   if(pcSaved == NULL || pcLoaded == NULL)
+      ulFailures += Io_fail("snapshot, round trip",
+                            "DT_treeToString returned NULL");
+   else if(strcmp(pcSaved, pcLoaded) != 0)
+      ulFailures += Io_fail("snapshot, round trip",
+                            "the loaded DT differs from the saved one");
+   free(pcSaved);
+   free(pcLoaded);
+
+   /* the DT just loaded is not empty */
+   ulFailures += Io_checkSnapshot(oDTree, pcBytes, ulLength,
+                                  CONFLICTING_PATH, "snapshot, full");
+   DT_free(oDTree);
+   DT_free(oDTSaved);
+
+   oDTree = DT_new();
+   if(oDTree == NULL) {
+      free(pcBytes);
+      return ulFailures + Io_fail("snapshot", "Out of memory");
+   }
+   ulFailures += Io_checkSnapshot(oDTree, pcBytes, ulLength - 1,
+                                  IO_ERROR, "snapshot, truncated");
+   ulFailures += Io_checkSnapshot(oDTree, pcBytes,
+                                  IO_SNAPSHOT_TABLE / 2, IO_ERROR,
+                                  "snapshot, short header");
+
+   /* the root's children must start right after it, at entry 1 */
+   memcpy(&ulFirstChild, pcBytes + IO_SNAPSHOT_TABLE +
+          IO_SNAPSHOT_FIRST_CHILD, sizeof(ulFirstChild));
+   ulFirstChild++;
+   memcpy(pcBytes + IO_SNAPSHOT_TABLE + IO_SNAPSHOT_FIRST_CHILD,
+          &ulFirstChild, sizeof(ulFirstChild));
+   ulFailures += Io_checkSnapshot(oDTree, pcBytes, ulLength, IO_ERROR,
+                                  "snapshot, bad first child");
+   ulFirstChild--;
+   memcpy(pcBytes + IO_SNAPSHOT_TABLE + IO_SNAPSHOT_FIRST_CHILD,
+          &ulFirstChild, sizeof(ulFirstChild));
+
+   pcBytes[0] ^= 1;
+   ulFailures += Io_checkSnapshot(oDTree, pcBytes, ulLength, IO_ERROR,
+                                  "snapshot, bad magic");
+   DT_free(oDTree);
+   free(pcBytes);
+
+   if(DT_loadSnapshot(IO_TEMP_FILE) != INITIALIZATION_ERROR ||
+      DT_saveSnapshot(stdout) != INITIALIZATION_ERROR)
+      ulFailures += Io_fail("snapshot, singleton",
+                            "a snapshot was used before DT_init");
+
+   printf("%-24s %s\n", "snapshot", ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*
+  Checks that opening the journal of the ulLength bytes at pcBytes,
+  with IO_SNAPSHOT_FILE, restores into a new DT exactly the ulHeld
+  paths ppcHeld. Returns the number of failed checks.
+*/
+static size_t Io_checkJournal(const char *pcBytes, size_t ulLength,
+                              const char **ppcHeld, size_t ulHeld,
+                              const char *pcTest) {
+   DT_T oDTree;
+   size_t ulFailures = 0;
+
+   if(!Io_writeBytes(pcBytes, ulLength))
+      return Io_fail(pcTest, "Cannot write " IO_TEMP_FILE);
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return Io_fail(pcTest, "Out of memory");
+   if(DT_treeOpenJournal(oDTree, IO_SNAPSHOT_FILE, IO_TEMP_FILE, FALSE)
+      != SUCCESS)
+      ulFailures += Io_fail(pcTest, "DT_treeOpenJournal failed");
+   ulFailures += Io_checkHolds(oDTree, ppcHeld, ulHeld, pcTest);
+   DT_free(oDTree);
+   return ulFailures;
+}
+
+/*
+  Tests that a journaled DT's changes are replayed when its journal is
+  reopened, that a record cut short or failing its checksum ends the
+  journal, that a checkpoint empties the journal and keeps every
+  change, and that only an empty DT can be journaled. Returns the
+  number of failed checks.
+*/
+static size_t Io_testJournal(void) {
+   const char *apcAll[] = {"r/a/b", "r/c"};
+   const char *apcTorn[] = {"r/a/b", "r/c", "r/d"};
+   const char *apcCheckpointed[] = {"r/a/b", "r/c", "r/e", "r/f"};
+   DT_T oDTree;
+   char *pcBytes = NULL;
+   size_t ulLength = 0;
+   char *pcAfter = NULL;
+   size_t ulAfter = 0;
+   size_t ulFailures = 0;
+
+   (void) remove(IO_TEMP_FILE);
+   (void) remove(IO_SNAPSHOT_FILE);
+
+   /* each change is on the disk when it returns */
+   oDTree = DT_new();
+   if(oDTree == NULL)
+      return Io_fail("journal", "Out of memory");
+   if(DT_treeOpenJournal(oDTree, IO_SNAPSHOT_FILE, IO_TEMP_FILE, TRUE)
+      != SUCCESS ||
+      DT_treeInsert(oDTree, "r/a/b") != SUCCESS ||
+      DT_treeInsert(oDTree, "r/c") != SUCCESS ||
+      DT_treeInsert(oDTree, "r/d") != SUCCESS ||
+      DT_treeRm(oDTree, "r/d") != SUCCESS ||
+      DT_treeSyncJournal(oDTree) != SUCCESS)
+      ulFailures += Io_fail("journal", "journaled changes failed");
+   DT_free(oDTree);
+   if(!Io_readFile(&pcBytes, &ulLength))
+      return ulFailures + Io_fail("journal", "Cannot read the journal "
+                                  "back");
+
+   ulFailures += Io_checkJournal(pcBytes, ulLength, apcAll,
+                                 IO_COUNT(apcAll), "journal, replay");
+   /* the last record is the removal of r/d */
+   ulFailures += Io_checkJournal(pcBytes, ulLength - 1, apcTorn,
+                                 IO_COUNT(apcTorn),
+                                 "journal, torn record");
+   pcBytes[ulLength - 1] ^= 1;
+   ulFailures += Io_checkJournal(pcBytes, ulLength, apcTorn,
+                                 IO_COUNT(apcTorn),
+                                 "journal, bad checksum");
+   pcBytes[ulLength - 1] ^= 1;
+
+   /* r/e goes into the snapshot, and r/f into the emptied journal */
+   if(!Io_writeBytes(pcBytes, ulLength))
+      ulFailures += Io_fail("journal, checkpoint",
+                            "Cannot write " IO_TEMP_FILE);
+   oDTree = DT_new();
+   if(oDTree == NULL) {
+      free(pcBytes);
+      return ulFailures + Io_fail("journal", "Out of memory");
+   }
+   if(DT_treeOpenJournal(oDTree, IO_SNAPSHOT_FILE, IO_TEMP_FILE, FALSE)
+      != SUCCESS ||
+      DT_treeInsert(oDTree, "r/e") != SUCCESS ||
+      DT_treeCheckpoint(oDTree) != SUCCESS ||
+      DT_treeInsert(oDTree, "r/f") != SUCCESS ||
+      DT_treeSyncJournal(oDTree) != SUCCESS)
+      ulFailures += Io_fail("journal, checkpoint",
+                            "journaled changes failed");
+   DT_free(oDTree);
+   if(!Io_readFile(&pcAfter, &ulAfter))
+      ulFailures += Io_fail("journal, checkpoint",
+                            "Cannot read the journal back");
+   else {
+      if(ulAfter >= ulLength)
+         ulFailures += Io_fail("journal, checkpoint",
+                               "the journal was not emptied");
+      ulFailures += Io_checkJournal(pcAfter, ulAfter, apcCheckpointed,
+                                    IO_COUNT(apcCheckpointed),
+                                    "journal, checkpoint");
+   }
+   free(pcAfter);
+   free(pcBytes);
+
+   oDTree = DT_new();
+   if(oDTree == NULL || DT_treeInsert(oDTree, "r/x") != SUCCESS)
+      ulFailures += Io_fail("journal", "Cannot build a DT");
+   else if(DT_treeOpenJournal(oDTree, IO_SNAPSHOT_FILE, IO_TEMP_FILE,
+                              FALSE) != CONFLICTING_PATH)
+      ulFailures += Io_fail("journal, full",
+                            "a DT that is not empty was journaled");
+   if(oDTree != NULL)
+      DT_free(oDTree);
+   (void) remove(IO_TEMP_FILE);
+   (void) remove(IO_SNAPSHOT_FILE);
+
+   if(DT_syncJournal() != INITIALIZATION_ERROR ||
+      DT_checkpoint() != INITIALIZATION_ERROR)
+      ulFailures += Io_fail("journal, singleton",
+                            "the journal was used before DT_init");
+
+   printf("%-24s %s\n", "journal", ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*
+  Inserts IO_CHECKPOINT_NODES directories into the journaled DT of the
+  struct writer that pvWriter points to, syncing its journal now and
+  then so that some of their records reach the file before a
+  checkpoint restarts it, and then marks it done. Has the signature
+  pthread_create expects.
+*/
+static void *Io_insertMany(void *pvWriter) {
+   struct writer *psWriter = pvWriter;
+   char acPath[IO_MAX_PATH];
+   size_t i;
+
+   for(i = 0; i < IO_CHECKPOINT_NODES; i++) {
+      sprintf(acPath, "r/d%lu/e%lu", (unsigned long) (i % 37),
+              (unsigned long) i);
+      if(DT_treeInsert(psWriter->oDTree, acPath) != SUCCESS)
+         psWriter->ulFailures++;
+      if(i % 64 == 63 && DT_treeSyncJournal(psWriter->oDTree) != SUCCESS)
+         psWriter->ulFailures++;
+   }
+   __atomic_store_n(&psWriter->iDone, 1, __ATOMIC_RELEASE);
+   return NULL;
+}
+
+/*
+  Tests that checkpoints taken while a writer goes on inserting keep
+  every change: the changes made while a checkpoint makes its
+  snapshot durable must be carried over into the restarted journal.
+  Returns the number of failed checks.
+*/
+static size_t Io_testCheckpoint(void) {
+   struct writer sWriter;
+   pthread_t sThread;
+   DT_T oDTree;
+   char *pcExpected = NULL;
+   char *pcRestored = NULL;
+   size_t ulFailures = 0;
+
+   (void) remove(IO_TEMP_FILE);
+   (void) remove(IO_SNAPSHOT_FILE);
+
+   sWriter.oDTree = DT_new();
+   sWriter.ulFailures = 0;
+   sWriter.iDone = 0;
+   if(sWriter.oDTree == NULL)
+      return Io_fail("checkpoint", "Out of memory");
+   if(DT_treeOpenJournal(sWriter.oDTree, IO_SNAPSHOT_FILE, IO_TEMP_FILE,
+                         FALSE) != SUCCESS ||
+      DT_treeInsert(sWriter.oDTree, "r") != SUCCESS) {
+      DT_free(sWriter.oDTree);
+      return Io_fail("checkpoint", "Cannot journal a DT");
+   }
+   if(pthread_create(&sThread, NULL, Io_insertMany, &sWriter) != 0) {
+      DT_free(sWriter.oDTree);
+      return Io_fail("checkpoint", "Cannot start the writer");
+   }
+   do {
+      if(DT_treeCheckpoint(sWriter.oDTree) != SUCCESS)
+         ulFailures += Io_fail("checkpoint",
+                               "DT_treeCheckpoint failed");
+   } while(!__atomic_load_n(&sWriter.iDone, __ATOMIC_ACQUIRE));
+   (void) pthread_join(sThread, NULL);
+   if(sWriter.ulFailures != 0)
+      ulFailures += Io_fail("checkpoint", "an insertion failed");
+
+   pcExpected = DT_treeToString(sWriter.oDTree);
+   if(DT_treeSyncJournal(sWriter.oDTree) != SUCCESS)
+      ulFailures += Io_fail("checkpoint", "DT_treeSyncJournal failed");
+   DT_free(sWriter.oDTree);
+
+   oDTree = DT_new();
+   if(oDTree == NULL || pcExpected == NULL) {
+      free(pcExpected);
+      if(oDTree != NULL)
+         DT_free(oDTree);
+      return ulFailures + Io_fail("checkpoint", "Out of memory");
+   }
+   if(DT_treeOpenJournal(oDTree, IO_SNAPSHOT_FILE, IO_TEMP_FILE, FALSE)
+      != SUCCESS)
+      ulFailures += Io_fail("checkpoint", "DT_treeOpenJournal failed");
+   pcRestored = DT_treeToString(oDTree);
+   if(pcRestored == NULL || strcmp(pcRestored, pcExpected) != 0)
+      ulFailures += Io_fail("checkpoint",
+                            "the reopened DT lost changes");
+   free(pcRestored);
+   free(pcExpected);
+   DT_free(oDTree);
+   (void) remove(IO_TEMP_FILE);
+   (void) remove(IO_SNAPSHOT_FILE);
+
+   printf("%-24s %s\n", "checkpoint", ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Tests the DT functions that read a DT in, write one out, journal its
+  changes, or put many paths into one at once. Takes no command-line
+  arguments. Returns 0 (EXIT_SUCCESS) if every check passed, or
+  EXIT_FAILURE otherwise.
+*/
+int main(void) {
+   size_t ulFailures = 0;
+
+   ulFailures += Io_testDump();
+   ulFailures += Io_testBatch();
+   ulFailures += Io_testLoad();
+   ulFailures += Io_testSnapshot();
+   ulFailures += Io_testJournal();
+   ulFailures += Io_testCheckpoint();
+
+   return ulFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
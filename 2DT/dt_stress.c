@@ -0,0 +1,486 @@
+/*--------------------------------------------------------------------*/
+/* dt_stress.c                                                        */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+/* pthreads are POSIX, not ISO C */
+#define _XOPEN_SOURCE 600
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "dt.h"
+#include "dtExt.h"
+
+/* The final check is DT_free's full CheckerDT_isValid assertion */
+#ifdef NDEBUG
+#error "dt_stress must be built without NDEBUG"
+#endif
+
+/* The number of names each directory of a worker's namespace has */
+enum { STRESS_FANOUT = 4 };
+
+/* The number of levels in a worker's namespace, and how many
+   directories it has across all of them (4 + 16 + 64) */
+enum { STRESS_LEVELS = 3 };
+enum { STRESS_NODES = 84 };
+
+/* The longest path a worker builds */
+enum { STRESS_MAX_PATH = 64 };
+
+/* The number of absent paths the final checks look up to see how the
+   miss filter counts them */
+enum { STRESS_ABSENT_PATHS = 16 };
+
+/*
+  One writer thread and its namespace: the directories below acBase
+  whose names at each level are a letter followed by a digit less
+  than STRESS_FANOUT. The writer alone changes that namespace, so it
+  knows what each of its operations must return.
+*/
+struct worker {
+   /* the tree under test */
+   DT_T oDTree;
+   /* the directory the namespace is below */
+   char acBase[STRESS_MAX_PATH];
+   /* the letter of the namespace's top-level names */
+   char cTop;
+   /* the number of operations to perform */
+   size_t ulOps;
+   /* the state of the worker's random number generator */
+   uint64_t ulState;
+   /* which directories of the namespace are in the tree, by index */
+   boolean abPresent[STRESS_NODES];
+   /* the number of operations that returned the wrong result */
+   size_t ulFailures;
+};
+
+/* A reader thread's tree and results, and whether it should stop */
+struct readers {
+   DT_T oDTree;
+   int iStop;
+   size_t ulFailures;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the next number from *pulState's xorshift generator. */
+static uint64_t Stress_random(uint64_t *pulState) {
+   *pulState ^= *pulState << 13;
+   *pulState ^= *pulState >> 7;
+   *pulState ^= *pulState << 17;
+   return *pulState;
+}
+
+/* Returns the index of the first directory at level ulLevel. */
+static size_t Stress_levelStart(size_t ulLevel) {
+   size_t ulStart = 0;
+   size_t ulWidth = STRESS_FANOUT;
+
+   while(ulLevel-- != 0) {
+      ulStart += ulWidth;
+      ulWidth *= STRESS_FANOUT;
+   }
+   return ulStart;
+}
+
+/* Returns the level of the directory with index ulNode. */
+static size_t Stress_level(size_t ulNode) {
+   size_t ulLevel = 0;
+
+   while(ulNode >= Stress_levelStart(ulLevel + 1))
+      ulLevel++;
+   return ulLevel;
+}
+
+/*
+  Writes the path of psWorker's directory with index ulNode into
+  acPath, which must have room for STRESS_MAX_PATH characters.
+*/
+static void Stress_makePath(const struct worker *psWorker, size_t ulNode,
+                            char acPath[]) {
+   size_t ulLevel;
+   size_t ulPosition;
+   size_t ulLength;
+   size_t ulDivisor = 1;
+   size_t i;
+
+   ulLevel = Stress_level(ulNode);
+   ulPosition = ulNode - Stress_levelStart(ulLevel);
+   for(i = 0; i < ulLevel; i++)
+      ulDivisor *= STRESS_FANOUT;
+
+   strcpy(acPath, psWorker->acBase);
+   ulLength = strlen(acPath);
+   for(i = 0; i <= ulLevel; i++) {
+      acPath[ulLength++] = '/';
+      acPath[ulLength++] = i == 0 ? psWorker->cTop : 'c';
+      acPath[ulLength++] = (char) ('0' + ulPosition / ulDivisor %
+                                   STRESS_FANOUT);
+      ulDivisor /= STRESS_FANOUT;
+   }
+   acPath[ulLength] = '\0';
+}
+
+/* Marks psWorker's directory ulNode and its ancestors present. */
+static void Stress_markInserted(struct worker *psWorker, size_t ulNode) {
+   size_t ulLevel;
+
+   for(ulLevel = Stress_level(ulNode); ; ulLevel--) {
+      psWorker->abPresent[ulNode] = TRUE;
+      if(ulLevel == 0)
+         break;
+      ulNode = Stress_levelStart(ulLevel - 1) +
+         (ulNode - Stress_levelStart(ulLevel)) / STRESS_FANOUT;
+   }
+}
+
+/* Marks psWorker's directory ulNode and its descendants absent. */
+static void Stress_markRemoved(struct worker *psWorker, size_t ulNode) {
+   size_t ulLevel;
+   size_t ulFirst;
+   size_t i;
+
+   psWorker->abPresent[ulNode] = FALSE;
+   ulLevel = Stress_level(ulNode);
+   if(ulLevel + 1 == STRESS_LEVELS)
+      return;
+   ulFirst = Stress_levelStart(ulLevel + 1) +
+      (ulNode - Stress_levelStart(ulLevel)) * STRESS_FANOUT;
+   for(i = 0; i < STRESS_FANOUT; i++)
+      Stress_markRemoved(psWorker, ulFirst + i);
+}
+
+/* Reports a wrong result of psWorker's operation on pcPath. */
+static void Stress_fail(struct worker *psWorker, const char *pcOperation,
+                        const char *pcPath, int iExpected, int iActual) {
+   fprintf(stderr, "%s %s: expected %d, got %d\n", pcOperation, pcPath,
+           iExpected, iActual);
+   psWorker->ulFailures++;
+}
+
+/*
+  Performs pvWorker's random inserts (some of them batches), removals,
+  and lookups, checking each result. Has the signature pthread_create
+  expects.
+*/
+static void *Stress_write(void *pvWorker) {
+   struct worker *psWorker = pvWorker;
+   char acPath[STRESS_MAX_PATH];
+   char acOther[STRESS_MAX_PATH];
+   const char *apcBatch[2];
+   size_t ulNode;
+   size_t ulOther;
+   size_t ulChoice;
+   int iExpected;
+   int iActual;
+   size_t i;
+
+   for(i = 0; i < psWorker->ulOps; i++) {
+      ulNode = Stress_random(&psWorker->ulState) % STRESS_NODES;
+      ulChoice = Stress_random(&psWorker->ulState) % 8;
+      Stress_makePath(psWorker, ulNode, acPath);
+
+      if(ulChoice == 3) {
+         /* a batch of two, in either order, that may overlap or
+            already be present, but is always inserted */
+         ulOther = Stress_random(&psWorker->ulState) % STRESS_NODES;
+         Stress_makePath(psWorker, ulOther, acOther);
+         apcBatch[0] = acPath;
+         apcBatch[1] = acOther;
+         iActual = DT_treeInsertBatch(psWorker->oDTree, apcBatch, 2);
+         if(iActual != SUCCESS)
+            Stress_fail(psWorker, "batch insert", acPath, SUCCESS,
+                        iActual);
+         Stress_markInserted(psWorker, ulNode);
+         Stress_markInserted(psWorker, ulOther);
+      }
+      else if(ulChoice < 4) {
+         iExpected = psWorker->abPresent[ulNode] ? ALREADY_IN_TREE
+                                                 : SUCCESS;
+         iActual = DT_treeInsert(psWorker->oDTree, acPath);
+         if(iActual != iExpected)
+            Stress_fail(psWorker, "insert", acPath, iExpected, iActual);
+         if(iActual == SUCCESS)
+            Stress_markInserted(psWorker, ulNode);
+      }
+      else if(ulChoice < 6) {
+         iExpected = psWorker->abPresent[ulNode] ? SUCCESS
+                                                 : NO_SUCH_PATH;
+         iActual = DT_treeRm(psWorker->oDTree, acPath);
+         if(iActual != iExpected)
+            Stress_fail(psWorker, "rm", acPath, iExpected, iActual);
+         if(iActual == SUCCESS)
+            Stress_markRemoved(psWorker, ulNode);
+      }
+      else {
+         iExpected = (int) psWorker->abPresent[ulNode];
+         iActual = (int) DT_treeContains(psWorker->oDTree, acPath);
+         if(iActual != iExpected)
+            Stress_fail(psWorker, "contains", acPath, iExpected,
+                        iActual);
+      }
+   }
+   return NULL;
+}
+
+/*
+  Looks up paths and builds string representations of pvReaders'
+  tree until told to stop, checking only that the root is always
+  there. Has the signature pthread_create expects.
+*/
+static void *Stress_read(void *pvReaders) {
+   struct readers *psReaders = pvReaders;
+   char *pcString;
+   size_t ulRounds = 0;
+
+   while(!__atomic_load_n(&psReaders->iStop, __ATOMIC_ACQUIRE)) {
+      if(!DT_treeContains(psReaders->oDTree, "r/p0")) {
+         fprintf(stderr, "r/p0 is missing\n");
+         psReaders->ulFailures++;
+      }
+      if(++ulRounds % 64 == 0) {
+         pcString = DT_treeToString(psReaders->oDTree);
+         if(pcString == NULL || strncmp(pcString, "r\n", 2)) {
+            fprintf(stderr, "DT_treeToString lost the root\n");
+            psReaders->ulFailures++;
+         }
+         free(pcString);
+      }
+   }
+   return NULL;
+}
+
+/* Returns the number of lines in pcString. */
+static size_t Stress_countLines(const char *pcString) {
+   size_t ulLines = 0;
+
+   for(; *pcString != '\0'; pcString++)
+      if(*pcString == '\n')
+         ulLines++;
+   return ulLines;
+}
+
+/*
+  Checks oDTree's index size and miss filter counts against its
+  options iOptions: a path that is present must count as a filter
+  check but neither a miss nor a false positive, each path that is
+  absent as a check and exactly one of the two, and most absent ones
+  as misses. Returns the number of failed checks.
+*/
+static size_t Stress_checkCounters(DT_T oDTree, int iOptions) {
+   size_t ulChecks;
+   size_t ulMisses;
+   size_t ulFalsePositives;
+   size_t ulChecksAfter;
+   size_t ulMissesAfter;
+   size_t ulFalsePositivesAfter;
+   size_t ulAbsentMisses = 0;
+   size_t ulFailures = 0;
+   char acPath[STRESS_MAX_PATH];
+   boolean bIsFiltered;
+   size_t i;
+
+   if((DT_getIndexBytes(oDTree) != 0) !=
+      ((iOptions & DT_PATH_INDEX) != 0)) {
+      fprintf(stderr, "DT_getIndexBytes disagrees with the options\n");
+      ulFailures++;
+   }
+
+   bIsFiltered = (boolean) ((iOptions & DT_MISS_FILTER) != 0 &&
+                            (iOptions & DT_LOCK_FREE_LOOKUPS) == 0);
+   DT_getFilterCounts(oDTree, &ulChecks, &ulMisses, &ulFalsePositives);
+   (void) DT_treeContains(oDTree, "r/p0");
+   DT_getFilterCounts(oDTree, &ulChecksAfter, &ulMissesAfter,
+                      &ulFalsePositivesAfter);
+   if(ulChecksAfter != ulChecks + (bIsFiltered ? 1 : 0) ||
+      ulMissesAfter != ulMisses ||
+      ulFalsePositivesAfter != ulFalsePositives) {
+      fprintf(stderr, "A present path counted wrongly in the filter\n");
+      ulFailures++;
+   }
+
+   for(i = 0; i < STRESS_ABSENT_PATHS; i++) {
+      sprintf(acPath, "r/absent%lu", (unsigned long) i);
+      ulChecks = ulChecksAfter;
+      ulMisses = ulMissesAfter;
+      ulFalsePositives = ulFalsePositivesAfter;
+      if(DT_treeContains(oDTree, acPath)) {
+         fprintf(stderr, "%s is present\n", acPath);
+         ulFailures++;
+      }
+      DT_getFilterCounts(oDTree, &ulChecksAfter, &ulMissesAfter,
+                         &ulFalsePositivesAfter);
+      if(ulChecksAfter != ulChecks + (bIsFiltered ? 1 : 0) ||
+         ulMissesAfter + ulFalsePositivesAfter !=
+         ulMisses + ulFalsePositives + (bIsFiltered ? 1 : 0)) {
+         fprintf(stderr, "An absent path counted wrongly in the "
+                 "filter\n");
+         ulFailures++;
+      }
+      ulAbsentMisses += ulMissesAfter - ulMisses;
+   }
+   if(bIsFiltered && ulAbsentMisses < STRESS_ABSENT_PATHS / 2) {
+      fprintf(stderr, "The filter let most absent paths through\n");
+      ulFailures++;
+   }
+
+   return ulFailures;
+}
+
+/*
+  Runs ulWriters project writers, one writer that creates and removes
+  children of the root, and a reader, all at once, on a new DT with
+  options iOptions; then checks that the DT holds exactly what the
+  writers expect, and frees it. Returns the number of failed checks.
+*/
+static size_t Stress_run(int iOptions, const char *pcMode,
+                         size_t ulWriters, size_t ulOps,
+                         unsigned long ulSeed) {
+   DT_T oDTree;
+   struct worker *psWorkers;
+   struct readers sReaders;
+   pthread_t *psThreads;
+   pthread_t sReader;
+   char acPath[STRESS_MAX_PATH];
+   char *pcString;
+   size_t ulExpected;
+   size_t ulFailures = 0;
+   size_t i;
+   size_t j;
+
+   oDTree = DT_newWith(iOptions);
+   psWorkers = calloc(ulWriters + 1, sizeof(struct worker));
+   psThreads = calloc(ulWriters + 1, sizeof(pthread_t));
+   if(oDTree == NULL || psWorkers == NULL || psThreads == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   /* each project writer owns "r/p<i>"; the last writer owns the
+      root's children "r/x<digit>" themselves */
+   for(i = 0; i <= ulWriters; i++) {
+      psWorkers[i].oDTree = oDTree;
+      psWorkers[i].ulOps = ulOps;
+      psWorkers[i].ulState =
+         UINT64_C(0x9E3779B97F4A7C15) * (ulSeed + i + 1);
+      if(i < ulWriters) {
+         sprintf(psWorkers[i].acBase, "r/p%lu", (unsigned long) i);
+         psWorkers[i].cTop = 'c';
+         if(DT_treeInsert(oDTree, psWorkers[i].acBase) != SUCCESS) {
+            fprintf(stderr, "Cannot insert %s\n", psWorkers[i].acBase);
+            exit(EXIT_FAILURE);
+         }
+      }
+      else {
+         strcpy(psWorkers[i].acBase, "r");
+         psWorkers[i].cTop = 'x';
+      }
+   }
+
+   sReaders.oDTree = oDTree;
+   sReaders.iStop = 0;
+   sReaders.ulFailures = 0;
+   if(pthread_create(&sReader, NULL, Stress_read, &sReaders) != 0) {
+      fprintf(stderr, "Cannot create a thread\n");
+      exit(EXIT_FAILURE);
+   }
+   for(i = 0; i <= ulWriters; i++)
+      if(pthread_create(&psThreads[i], NULL, Stress_write,
+                        &psWorkers[i]) != 0) {
+         fprintf(stderr, "Cannot create a thread\n");
+         exit(EXIT_FAILURE);
+      }
+   for(i = 0; i <= ulWriters; i++)
+      (void) pthread_join(psThreads[i], NULL);
+   __atomic_store_n(&sReaders.iStop, 1, __ATOMIC_RELEASE);
+   (void) pthread_join(sReader, NULL);
+
+   /* the tree must hold exactly the root, the projects, and what the
+      writers left present */
+   ulExpected = 1 + ulWriters;
+   ulFailures += sReaders.ulFailures;
+   for(i = 0; i <= ulWriters; i++) {
+      ulFailures += psWorkers[i].ulFailures;
+      for(j = 0; j < STRESS_NODES; j++) {
+         Stress_makePath(&psWorkers[i], j, acPath);
+         if(DT_treeContains(oDTree, acPath) !=
+            psWorkers[i].abPresent[j]) {
+            fprintf(stderr, "Final contents differ at %s\n", acPath);
+            ulFailures++;
+         }
+         if(psWorkers[i].abPresent[j])
+            ulExpected++;
+      }
+   }
+   pcString = DT_treeToString(oDTree);
+   if(pcString == NULL || Stress_countLines(pcString) != ulExpected) {
+      fprintf(stderr, "DT_treeToString has the wrong number of lines\n");
+      ulFailures++;
+   }
+   free(pcString);
+
+   ulFailures += Stress_checkCounters(oDTree, iOptions);
+
+   /* DT_free asserts CheckerDT_isValid over the whole tree */
+   DT_free(oDTree);
+   free(psThreads);
+   free(psWorkers);
+
+   printf("%-24s %lu writers x %lu ops: %s\n", pcMode,
+          (unsigned long) ulWriters + 1, (unsigned long) ulOps,
+          ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Stress tests concurrent writers on DTs with striped writes, alone,
+  with lock-free lookups, and with interned names. Command-line arguments are
+     [writers [ops [seed]]]
+  with defaults 8, 20000, and 1. Returns 0 (EXIT_SUCCESS) if every
+  operation returned what it should and the final trees were valid,
+  or EXIT_FAILURE otherwise.
+*/
+int main(int argc, char *argv[]) {
+   size_t ulWriters = 8;
+   size_t ulOps = 20000;
+   unsigned long ulSeed = 1;
+   size_t ulFailures = 0;
+
+   if(argc > 4) {
+      fprintf(stderr, "Usage: %s [writers [ops [seed]]]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+   if(argc > 1)
+      ulWriters = (size_t) strtoul(argv[1], NULL, 10);
+   if(argc > 2)
+      ulOps = (size_t) strtoul(argv[2], NULL, 10);
+   if(argc > 3)
+      ulSeed = strtoul(argv[3], NULL, 10);
+   if(ulWriters == 0) {
+      fprintf(stderr, "There must be at least one writer\n");
+      return EXIT_FAILURE;
+   }
+
+   ulFailures += Stress_run(DT_STRIPED_WRITES, "striped", ulWriters,
+                            ulOps, ulSeed);
+   ulFailures += Stress_run(DT_STRIPED_WRITES | DT_LOCK_FREE_LOOKUPS,
+                            "striped, lock-free", ulWriters, ulOps,
+                            ulSeed);
+   ulFailures += Stress_run(DT_STRIPED_WRITES | DT_INTERN_NAMES,
+                            "striped, interned", ulWriters, ulOps,
+                            ulSeed);
+   ulFailures += Stress_run(DT_STRIPED_WRITES | DT_PATH_INDEX,
+                            "striped, indexed", ulWriters, ulOps,
+                            ulSeed);
+   ulFailures += Stress_run(DT_STRIPED_WRITES | DT_MISS_FILTER,
+                            "striped, filtered", ulWriters, ulOps,
+                            ulSeed);
+
+   return ulFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1 @@
+../0shared/dynarrayExt.h
\ No newline at end of file
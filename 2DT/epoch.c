@@ -0,0 +1 @@
+../0shared/epoch.c
\ No newline at end of file
@@ -0,0 +1,154 @@
+/*--------------------------------------------------------------------*/
+/* nodeDTExt.h                                                        */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef NODE_EXT_INCLUDED
+#define NODE_EXT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "arena.h"
+#include "path.h"
+#include "nodeDT.h"
+
+/*
+  The functions below extend the node interface of nodeDT.h, which the
+  provided nodeDTBad*.o also implement and so must not change. Only
+  nodeDTGood implements them, and its nodes also behave as follows
+  where nodeDT.h leaves room:
+  * Node_free takes time linear in the size of the subtree and
+    constant stack space, however deep the subtree is.
+  * Node_getPath returns NULL if there is an allocation error. Nodes
+    store only their own name, so the path is built on the first call
+    and cached in the node until it is freed. The path remains owned
+    by the node. Safe to call on the same node from several threads
+    at once.
+  * Node_hasChild compares only the final component of oPPath with
+    the children's, so oPPath must be one level deeper than
+    oNParent's path.
+*/
+
+/*
+  Like Node_new, but the new node's path is the prefix of oPPath with
+  depth ulDepth, so that a client creating a node for every level of
+  a path needs no Path_T for each level (NO_SUCH_PATH if ulDepth is 0
+  or greater than oPPath's depth). And if oNParent is NULL, the new
+  root and every node later created below it take their memory from
+  oAArena instead of the heap (oAArena may be NULL, meaning the heap);
+  otherwise oAArena must be oNParent's arena. Node_free returns a
+  node's memory to its arena for reuse; freeing the arena instead
+  frees all of its nodes at once. Nodes in an arena cannot be
+  published.
+*/
+int Node_newIn(Arena_T oAArena, Path_T oPPath, size_t ulDepth,
+               Node_T oNParent, Node_T *poNResult);
+
+/*
+  Like Node_newIn, but creates the child of oNParent whose name is the
+  ulLength characters at pcName (which need not be '\0'-terminated),
+  so that no path is needed at all; the new node's memory comes from
+  oNParent's arena. If bIsInterned, the name is interned (see
+  intern.h), as a path made with Path_newInterned would have it.
+  Returns SUCCESS, MEMORY_ERROR, or ALREADY_IN_TREE as Node_new does,
+  or BAD_PATH if the name is empty or contains a '/' or a '\0'.
+*/
+int Node_newChild(Node_T oNParent, const char *pcName,
+                  size_t ulLength, boolean bIsInterned,
+                  Node_T *poNResult);
+
+/*
+  Prepares oNParent to take ulCount more children, setting aside room
+  for all of them at once instead of growing its storage for children
+  step by step as they arrive. Returns SUCCESS, or MEMORY_ERROR if
+  memory could not be allocated, in which case oNParent still takes
+  children one at a time as usual.
+*/
+int Node_reserveChildren(Node_T oNParent, size_t ulCount);
+
+/*
+  Like Node_free, but calls (*pfBefore)(oNDoomed, pvExtra) for each
+  node oNDoomed of the subtree just before freeing it, so that a
+  client can drop anything it keeps about the node. At that point
+  oNDoomed has no children left, but its name and its ancestors
+  (through Node_getParent) are still intact.
+*/
+size_t Node_freeWith(Node_T oNNode,
+                     void (*pfBefore)(Node_T oNDoomed, void *pvExtra),
+                     void *pvExtra);
+
+/*
+  Returns the final component of oNNode's absolute path. Unlike
+  Node_getPath, this never allocates memory.
+*/
+const char *Node_getName(Node_T oNNode);
+
+/*
+  Returns TRUE if oNParent has a child whose final path component is
+  pcName. Returns FALSE if it does not. This is equivalent to
+  Node_hasChild, but needs no Path_T for the child, so a path can be
+  walked one component at a time without allocating memory.
+
+  If oNParent has such a child, stores in *pulChildID the child's
+  identifier (as used in Node_getChild). If oNParent does not have
+  such a child, stores in *pulChildID the identifier that such a
+  child _would_ have if inserted.
+*/
+boolean Node_hasChildComponent(Node_T oNParent, const char *pcName,
+                               size_t *pulChildID);
+
+/*
+  Returns an int SUCCESS status and sets *poNResult to be the child
+  node of oNParent whose final path component is pcName, if one
+  exists. Otherwise, sets *poNResult to NULL and returns status:
+  * NO_SUCH_PATH if oNParent has no child named pcName
+  Unlike looking up a child identifier, this takes expected constant
+  time for nodes with enough children to be indexed by hash.
+*/
+int Node_getChildByName(Node_T oNParent, const char *pcName,
+                        Node_T *poNResult);
+
+/*
+  Like Node_getChildByName for the child whose final path component
+  is component ulLevel of oPPath, but without hashing the component
+  again, since oPPath already did.
+*/
+int Node_getChildByComponent(Node_T oNParent, Path_T oPPath,
+                             size_t ulLevel, Node_T *poNResult);
+
+/*
+  Nodes also keep a second view of their children for lookups that
+  take no lock (see DT_newLockFree): an immutable table per node,
+  which writers replace instead of changing. Node_new and Node_free
+  only change the first view; a node is visible to lock-free lookups
+  only between Node_publish and Node_unpublish, and a published node
+  is freed by Node_free only once no lookup can still be using it.
+*/
+
+/*
+  Makes oNNode, which must not have been published yet, visible to
+  lock-free lookups by adding it to its parent's published children.
+  A root has no parent, so publishing it only prepares it to be
+  reclaimed safely; the caller publishes it by storing it where
+  lookups start. Returns SUCCESS, or MEMORY_ERROR if memory could not
+  be allocated, in which case nothing changes.
+*/
+int Node_publish(Node_T oNNode);
+
+/*
+  Removes published node oNNode from its parent's published children,
+  so that lookups that begin from now on cannot find it. Returns
+  SUCCESS, or MEMORY_ERROR if memory could not be allocated, in which
+  case nothing changes.
+*/
+int Node_unpublish(Node_T oNNode);
+
+/*
+  Returns oNParent's published child named pcName, or NULL if it has
+  none. Takes no lock and may run while oNParent is being changed; the
+  caller must be between Epoch_enter and Epoch_exit for as long as it
+  uses oNParent or the result.
+*/
+Node_T Node_getPublishedChild(Node_T oNParent, const char *pcName);
+
+#endif
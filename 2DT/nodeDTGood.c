@@ -3,52 +3,698 @@
 /* Author: Christopher Moretti                                        */
 /*--------------------------------------------------------------------*/
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include "arena.h"
 #include "dynarray.h"
+#include "dynarrayExt.h"
+#include "btree.h"
+#include "epoch.h"
+#include "intern.h"
+#include "path.h"
+#include "pathExt.h"
 #include "nodeDT.h"
+#include "nodeDTExt.h"
 #include "checkerDT.h"
 
-/* A node in a DT */
+/* The number of children a node can hold without allocating more
+   memory for its children array */
+static const size_t NODE_INLINE_CHILDREN = 4;
+
+/* The length below which Node_newChild copies a name on the stack */
+enum { NODE_SHORT_NAME = 256 };
+
+/* The number of children at which a node moves its children into a
+   B-tree indexed by hash (and half of which it moves them back) */
+static const size_t NODE_LARGE_THRESHOLD = 64;
+
+/* One slot in a child index */
+struct childSlot {
+   /* the hash of the child's name */
+   size_t ulHash;
+   /* the child stored in this slot, or NULL if the slot is empty */
+   Node_T oNChild;
+};
+
+/*
+  A hash index from name to child over all of a node's children, kept
+  only by nodes with many children alongside the B-tree that keeps
+  those children in order.
+*/
+struct childIndex {
+   /* the number of slots in asSlots, always a power of 2 */
+   size_t ulSlots;
+   /* the open addressing (linear probing) table of children, with
+      ulSlots slots */
+   struct childSlot asSlots[1];
+};
+
+/*
+  The children of a node as lock-free readers see them: an immutable
+  array, in order, that writers replace with an updated copy rather
+  than change, so that a reader holding the old one is never
+  disturbed.
+*/
+struct childTable {
+   /* the link by which the table is retired once replaced */
+   struct EpochLink sRetired;
+   /* the number of children in aoNChildren */
+   size_t ulLength;
+   /* the published children, in order, ulLength of them */
+   Node_T aoNChildren[1];
+};
+
+/*
+  A node in a DT. A node stores only the final component of its
+  absolute path; the full path is implied by the chain of parents
+  and is only built (and then cached) when a client asks for it.
+  The node, its name (unless the name is interned), and its children
+  array (with room for NODE_INLINE_CHILDREN children) share a single
+  allocation. All of a
+  node's memory except its published children comes from its arena,
+  if it has one.
+*/
 struct node {
-   /* the object corresponding to the node's absolute path */
-   Path_T oPPath;
    /* this node's parent */
    Node_T oNParent;
-   /* the object containing links to this node's children */
+   /* the arena shared by every node in the tree, or NULL if the
+      node's memory comes from the heap */
+   Arena_T oAArena;
+   /* the object containing links to this node's children, which
+      lives in the same block of memory as the node; empty while the
+      children are held by oBChildren instead */
    DynArray_T oDChildren;
+   /* the B-tree containing links to this node's children in order,
+      or NULL if the node has too few children to need one */
+   BTree_T oBChildren;
+   /* the object corresponding to the node's absolute path, or NULL
+      if it has not been requested yet */
+   Path_T oPPath;
+   /* the hash index over this node's children, or NULL if the node
+      has no B-tree or the index could not be allocated */
+   struct childIndex *psIndex;
+   /* the children published to lock-free readers, or NULL if none
+      have been */
+   struct childTable *psTable;
+   /* the link by which the node is retired; sRetired.pvObject is
+      NULL until the node has been published */
+   struct EpochLink sRetired;
+   /* the final component of the node's absolute path: acName, or
+      the interned string if the node was made from an interned path */
+   const char *pcName;
+   /* the storage for the final component, if it is not interned,
+      which runs on past the end of the struct as far as it needs */
+   char acName[1];
 };
 
 
 /*
-  Links new child oNChild into oNParent's children array at index
-  ulIndex. Returns SUCCESS if the new child was added successfully,
-  or  MEMORY_ERROR if allocation fails adding oNChild to the array.
+  Compares the final component of oNFirst's path with a string
+  pcSecond representing a single path component. Because siblings
+  share every other component, this orders siblings exactly as
+  comparing their full paths would.
+  Returns <0, 0, or >0 if oNFirst is "less than", "equal to", or
+  "greater than" pcSecond, respectively.
+*/
+static int Node_compareComponent(const Node_T oNFirst,
+                                 const char *pcSecond) {
+   assert(oNFirst != NULL);
+   assert(pcSecond != NULL);
+
+   return strcmp(oNFirst->pcName, pcSecond);
+}
+
+/*
+  Returns TRUE if oNNode's name is pcName, and FALSE if not. If
+  bIsInterned, pcName is an interned string, so that if oNNode's name
+  is interned too, comparing pointers suffices.
+*/
+static boolean Node_hasName(Node_T oNNode, const char *pcName,
+                            boolean bIsInterned) {
+   assert(oNNode != NULL);
+   assert(pcName != NULL);
+
+   if(oNNode->pcName == pcName)
+      return TRUE;
+   if(bIsInterned && oNNode->pcName != oNNode->acName)
+      return FALSE;
+   return (boolean) !strcmp(oNNode->pcName, pcName);
+}
+
+/*
+  Returns a hash code for the path component pcName: the same one a
+  path holding it computed already (see Path_getComponentHash).
+*/
+static size_t Node_hashName(const char *pcName) {
+   assert(pcName != NULL);
+
+   return Path_hashComponent(pcName);
+}
+
+/*
+  Stores oNChild, whose name has hash code ulHash, in the first empty
+  slot of psIndex at or after its home slot. psIndex must have an
+  empty slot.
+*/
+static void Node_indexPut(struct childIndex *psIndex, Node_T oNChild,
+                          size_t ulHash) {
+   size_t ulSlot;
+
+   assert(psIndex != NULL);
+   assert(oNChild != NULL);
+
+   ulSlot = ulHash & (psIndex->ulSlots - 1);
+   while(psIndex->asSlots[ulSlot].oNChild != NULL)
+      ulSlot = (ulSlot + 1) & (psIndex->ulSlots - 1);
+   psIndex->asSlots[ulSlot].ulHash = ulHash;
+   psIndex->asSlots[ulSlot].oNChild = oNChild;
+}
+
+/*
+  Stores child pvChild in index pvIndex. Has the signature BTree_map
+  expects.
+*/
+static void Node_indexPutChild(void *pvChild, void *pvIndex) {
+   Node_T oNChild = pvChild;
+
+   Node_indexPut(pvIndex, oNChild, Node_hashName(oNChild->pcName));
+}
+
+/*
+  Returns the slot of psIndex holding the child named pcName, whose
+  hash code is ulHash, or psIndex->ulSlots if there is no such child.
+  bIsInterned is as for Node_hasName.
+*/
+static size_t Node_indexFind(struct childIndex *psIndex,
+                             const char *pcName, size_t ulHash,
+                             boolean bIsInterned) {
+   size_t ulSlot;
+   Node_T oNChild;
+
+   assert(psIndex != NULL);
+   assert(pcName != NULL);
+
+   ulSlot = ulHash & (psIndex->ulSlots - 1);
+   while((oNChild = psIndex->asSlots[ulSlot].oNChild) != NULL) {
+      if(psIndex->asSlots[ulSlot].ulHash == ulHash &&
+         Node_hasName(oNChild, pcName, bIsInterned))
+         return ulSlot;
+      ulSlot = (ulSlot + 1) & (psIndex->ulSlots - 1);
+   }
+   return psIndex->ulSlots;
+}
+
+/*
+  Removes oNChild from psIndex, shifting back any later children in
+  the same probe sequence so that no lookup stops early at the hole.
+*/
+static void Node_indexRemove(struct childIndex *psIndex,
+                             Node_T oNChild) {
+   size_t ulMask;
+   size_t ulHole;
+   size_t ulNext;
+   size_t ulHome;
+
+   assert(psIndex != NULL);
+   assert(oNChild != NULL);
+
+   ulMask = psIndex->ulSlots - 1;
+   ulHole = Node_indexFind(psIndex, oNChild->pcName,
+                           Node_hashName(oNChild->pcName), FALSE);
+   assert(ulHole < psIndex->ulSlots);
+
+   for(ulNext = (ulHole + 1) & ulMask;
+       psIndex->asSlots[ulNext].oNChild != NULL;
+       ulNext = (ulNext + 1) & ulMask) {
+      ulHome = psIndex->asSlots[ulNext].ulHash & ulMask;
+      /* a child may fill the hole only if its home slot is not
+         cyclically after the hole and up to its current slot */
+      if(ulHole <= ulNext ? (ulHome <= ulHole || ulHome > ulNext)
+                          : (ulHome <= ulHole && ulHome > ulNext)) {
+         psIndex->asSlots[ulHole] = psIndex->asSlots[ulNext];
+         ulHole = ulNext;
+      }
+   }
+   psIndex->asSlots[ulHole].oNChild = NULL;
+}
+
+/*
+  Returns a new block of ulSize bytes from oNNode's arena, or from the
+  heap if it has none, or NULL if there is an allocation error.
+*/
+static void *Node_alloc(Node_T oNNode, size_t ulSize) {
+   assert(oNNode != NULL);
+
+   if(oNNode->oAArena != NULL)
+      return Arena_alloc(oNNode->oAArena, ulSize);
+   return malloc(ulSize);
+}
+
+/*
+  Frees block pvBlock of ulSize bytes, which Node_alloc returned for
+  oNNode. pvBlock may be NULL.
+*/
+static void Node_releaseBlock(Node_T oNNode, void *pvBlock,
+                              size_t ulSize) {
+   assert(oNNode != NULL);
+
+   if(pvBlock == NULL)
+      return;
+   if(oNNode->oAArena != NULL)
+      Arena_release(oNNode->oAArena, pvBlock, ulSize);
+   else
+      free(pvBlock);
+}
+
+/* Returns the size of the memory block holding index psIndex. */
+static size_t Node_getIndexSize(const struct childIndex *psIndex) {
+   assert(psIndex != NULL);
+
+   return offsetof(struct childIndex, asSlots) +
+      psIndex->ulSlots * sizeof(struct childSlot);
+}
+
+/* Frees oNNode's index psIndex, which may be NULL. */
+static void Node_freeIndex(Node_T oNNode, struct childIndex *psIndex) {
+   if(psIndex != NULL)
+      Node_releaseBlock(oNNode, psIndex, Node_getIndexSize(psIndex));
+}
+
+/*
+  Returns a new index over all of the children in oNParent's B-tree,
+  with enough slots to stay at most half full after ulExtra more
+  children are added. Returns NULL if there is an allocation error.
+*/
+static struct childIndex *Node_newIndex(Node_T oNParent,
+                                        size_t ulExtra) {
+   struct childIndex *psIndex;
+   size_t ulLength;
+   size_t ulSlots = 4 * NODE_LARGE_THRESHOLD;
+
+   assert(oNParent != NULL);
+   assert(oNParent->oBChildren != NULL);
+
+   ulLength = BTree_getLength(oNParent->oBChildren) + ulExtra;
+   while(ulSlots <= 2 * ulLength)
+      ulSlots *= 2;
+
+   psIndex = Node_alloc(oNParent,
+                        offsetof(struct childIndex, asSlots) +
+                        ulSlots * sizeof(struct childSlot));
+   if(psIndex == NULL)
+      return NULL;
+   psIndex->ulSlots = ulSlots;
+   memset(psIndex->asSlots, 0, ulSlots * sizeof(struct childSlot));
+
+   BTree_map(oNParent->oBChildren, Node_indexPutChild, psIndex);
+   return psIndex;
+}
+
+/*
+  Returns TRUE if psTable (which may be NULL, meaning empty) has a
+  child named pcName, and FALSE if not. Stores in *pulIndex the index
+  of that child, or the index it would have if inserted.
+*/
+static boolean Node_tableFind(const struct childTable *psTable,
+                              const char *pcName, size_t *pulIndex) {
+   size_t ulLow = 0;
+   size_t ulHigh;
+   size_t ulMid;
+   int iCompare;
+
+   assert(pcName != NULL);
+   assert(pulIndex != NULL);
+
+   ulHigh = psTable == NULL ? 0 : psTable->ulLength;
+   while(ulLow < ulHigh) {
+      ulMid = ulLow + (ulHigh - ulLow) / 2;
+      iCompare = strcmp(psTable->aoNChildren[ulMid]->pcName, pcName);
+      if(iCompare == 0) {
+         *pulIndex = ulMid;
+         return TRUE;
+      }
+      if(iCompare < 0)
+         ulLow = ulMid + 1;
+      else
+         ulHigh = ulMid;
+   }
+   *pulIndex = ulLow;
+   return FALSE;
+}
+
+/*
+  Replaces oNParent's published children with psTable, which may be
+  NULL. The old table is freed once no reader can still be using it,
+  or at once if oNParent itself was never published.
+*/
+static void Node_replaceTable(Node_T oNParent,
+                              struct childTable *psTable) {
+   struct childTable *psOld;
+
+   assert(oNParent != NULL);
+
+   psOld = oNParent->psTable;
+   __atomic_store_n(&oNParent->psTable, psTable, __ATOMIC_RELEASE);
+   if(psOld == NULL)
+      return;
+   if(oNParent->sRetired.pvObject != NULL)
+      Epoch_retire(psOld, &psOld->sRetired);
+   else
+      free(psOld);
+}
+
+/*
+  Returns the number of bytes of oNNode's allocation taken by its
+  name: none if the name is interned.
+*/
+static size_t Node_getNameSize(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   if(oNNode->pcName != oNNode->acName)
+      return 0;
+   return strlen(oNNode->acName) + 1;
+}
+
+/*
+  Returns the offset from the start of a node's allocation at which
+  its children array is stored, given the number of bytes its name
+  takes there: just past the name, rounded up to keep the array
+  aligned for a pointer.
+*/
+static size_t Node_getChildrenOffset(size_t ulNameSize) {
+   size_t ulOffset = offsetof(struct node, acName) + ulNameSize;
+
+   return (ulOffset + sizeof(void *) - 1) / sizeof(void *) *
+      sizeof(void *);
+}
+
+/* Resets oNNode's children array to an empty one in inline storage. */
+static void Node_resetChildren(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   DynArray_free(oNNode->oDChildren);
+   oNNode->oDChildren = DynArray_newInlineIn(oNNode->oAArena,
+      (char *) oNNode + Node_getChildrenOffset(Node_getNameSize(oNNode)),
+      NODE_INLINE_CHILDREN);
+}
+
+/*
+  Moves oNParent's children from its children array into a new
+  B-tree, and indexes them. Leaves them in the array if there is an
+  allocation error.
+*/
+static void Node_growChildren(Node_T oNParent) {
+   BTree_T oBChildren;
+   size_t ulLength;
+   size_t i;
+
+   assert(oNParent != NULL);
+   assert(oNParent->oBChildren == NULL);
+
+   oBChildren = BTree_newIn(oNParent->oAArena);
+   if(oBChildren == NULL)
+      return;
+   ulLength = DynArray_getLength(oNParent->oDChildren);
+   for(i = 0; i < ulLength; i++) {
+      if(!BTree_addAt(oBChildren, i,
+                      DynArray_get(oNParent->oDChildren, i))) {
+         BTree_free(oBChildren);
+         return;
+      }
+   }
+
+   oNParent->oBChildren = oBChildren;
+   oNParent->psIndex = Node_newIndex(oNParent, 0);
+   Node_resetChildren(oNParent);
+}
+
+/*
+  Moves oNParent's children from its B-tree back into its children
+  array, and drops the B-tree and index. Leaves them in the B-tree if
+  there is an allocation error.
+*/
+static void Node_shrinkChildren(Node_T oNParent) {
+   size_t ulLength;
+   size_t i;
+
+   assert(oNParent != NULL);
+   assert(oNParent->oBChildren != NULL);
+
+   ulLength = BTree_getLength(oNParent->oBChildren);
+   for(i = 0; i < ulLength; i++) {
+      if(!DynArray_add(oNParent->oDChildren,
+                       BTree_get(oNParent->oBChildren, i))) {
+         Node_resetChildren(oNParent);
+         return;
+      }
+   }
+
+   BTree_free(oNParent->oBChildren);
+   oNParent->oBChildren = NULL;
+   Node_freeIndex(oNParent, oNParent->psIndex);
+   oNParent->psIndex = NULL;
+}
+
+/*
+  Links new child oNChild into oNParent's children, which must not
+  already include a child with oNChild's name. Returns SUCCESS if the
+  new child was added successfully, or MEMORY_ERROR if allocation
+  fails adding oNChild to the children array or B-tree.
 */
-static int Node_addChild(Node_T oNParent, Node_T oNChild,
-                         size_t ulIndex) {
+static int Node_addChild(Node_T oNParent, Node_T oNChild) {
+   struct childIndex *psIndex;
+   size_t ulIndex;
+
    assert(oNParent != NULL);
    assert(oNChild != NULL);
 
-   if(DynArray_addAt(oNParent->oDChildren, ulIndex, oNChild))
+   if(oNParent->oBChildren == NULL) {
+      (void) DynArray_bsearch(oNParent->oDChildren,
+               (char*) oNChild->pcName, &ulIndex,
+               (int (*)(const void*,const void*)) Node_compareComponent);
+      if(!DynArray_addAt(oNParent->oDChildren, ulIndex, oNChild))
+         return MEMORY_ERROR;
+
+      /* switch to a B-tree once there are many children (if this
+         fails, it is simply tried again with the next child) */
+      if(DynArray_getLength(oNParent->oDChildren) >=
+         NODE_LARGE_THRESHOLD)
+         Node_growChildren(oNParent);
       return SUCCESS;
-   else
+   }
+
+   /* keep the index at most half full; lookups still work without
+      it, by searching the B-tree, so if it cannot grow, drop it (it
+      is rebuilt with the next child) */
+   psIndex = oNParent->psIndex;
+   if(psIndex == NULL || 2 * (BTree_getLength(oNParent->oBChildren) + 1)
+      >= psIndex->ulSlots) {
+      oNParent->psIndex = Node_newIndex(oNParent, 1);
+      Node_freeIndex(oNParent, psIndex);
+   }
+
+   (void) BTree_bsearch(oNParent->oBChildren,
+            (char*) oNChild->pcName, &ulIndex,
+            (int (*)(const void*,const void*)) Node_compareComponent);
+   if(!BTree_addAt(oNParent->oBChildren, ulIndex, oNChild))
       return MEMORY_ERROR;
+   if(oNParent->psIndex != NULL)
+      Node_indexPut(oNParent->psIndex, oNChild,
+                    Node_hashName(oNChild->pcName));
+   return SUCCESS;
+}
+
+/* Unlinks oNChild from the children of its parent oNParent. */
+static void Node_removeChild(Node_T oNParent, Node_T oNChild) {
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+
+   if(oNParent->oBChildren == NULL) {
+      if(DynArray_bsearch(oNParent->oDChildren,
+               (char*) oNChild->pcName, &ulIndex,
+               (int (*)(const void *, const void *)) Node_compareComponent))
+         (void) DynArray_removeAt(oNParent->oDChildren, ulIndex);
+      return;
+   }
+
+   if(oNParent->psIndex != NULL)
+      Node_indexRemove(oNParent->psIndex, oNChild);
+   if(BTree_bsearch(oNParent->oBChildren,
+            (char*) oNChild->pcName, &ulIndex,
+            (int (*)(const void *, const void *)) Node_compareComponent))
+      (void) BTree_removeAt(oNParent->oBChildren, ulIndex);
+
+   if(BTree_getLength(oNParent->oBChildren) < NODE_LARGE_THRESHOLD / 2)
+      Node_shrinkChildren(oNParent);
 }
 
 /*
-  Compares the string representation of oNfirst with a string
-  pcSecond representing a node's path.
-  Returns <0, 0, or >0 if oNFirst is "less than", "equal to", or
-  "greater than" pcSecond, respectively.
+  Appends child pvChild to children array pvDChildren, which must
+  already have room for it. Has the signature BTree_map expects.
 */
-static int Node_compareString(const Node_T oNFirst,
-                                 const char *pcSecond) {
-   assert(oNFirst != NULL);
-   assert(pcSecond != NULL);
+static void Node_appendChild(void *pvChild, void *pvDChildren) {
+   int iSuccessful;
 
-   return Path_compareString(oNFirst->oPPath, pcSecond);
+   iSuccessful = DynArray_add(pvDChildren, pvChild);
+   assert(iSuccessful);
+   (void) iSuccessful;
+}
+
+/*
+  Removes and returns the last of oNParent's children, which must have
+  at least one. Only for tearing down oNParent: this is cheap because
+  the first pop from a B-tree moves all of its children into the
+  children array in one pass, so that no pop costs a B-tree removal.
+  If the array has no room for them, pops come from the B-tree and
+  leave oNParent's index stale.
+*/
+static Node_T Node_popChild(Node_T oNParent) {
+   assert(oNParent != NULL);
+
+   if(oNParent->oBChildren != NULL &&
+      DynArray_reserve(oNParent->oDChildren,
+                       BTree_getLength(oNParent->oBChildren))) {
+      BTree_map(oNParent->oBChildren, Node_appendChild,
+                oNParent->oDChildren);
+      BTree_free(oNParent->oBChildren);
+      oNParent->oBChildren = NULL;
+      Node_freeIndex(oNParent, oNParent->psIndex);
+      oNParent->psIndex = NULL;
+   }
+
+   if(oNParent->oBChildren != NULL)
+      return BTree_removeAt(oNParent->oBChildren,
+                            BTree_getLength(oNParent->oBChildren) - 1);
+   return DynArray_removeAt(oNParent->oDChildren,
+                            DynArray_getLength(oNParent->oDChildren) - 1);
+}
+
+/*
+  Frees the memory of oNNode itself, which must already have no
+  children left.
+*/
+static void Node_release(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   /* releases only the children array's overflow, if any */
+   DynArray_free(oNNode->oDChildren);
+   if(oNNode->oBChildren != NULL)
+      BTree_free(oNNode->oBChildren);
+   Node_freeIndex(oNNode, oNNode->psIndex);
+
+   /* remove cached path, if it was ever built */
+   Path_free(oNNode->oPPath);
+
+   /* finally, free the struct node, along with its published children
+      once no lock-free reader can still be looking at them */
+   if(oNNode->sRetired.pvObject == NULL) {
+      free(oNNode->psTable);
+      Node_releaseBlock(oNNode, oNNode,
+                        Node_getChildrenOffset(Node_getNameSize(oNNode)) +
+                        DynArray_sizeInline(NODE_INLINE_CHILDREN));
+      return;
+   }
+   if(oNNode->psTable != NULL)
+      Epoch_retire(oNNode->psTable, &oNNode->psTable->sRetired);
+   Epoch_retire(oNNode, &oNNode->sRetired);
+}
+
+/* Returns the number of components in oNNode's absolute path. */
+static size_t Node_getDepth(Node_T oNNode) {
+   size_t ulDepth = 0;
+
+   assert(oNNode != NULL);
+
+   while(oNNode != NULL) {
+      ulDepth++;
+      oNNode = oNNode->oNParent;
+   }
+   return ulDepth;
+}
+
+/*
+  Returns the length, in components, of the longest prefix shared by
+  oNNode's absolute path and the first ulPathDepth components of
+  oPPath, where ulDepth is oNNode's depth. Equivalent to
+  Path_getSharedPrefixDepth, without building either path.
+*/
+static size_t Node_getSharedPrefixDepth(Node_T oNNode, size_t ulDepth,
+                                        Path_T oPPath,
+                                        size_t ulPathDepth) {
+   size_t ulShared;
+   boolean bIsInterned;
+
+   assert(oNNode != NULL);
+   assert(oPPath != NULL);
+   assert(ulPathDepth <= Path_getDepth(oPPath));
+
+   bIsInterned = Path_isInterned(oPPath);
+
+   /* only levels that both paths have can be shared */
+   ulShared = ulPathDepth;
+   while(ulDepth > ulShared) {
+      oNNode = oNNode->oNParent;
+      ulDepth--;
+   }
+   ulShared = ulDepth;
+
+   /* walk up, remembering the shallowest level that differs */
+   while(oNNode != NULL) {
+      ulDepth--;
+      if(!Node_hasName(oNNode, Path_getComponent(oPPath, ulDepth),
+                       bIsInterned))
+         ulShared = ulDepth;
+      oNNode = oNNode->oNParent;
+   }
+   return ulShared;
+}
+
+/*
+  Returns the length (not including trailing '\0') of the string
+  representation of oNNode's absolute path, computed from the names
+  of oNNode and its ancestors.
+*/
+static size_t Node_getStrLength(Node_T oNNode) {
+   size_t ulLength;
+
+   assert(oNNode != NULL);
+
+   ulLength = strlen(oNNode->pcName);
+   for(oNNode = oNNode->oNParent; oNNode != NULL;
+       oNNode = oNNode->oNParent)
+      ulLength += strlen(oNNode->pcName) + 1;
+   return ulLength;
+}
+
+/*
+  Writes the string representation of oNNode's absolute path, which
+  must be ulLength characters long, into pcBuffer (followed by '\0').
+  pcBuffer must have room for at least ulLength+1 characters.
+*/
+static void Node_buildPathname(Node_T oNNode, size_t ulLength,
+                               char *pcBuffer) {
+   size_t ulNameLength;
+
+   assert(oNNode != NULL);
+   assert(pcBuffer != NULL);
+
+   pcBuffer[ulLength] = '\0';
+   /* fill from the end, one ancestor at a time */
+   for(;;) {
+      ulNameLength = strlen(oNNode->pcName);
+      ulLength -= ulNameLength;
+      memcpy(pcBuffer + ulLength, oNNode->pcName, ulNameLength);
+      oNNode = oNNode->oNParent;
+      if(oNNode == NULL)
+         break;
+      ulLength--;
+      pcBuffer[ulLength] = '/';
+   }
+   assert(ulLength == 0);
 }
 
 
@@ -64,60 +710,119 @@ static int Node_compareString(const Node_T oNFirst,
   * ALREADY_IN_TREE if oNParent already has a child with this path
 */
 int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult) {
+   return Node_newIn(oNParent == NULL ? NULL : oNParent->oAArena,
+                     oPPath, Path_getDepth(oPPath), oNParent, poNResult);
+}
+
+/*
+  Creates a node named pcName below oNParent (or a root, if oNParent
+  is NULL), taking its memory from oAArena, or from the heap if
+  oAArena is NULL. The node shares pcName if bIsInterned, and copies
+  it otherwise. The caller has checked everything else Node_newIn
+  checks. Returns SUCCESS and sets *poNResult to the node, or sets
+  *poNResult to NULL and returns MEMORY_ERROR.
+*/
+static int Node_build(Arena_T oAArena, const char *pcName,
+                      boolean bIsInterned, Node_T oNParent,
+                      Node_T *poNResult) {
    struct node *psNew;
-   Path_T oPParentPath = NULL;
-   Path_T oPNewPath = NULL;
-   size_t ulParentDepth;
-   size_t ulIndex;
+   size_t ulNameSize;
+   size_t ulChildrenOffset;
    int iStatus;
 
-   assert(oPPath != NULL);
-   assert(oNParent == NULL || CheckerDT_Node_isValid(oNParent));
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
 
-   /* allocate space for a new node */
-   psNew = malloc(sizeof(struct node));
+   /* allocate space for a new node, along with its name (unless it
+      is interned, and so shared rather than copied) and children
+      array */
+   ulNameSize = bIsInterned ? 0 : strlen(pcName) + 1;
+   ulChildrenOffset = Node_getChildrenOffset(ulNameSize);
+   psNew = oAArena != NULL ?
+      Arena_alloc(oAArena, ulChildrenOffset +
+                  DynArray_sizeInline(NODE_INLINE_CHILDREN)) :
+      malloc(ulChildrenOffset +
+             DynArray_sizeInline(NODE_INLINE_CHILDREN));
    if(psNew == NULL) {
       *poNResult = NULL;
       return MEMORY_ERROR;
    }
+   psNew->oAArena = oAArena;
+   if(ulNameSize != 0) {
+      memcpy(psNew->acName, pcName, ulNameSize);
+      psNew->pcName = psNew->acName;
+   }
+   else
+      psNew->pcName = pcName;
+   psNew->oPPath = NULL;
+   psNew->oBChildren = NULL;
+   psNew->psIndex = NULL;
+   psNew->psTable = NULL;
+   psNew->sRetired.pvObject = NULL;
+   psNew->oNParent = oNParent;
+
+   /* initialize the new node */
+   psNew->oDChildren = DynArray_newInlineIn(oAArena,
+      (char *) psNew + ulChildrenOffset, NODE_INLINE_CHILDREN);
+
+   /* Link into parent's children list */
+   if(oNParent != NULL) {
+      iStatus = Node_addChild(oNParent, psNew);
+      if(iStatus != SUCCESS) {
+         DynArray_free(psNew->oDChildren);
+         Node_releaseBlock(psNew, psNew, ulChildrenOffset +
+                           DynArray_sizeInline(NODE_INLINE_CHILDREN));
+         *poNResult = NULL;
+         return iStatus;
+      }
+   }
+
+   *poNResult = psNew;
+
+   assert(oNParent == NULL || CheckerDT_Node_isValid(oNParent));
+   assert(CheckerDT_Node_isValid(*poNResult));
+
+   return SUCCESS;
+}
+
 
-   /* set the new node's path */
-   iStatus = Path_dup(oPPath, &oPNewPath);
-   if(iStatus != SUCCESS) {
-      free(psNew);
+int Node_newIn(Arena_T oAArena, Path_T oPPath, size_t ulDepth,
+               Node_T oNParent, Node_T *poNResult) {
+   Node_T oNSibling;
+
+   assert(oPPath != NULL);
+   assert(oNParent == NULL || CheckerDT_Node_isValid(oNParent));
+   assert(oNParent == NULL || oNParent->oAArena == oAArena);
+
+   if(ulDepth == 0 || ulDepth > Path_getDepth(oPPath)) {
       *poNResult = NULL;
-      return iStatus;
+      return NO_SUCH_PATH;
    }
-   psNew->oPPath = oPNewPath;
 
-   /* validate and set the new node's parent */
+   /* validate the new node's parent */
    if(oNParent != NULL) {
+      size_t ulParentDepth;
       size_t ulSharedDepth;
 
-      oPParentPath = oNParent->oPPath;
-      ulParentDepth = Path_getDepth(oPParentPath);
-      ulSharedDepth = Path_getSharedPrefixDepth(psNew->oPPath,
-                                                oPParentPath);
+      ulParentDepth = Node_getDepth(oNParent);
+      ulSharedDepth = Node_getSharedPrefixDepth(oNParent,
+                                                ulParentDepth, oPPath,
+                                                ulDepth);
       /* parent must be an ancestor of child */
       if(ulSharedDepth < ulParentDepth) {
-         Path_free(psNew->oPPath);
-         free(psNew);
          *poNResult = NULL;
          return CONFLICTING_PATH;
       }
 
       /* parent must be exactly one level up from child */
-      if(Path_getDepth(psNew->oPPath) != ulParentDepth + 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      if(ulDepth != ulParentDepth + 1) {
          *poNResult = NULL;
          return NO_SUCH_PATH;
       }
 
       /* parent must not already have child with this path */
-      if(Node_hasChild(oNParent, oPPath, &ulIndex)) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      if(Node_getChildByComponent(oNParent, oPPath, ulDepth - 1,
+                                  &oNSibling) == SUCCESS) {
          *poNResult = NULL;
          return ALREADY_IN_TREE;
       }
@@ -125,80 +830,254 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult) {
    else {
       /* new node must be root */
       /* can only create one "level" at a time */
-      if(Path_getDepth(psNew->oPPath) != 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      if(ulDepth != 1) {
          *poNResult = NULL;
          return NO_SUCH_PATH;
       }
    }
-   psNew->oNParent = oNParent;
 
-   /* initialize the new node */
-   psNew->oDChildren = DynArray_new(0);
-   if(psNew->oDChildren == NULL) {
-      Path_free(psNew->oPPath);
-      free(psNew);
-      *poNResult = NULL;
-      return MEMORY_ERROR;
-   }
+   return Node_build(oAArena, Path_getComponent(oPPath, ulDepth - 1),
+                     Path_isInterned(oPPath), oNParent, poNResult);
+}
 
-   /* Link into parent's children list */
-   if(oNParent != NULL) {
-      iStatus = Node_addChild(oNParent, psNew, ulIndex);
-      if(iStatus != SUCCESS) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return iStatus;
+int Node_newChild(Node_T oNParent, const char *pcName,
+                  size_t ulLength, boolean bIsInterned,
+                  Node_T *poNResult) {
+   char acName[NODE_SHORT_NAME];
+   char *pcCopy = acName;
+   Node_T oNSibling;
+   int iStatus;
+
+   assert(CheckerDT_Node_isValid(oNParent));
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
+
+   *poNResult = NULL;
+   if(ulLength == 0 || memchr(pcName, '/', ulLength) != NULL ||
+      memchr(pcName, '\0', ulLength) != NULL)
+      return BAD_PATH;
+
+   if(bIsInterned) {
+      pcName = Intern_string(pcName, ulLength);
+      if(pcName == NULL)
+         return MEMORY_ERROR;
+   }
+   else {
+      /* Node_build wants the name '\0'-terminated, so terminate a
+         copy, on the stack unless the name is unusually long */
+      if(ulLength >= NODE_SHORT_NAME) {
+         pcCopy = malloc(ulLength + 1);
+         if(pcCopy == NULL)
+            return MEMORY_ERROR;
       }
+      memcpy(pcCopy, pcName, ulLength);
+      pcCopy[ulLength] = '\0';
+      pcName = pcCopy;
    }
 
-   *poNResult = psNew;
+   if(Node_getChildByName(oNParent, pcName, &oNSibling) == SUCCESS)
+      iStatus = ALREADY_IN_TREE;
+   else
+      iStatus = Node_build(oNParent->oAArena, pcName, bIsInterned,
+                           oNParent, poNResult);
+   if(pcCopy != acName)
+      free(pcCopy);
+   return iStatus;
+}
 
-   assert(oNParent == NULL || CheckerDT_Node_isValid(oNParent));
-   assert(CheckerDT_Node_isValid(*poNResult));
+int Node_reserveChildren(Node_T oNParent, size_t ulCount) {
+   struct childIndex *psIndex;
+   size_t ulLength;
+
+   assert(CheckerDT_Node_isValid(oNParent));
 
+   if(oNParent->oBChildren == NULL) {
+      ulLength = DynArray_getLength(oNParent->oDChildren) + ulCount;
+      if(ulLength < NODE_LARGE_THRESHOLD) {
+         if(!DynArray_reserve(oNParent->oDChildren, ulLength))
+            return MEMORY_ERROR;
+         return SUCCESS;
+      }
+
+      /* that many children belong in a B-tree, so move there now
+         rather than filling the array first */
+      Node_growChildren(oNParent);
+      if(oNParent->oBChildren == NULL)
+         return MEMORY_ERROR;
+   }
+
+   /* a B-tree grows a node at a time anyway, but its index can be
+      sized for every child up front */
+   psIndex = Node_newIndex(oNParent, ulCount);
+   if(psIndex == NULL)
+      return MEMORY_ERROR;
+   Node_freeIndex(oNParent, oNParent->psIndex);
+   oNParent->psIndex = psIndex;
    return SUCCESS;
 }
 
 size_t Node_free(Node_T oNNode) {
-   size_t ulIndex;
+   return Node_freeWith(oNNode, NULL, NULL);
+}
+
+size_t Node_freeWith(Node_T oNNode,
+                     void (*pfBefore)(Node_T oNNode, void *pvExtra),
+                     void *pvExtra) {
+   Node_T oNTop;
+   Node_T oNParent;
    size_t ulCount = 0;
 
    assert(oNNode != NULL);
    assert(CheckerDT_Node_isValid(oNNode));
 
    /* remove from parent's list */
-   if(oNNode->oNParent != NULL) {
-      if(DynArray_bsearch(
-            oNNode->oNParent->oDChildren,
-            oNNode, &ulIndex,
-            (int (*)(const void *, const void *)) Node_compare)
-        )
-         (void) DynArray_removeAt(oNNode->oNParent->oDChildren,
-                                  ulIndex);
+   if(oNNode->oNParent != NULL)
+      Node_removeChild(oNNode->oNParent, oNNode);
+
+   /* free the subtree in postorder without recursion: pop last
+      children down to a childless node, free it, then carry on from
+      its parent, which it was already popped from */
+   oNTop = oNNode;
+   for(;;) {
+      while(Node_getNumChildren(oNNode) != 0)
+         oNNode = Node_popChild(oNNode);
+
+      oNParent = oNNode->oNParent;
+      if(pfBefore != NULL)
+         (*pfBefore)(oNNode, pvExtra);
+      Node_release(oNNode);
+      ulCount++;
+      if(oNNode == oNTop)
+         break;
+      oNNode = oNParent;
    }
+   return ulCount;
+}
+
+int Node_publish(Node_T oNNode) {
+   Node_T oNParent;
+   struct childTable *psOld;
+   struct childTable *psNew;
+   size_t ulLength;
+   size_t ulIndex;
+
+   assert(oNNode != NULL);
+   assert(oNNode->sRetired.pvObject == NULL);
+   /* reclamation frees published nodes with free */
+   assert(oNNode->oAArena == NULL);
 
-   /* recursively remove children */
-   while(DynArray_getLength(oNNode->oDChildren) != 0) {
-      ulCount += Node_free(DynArray_get(oNNode->oDChildren, 0));
+   oNParent = oNNode->oNParent;
+   if(oNParent != NULL) {
+      psOld = oNParent->psTable;
+      ulLength = psOld == NULL ? 0 : psOld->ulLength;
+      psNew = malloc(offsetof(struct childTable, aoNChildren) +
+                     (ulLength + 1) * sizeof(Node_T));
+      if(psNew == NULL)
+         return MEMORY_ERROR;
+
+      /* copy the old table with oNNode in its place */
+      (void) Node_tableFind(psOld, oNNode->pcName, &ulIndex);
+      psNew->ulLength = ulLength + 1;
+      if(ulIndex != 0)
+         memcpy(psNew->aoNChildren, psOld->aoNChildren,
+                ulIndex * sizeof(Node_T));
+      psNew->aoNChildren[ulIndex] = oNNode;
+      if(ulIndex != ulLength)
+         memcpy(psNew->aoNChildren + ulIndex + 1,
+                psOld->aoNChildren + ulIndex,
+                (ulLength - ulIndex) * sizeof(Node_T));
+      Node_replaceTable(oNParent, psNew);
    }
-   DynArray_free(oNNode->oDChildren);
 
-   /* remove path */
-   Path_free(oNNode->oPPath);
+   oNNode->sRetired.pvObject = oNNode;
+   return SUCCESS;
+}
 
-   /* finally, free the struct node */
-   free(oNNode);
-   ulCount++;
-   return ulCount;
+int Node_unpublish(Node_T oNNode) {
+   Node_T oNParent;
+   struct childTable *psOld;
+   struct childTable *psNew = NULL;
+   size_t ulIndex;
+
+   assert(oNNode != NULL);
+   assert(oNNode->sRetired.pvObject != NULL);
+
+   oNParent = oNNode->oNParent;
+   if(oNParent == NULL)
+      return SUCCESS;
+
+   psOld = oNParent->psTable;
+   if(!Node_tableFind(psOld, oNNode->pcName, &ulIndex))
+      return SUCCESS;
+
+   /* copy the old table without oNNode */
+   if(psOld->ulLength > 1) {
+      psNew = malloc(offsetof(struct childTable, aoNChildren) +
+                     (psOld->ulLength - 1) * sizeof(Node_T));
+      if(psNew == NULL)
+         return MEMORY_ERROR;
+      psNew->ulLength = psOld->ulLength - 1;
+      memcpy(psNew->aoNChildren, psOld->aoNChildren,
+             ulIndex * sizeof(Node_T));
+      memcpy(psNew->aoNChildren + ulIndex,
+             psOld->aoNChildren + ulIndex + 1,
+             (psNew->ulLength - ulIndex) * sizeof(Node_T));
+   }
+   Node_replaceTable(oNParent, psNew);
+   return SUCCESS;
+}
+
+Node_T Node_getPublishedChild(Node_T oNParent, const char *pcName) {
+   struct childTable *psTable;
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+
+   psTable = __atomic_load_n(&oNParent->psTable, __ATOMIC_ACQUIRE);
+   if(!Node_tableFind(psTable, pcName, &ulIndex))
+      return NULL;
+   return psTable->aoNChildren[ulIndex];
 }
 
 Path_T Node_getPath(Node_T oNNode) {
+   size_t ulLength;
+   char *pcPathname;
+   Path_T oPPath;
+   Path_T oPCached = NULL;
+
    assert(oNNode != NULL);
 
-   return oNNode->oPPath;
+   oPPath = __atomic_load_n(&oNNode->oPPath, __ATOMIC_ACQUIRE);
+   if(oPPath != NULL)
+      return oPPath;
+
+   /* build the path from the names of the ancestors and cache it */
+   ulLength = Node_getStrLength(oNNode);
+   pcPathname = malloc(ulLength + 1);
+   if(pcPathname == NULL)
+      return NULL;
+   Node_buildPathname(oNNode, ulLength, pcPathname);
+   (void) Path_newIn(oNNode->oAArena, pcPathname, &oPPath);
+   free(pcPathname);
+   if(oPPath == NULL)
+      return NULL;
+
+   /* writers in different subtrees may share an ancestor and build
+      its path at the same time; the first to finish caches it */
+   if(!__atomic_compare_exchange_n(&oNNode->oPPath, &oPCached, oPPath,
+                                   FALSE, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+      Path_free(oPPath);
+      oPPath = oPCached;
+   }
+   return oPPath;
+}
+
+const char *Node_getName(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->pcName;
 }
 
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
@@ -207,15 +1086,33 @@ boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
    assert(oPPath != NULL);
    assert(pulChildID != NULL);
 
-   /* *pulChildID is the index into oNParent->oDChildren */
+   /* siblings differ only in their final components */
+   return Node_hasChildComponent(oNParent,
+            Path_getComponent(oPPath, Path_getDepth(oPPath) - 1),
+            pulChildID);
+}
+
+boolean Node_hasChildComponent(Node_T oNParent, const char *pcName,
+                               size_t *pulChildID) {
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+   assert(pulChildID != NULL);
+
+   /* *pulChildID is the index into oNParent's children */
+   if(oNParent->oBChildren != NULL)
+      return BTree_bsearch(oNParent->oBChildren,
+               (char*) pcName, pulChildID,
+               (int (*)(const void*,const void*)) Node_compareComponent);
    return DynArray_bsearch(oNParent->oDChildren,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) Node_compareString);
+            (char*) pcName, pulChildID,
+            (int (*)(const void*,const void*)) Node_compareComponent);
 }
 
 size_t Node_getNumChildren(Node_T oNParent) {
    assert(oNParent != NULL);
 
+   if(oNParent->oBChildren != NULL)
+      return BTree_getLength(oNParent->oBChildren);
    return DynArray_getLength(oNParent->oDChildren);
 }
 
@@ -225,15 +1122,75 @@ int  Node_getChild(Node_T oNParent, size_t ulChildID,
    assert(oNParent != NULL);
    assert(poNResult != NULL);
 
-   /* ulChildID is the index into oNParent->oDChildren */
+   /* ulChildID is the index into oNParent's children */
    if(ulChildID >= Node_getNumChildren(oNParent)) {
       *poNResult = NULL;
       return NO_SUCH_PATH;
    }
    else {
-      *poNResult = DynArray_get(oNParent->oDChildren, ulChildID);
+      if(oNParent->oBChildren != NULL)
+         *poNResult = BTree_get(oNParent->oBChildren, ulChildID);
+      else
+         *poNResult = DynArray_get(oNParent->oDChildren, ulChildID);
+      return SUCCESS;
+   }
+}
+
+/*
+  Does the work of Node_getChildByName for the child named pcName,
+  whose hash code is ulHash. bIsInterned is as for Node_hasName.
+*/
+static int Node_findChild(Node_T oNParent, const char *pcName,
+                          size_t ulHash, boolean bIsInterned,
+                          Node_T *poNResult) {
+   size_t ulSlot;
+   size_t ulChildID;
+
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
+
+   /* an index answers without searching the children */
+   if(oNParent->psIndex != NULL) {
+      ulSlot = Node_indexFind(oNParent->psIndex, pcName, ulHash,
+                              bIsInterned);
+      if(ulSlot == oNParent->psIndex->ulSlots) {
+         *poNResult = NULL;
+         return NO_SUCH_PATH;
+      }
+      *poNResult = oNParent->psIndex->asSlots[ulSlot].oNChild;
       return SUCCESS;
    }
+
+   if(!Node_hasChildComponent(oNParent, pcName, &ulChildID)) {
+      *poNResult = NULL;
+      return NO_SUCH_PATH;
+   }
+   return Node_getChild(oNParent, ulChildID, poNResult);
+}
+
+int Node_getChildByName(Node_T oNParent, const char *pcName,
+                        Node_T *poNResult) {
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
+
+   /* only an index needs the hash */
+   return Node_findChild(oNParent, pcName,
+                         oNParent->psIndex == NULL ? 0 :
+                         Node_hashName(pcName), FALSE, poNResult);
+}
+
+int Node_getChildByComponent(Node_T oNParent, Path_T oPPath,
+                             size_t ulLevel, Node_T *poNResult) {
+   assert(oNParent != NULL);
+   assert(oPPath != NULL);
+   assert(ulLevel < Path_getDepth(oPPath));
+   assert(poNResult != NULL);
+
+   return Node_findChild(oNParent, Path_getComponent(oPPath, ulLevel),
+                         Path_getComponentHash(oPPath, ulLevel),
+                         Path_isInterned(oPPath), poNResult);
 }
 
 Node_T Node_getParent(Node_T oNNode) {
@@ -243,20 +1200,66 @@ Node_T Node_getParent(Node_T oNNode) {
 }
 
 int Node_compare(Node_T oNFirst, Node_T oNSecond) {
+   Node_T oNA;
+   Node_T oNB;
+   size_t ulDepthA;
+   size_t ulDepthB;
+   const char *pcA;
+   const char *pcB;
+   int iA;
+   int iB;
+
    assert(oNFirst != NULL);
    assert(oNSecond != NULL);
 
-   return Path_comparePath(oNFirst->oPPath, oNSecond->oPPath);
+   /* siblings share every component but their names */
+   if(oNFirst->oNParent == oNSecond->oNParent)
+      return strcmp(oNFirst->pcName, oNSecond->pcName);
+
+   /* bring both to the same depth; if they meet there, one is an
+      ancestor of the other, and its pathname is a prefix */
+   oNA = oNFirst;
+   oNB = oNSecond;
+   ulDepthA = Node_getDepth(oNA);
+   ulDepthB = Node_getDepth(oNB);
+   for(; ulDepthA > ulDepthB; ulDepthA--)
+      oNA = oNA->oNParent;
+   for(; ulDepthB > ulDepthA; ulDepthB--)
+      oNB = oNB->oNParent;
+   if(oNA == oNB)
+      return oNA == oNFirst ? (oNB == oNSecond ? 0 : -1) : 1;
+
+   /* climb to the children of the common ancestor, where the
+      pathnames first differ */
+   while(oNA->oNParent != oNB->oNParent) {
+      oNA = oNA->oNParent;
+      oNB = oNB->oNParent;
+   }
+
+   /* compare as strcmp would the full pathnames: past the end of a
+      name comes '/' if the path goes on below it, or '\0' if not */
+   for(pcA = oNA->pcName, pcB = oNB->pcName;
+       *pcA != '\0' && *pcA == *pcB; pcA++, pcB++)
+      ;
+   iA = (unsigned char) *pcA;
+   iB = (unsigned char) *pcB;
+   if(iA == '\0' && oNA != oNFirst)
+      iA = '/';
+   if(iB == '\0' && oNB != oNSecond)
+      iB = '/';
+   return iA - iB;
 }
 
 char *Node_toString(Node_T oNNode) {
    char *copyPath;
+   size_t ulLength;
 
    assert(oNNode != NULL);
 
-   copyPath = malloc(Path_getStrLength(Node_getPath(oNNode))+1);
+   ulLength = Node_getStrLength(oNNode);
+   copyPath = malloc(ulLength+1);
    if(copyPath == NULL)
       return NULL;
-   else
-      return strcpy(copyPath, Path_getPathname(Node_getPath(oNNode)));
+   Node_buildPathname(oNNode, ulLength, copyPath);
+   return copyPath;
 }
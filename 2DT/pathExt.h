@@ -0,0 +1 @@
+../0shared/pathExt.h
\ No newline at end of file
@@ -0,0 +1,233 @@
+/*--------------------------------------------------------------------*/
+/* path_scan.c                                                        */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "path.h"
+#include "pathExt.h"
+
+/*
+  Path_checkSpan scans a pathname 32 characters at a time with AVX2
+  if the processor has it, 16 at a time with SSE2 otherwise, and a
+  byte at a time if path.c was built with PATH_NO_SIMD (as it is for
+  path_scan_nosimd) or off x86. These tests compare whichever of them
+  this build and processor use with a plain reference scan.
+*/
+
+/* The lengths of pathname the boundary tests try: each side of one,
+   two, and three SSE2 blocks, and of one and two AVX2 blocks */
+static const size_t aulScanLengths[] = {
+   1, 2, 3, 15, 16, 17, 31, 32, 33, 47, 48, 49, 63, 64, 65
+};
+
+/* The longest pathname a test scans, and how far into its buffer a
+   randomized test may start one, so that loads vary in alignment */
+enum { SCAN_MAX_LENGTH = 100, SCAN_MAX_OFFSET = 40 };
+
+/* The number of pathnames the randomized test scans */
+enum { SCAN_RANDOM_TRIALS = 300000 };
+
+/*
+  Returns the number of elements of array a, which must be an array
+  and not a pointer.
+*/
+#define SCAN_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/*--------------------------------------------------------------------*/
+
+/* Reports that pcTest failed because pcWhy, and returns 1. */
+static size_t Scan_fail(const char *pcTest, const char *pcWhy) {
+   fprintf(stderr, "%s: %s\n", pcTest, pcWhy);
+   return 1;
+}
+
+/*
+  Checks the ulLength characters at pcChars a byte at a time by the
+  rules Path_checkSpan documents. Returns SUCCESS and sets *pulDepth
+  to their number of components if they are a well-formed path, and
+  returns BAD_PATH otherwise.
+*/
+static int Scan_reference(const char *pcChars, size_t ulLength,
+                          size_t *pulDepth) {
+   size_t ulDepth = 1;
+   size_t i;
+
+   if(ulLength == 0 || pcChars[0] == '/' ||
+      pcChars[ulLength - 1] == '/')
+      return BAD_PATH;
+   for(i = 0; i < ulLength; i++) {
+      if(pcChars[i] == '\0')
+         return BAD_PATH;
+      if(pcChars[i] == '/') {
+         if(pcChars[i + 1] == '/')
+            return BAD_PATH;
+         ulDepth++;
+      }
+   }
+   *pulDepth = ulDepth;
+   return SUCCESS;
+}
+
+/*
+  Checks that Path_checkSpan and Scan_reference agree on the ulLength
+  characters at pcChars, and, if those have no '\0' in them and are
+  followed by one, that Path_new agrees with both. Returns the number
+  of failed checks.
+*/
+static size_t Scan_check(const char *pcChars, size_t ulLength,
+                         const char *pcTest) {
+   Path_T oPPath;
+   size_t ulDepth = 0;
+   size_t ulExpectedDepth = 0;
+   int iStatus;
+   int iExpected;
+   boolean bIsRight;
+
+   iExpected = Scan_reference(pcChars, ulLength, &ulExpectedDepth);
+   iStatus = Path_checkSpan(pcChars, ulLength, &ulDepth);
+   if(iStatus != iExpected)
+      return Scan_fail(pcTest, iExpected == SUCCESS ?
+                       "Path_checkSpan rejected a good path" :
+                       "Path_checkSpan accepted a bad path");
+   if(iStatus == SUCCESS && ulDepth != ulExpectedDepth)
+      return Scan_fail(pcTest,
+                       "Path_checkSpan miscounted components");
+
+   if(pcChars[ulLength] != '\0' ||
+      memchr(pcChars, '\0', ulLength) != NULL)
+      return 0;
+   iStatus = Path_new(pcChars, &oPPath);
+   if(iStatus != iExpected)
+      return Scan_fail(pcTest,
+                       "Path_new disagrees with Path_checkSpan");
+   if(iStatus == SUCCESS) {
+      bIsRight = (boolean)
+         (Path_getDepth(oPPath) == ulExpectedDepth &&
+          Path_getStrLength(oPPath) == ulLength);
+      Path_free(oPPath);
+      if(!bIsRight)
+         return Scan_fail(pcTest, "Path_new built the wrong path");
+   }
+   return 0;
+}
+
+/*
+  Fills the first ulLength characters of pcChars with component
+  characters, and terminates them with a '\0'.
+*/
+static void Scan_fill(char *pcChars, size_t ulLength) {
+   size_t i;
+
+   for(i = 0; i < ulLength; i++)
+      pcChars[i] = (char) ('a' + i % 26);
+   pcChars[ulLength] = '\0';
+}
+
+/*
+  Tests pathnames of each length in aulScanLengths with a '/', a
+  "//", and a '\0' at every position, so that each falls at, before,
+  and after every block boundary and in the tail block that overlaps
+  the one before it. Returns the number of failed checks.
+*/
+static size_t Scan_testBoundaries(void) {
+   char acChars[SCAN_MAX_LENGTH + 2];
+   size_t ulLength;
+   size_t ulLengthIndex;
+   size_t i;
+   size_t ulFailures = 0;
+
+   for(ulLengthIndex = 0; ulLengthIndex < SCAN_COUNT(aulScanLengths);
+       ulLengthIndex++) {
+      ulLength = aulScanLengths[ulLengthIndex];
+
+      Scan_fill(acChars, ulLength);
+      ulFailures += Scan_check(acChars, ulLength, "boundaries, plain");
+
+      for(i = 0; i < ulLength; i++) {
+         Scan_fill(acChars, ulLength);
+         acChars[i] = '/';
+         ulFailures += Scan_check(acChars, ulLength,
+                                  "boundaries, '/'");
+
+         if(i + 1 < ulLength) {
+            acChars[i + 1] = '/';
+            ulFailures += Scan_check(acChars, ulLength,
+                                     "boundaries, \"//\"");
+         }
+
+         Scan_fill(acChars, ulLength);
+         acChars[i] = '\0';
+         ulFailures += Scan_check(acChars, ulLength,
+                                  "boundaries, '\\0'");
+      }
+
+      /* what follows the span is not part of it, even when the tail
+         block's load ends right before it */
+      Scan_fill(acChars, ulLength + 1);
+      acChars[ulLength] = '/';
+      ulFailures += Scan_check(acChars, ulLength, "boundaries, after");
+   }
+
+   printf("%-24s %s\n", "boundaries",
+          ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*
+  Tests SCAN_RANDOM_TRIALS random pathnames of random lengths, mostly
+  component characters and delimiters with the odd '\0', each starting
+  at a random offset in its buffer. Returns the number of failed
+  checks.
+*/
+static size_t Scan_testRandom(void) {
+   char acBuffer[SCAN_MAX_OFFSET + SCAN_MAX_LENGTH + 1];
+   char *pcChars;
+   size_t ulLength;
+   size_t ulTrial;
+   size_t i;
+   size_t ulFailures = 0;
+   int iChoice;
+
+   srand(1);
+   for(ulTrial = 0; ulTrial < SCAN_RANDOM_TRIALS; ulTrial++) {
+      ulLength = (size_t) rand() % SCAN_MAX_LENGTH;
+      pcChars = acBuffer + rand() % SCAN_MAX_OFFSET;
+      for(i = 0; i < ulLength; i++) {
+         iChoice = rand() % 64;
+         if(iChoice < 16)
+            pcChars[i] = '/';
+         else if(iChoice == 16)
+            pcChars[i] = '\0';
+         else
+            pcChars[i] = (char) ('a' + iChoice % 26);
+      }
+      pcChars[ulLength] = '\0';
+      ulFailures += Scan_check(pcChars, ulLength, "random");
+
+      /* one report is enough to go on */
+      if(ulFailures != 0)
+         break;
+   }
+
+   printf("%-24s %s\n", "random", ulFailures == 0 ? "ok" : "FAILED");
+   return ulFailures;
+}
+
+/*
+  Tests that Path_checkSpan, and Path_new, which scans with it, tell
+  well-formed pathnames from malformed ones and count their
+  components correctly. Takes no command-line arguments. Returns 0
+  (EXIT_SUCCESS) if every check passed, or EXIT_FAILURE otherwise.
+*/
+int main(void) {
+   size_t ulFailures = 0;
+
+   ulFailures += Scan_testBoundaries();
+   ulFailures += Scan_testRandom();
+
+   return ulFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
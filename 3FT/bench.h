@@ -0,0 +1 @@
+../0shared/bench.h
\ No newline at end of file
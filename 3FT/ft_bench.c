@@ -0,0 +1,49 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench.c                                                         */
+/* Author: agent                                                      */
+/*--------------------------------------------------------------------*/
+
+#include "ft.h"
+#include "bench.h"
+
+/* Inserts pcPath as an empty file if bIsFile, or else a directory. */
+static int FTBench_insert(const char *pcPath, boolean bIsFile) {
+   if(bIsFile)
+      return FT_insertFile(pcPath, NULL, 0);
+   return FT_insertDir(pcPath);
+}
+
+/* Returns whether pcPath is in the FT as a file if bIsFile, or else
+   as a directory. */
+static boolean FTBench_contains(const char *pcPath, boolean bIsFile) {
+   if(bIsFile)
+      return FT_containsFile(pcPath);
+   return FT_containsDir(pcPath);
+}
+
+/* Removes file pcPath if bIsFile, or else directory pcPath and
+   everything below it. */
+static int FTBench_rm(const char *pcPath, boolean bIsFile) {
+   if(bIsFile)
+      return FT_rmFile(pcPath);
+   return FT_rmDir(pcPath);
+}
+
+/* Looks up pcPath's type and size. */
+static int FTBench_stat(const char *pcPath) {
+   boolean bIsFile;
+   size_t ulSize;
+
+   return FT_stat(pcPath, &bIsFile, &ulSize);
+}
+
+/* Benchmarks the FT implementation it is linked with; see bench.h
+   for the command-line arguments and report. */
+int main(int argc, char *argv[]) {
+   static const struct BenchOps sOps = {
+      "FT", FT_init, FT_destroy, FTBench_insert, FTBench_contains,
+      FTBench_rm, FTBench_stat, FT_toString, FALSE, NULL
+   };
+
+   return Bench_main(argc, argv, &sOps);
+}